@@ -0,0 +1,15 @@
+#ifndef BENCHMARK_BENCHMARK_H_
+#define BENCHMARK_BENCHMARK_H_
+
+#include <cstdio>
+#include <cstdlib>
+
+// 基准通常以 release 编译，不能使用 assert
+#define CHECK(expr)                                                                                                    \
+    if (!(expr))                                                                                                       \
+    {                                                                                                                  \
+        fprintf(stderr, "%s:%d %s failed.\n", __FILE__, __LINE__, #expr);                                              \
+        abort();                                                                                                       \
+    }
+
+#endif // BENCHMARK_BENCHMARK_H_
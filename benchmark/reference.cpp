@@ -0,0 +1,106 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <napi/js_native_api.h>
+#include <vector>
+
+#include "benchmark.h"
+
+// 大量 NAPIRef 存活时的 GC 停顿基准，计时 NAPIRunGC 完整 GC
+// 用法：benchmark_xxx [referenceCount]，默认 100000，一半强引用一半弱引用
+
+namespace
+{
+
+const char *const GARBAGE_SCRIPT = "(()=>{var a;for(var i=0;i<2000000;++i){a={i:i,s:[i]};}return a.i;})()";
+
+const char *const OBJECT_ARRAY_SCRIPT = "(n=>{var a=new Array(n);for(var i=0;i<n;++i){a[i]={i:i};}return a;})";
+
+struct GCTime
+{
+    // NAPIRunGC 调用耗时
+    double wallTime;
+    // 引擎统计的 GC 耗时，JavaScriptCore 为 0
+    double gcTime;
+};
+
+// 先制造垃圾，只计时 NAPIRunGC，停顿不被脚本执行时间掩盖
+GCTime measureFullGC(NAPIEnv env)
+{
+    NAPIHandleScope handleScope;
+    CHECK(napi_open_handle_scope(env, &handleScope) == NAPIErrorOK);
+    CHECK(NAPIRunScript(env, GARBAGE_SCRIPT, "https://www.napi.com/benchmark_garbage.js", nullptr) ==
+          NAPIExceptionOK);
+    napi_close_handle_scope(env, handleScope);
+    NAPIHeapStats before, after;
+    CHECK(NAPIGetHeapStatistics(env, &before) == NAPICommonOK);
+    auto begin = std::chrono::steady_clock::now();
+    CHECK(NAPIRunGC(env, NAPIGCKindFull) == NAPICommonOK);
+    auto end = std::chrono::steady_clock::now();
+    CHECK(NAPIGetHeapStatistics(env, &after) == NAPICommonOK);
+
+    return {std::chrono::duration<double, std::milli>(end - begin).count(),
+            (double)(after.gcNanoseconds - before.gcNanoseconds) / 1000000};
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t referenceCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 100000;
+
+    NAPIRuntime runtime;
+    NAPIEnv env;
+    CHECK(NAPICreateRuntime(&runtime) == NAPIErrorOK);
+    CHECK(NAPICreateEnv(&env, runtime) == NAPIErrorOK);
+
+    NAPIHandleScope handleScope;
+    CHECK(napi_open_handle_scope(env, &handleScope) == NAPIErrorOK);
+
+    // 预热
+    measureFullGC(env);
+    GCTime baseline = measureFullGC(env);
+
+    NAPIValue functionValue, countValue, arrayValue;
+    CHECK(NAPIRunScript(env, OBJECT_ARRAY_SCRIPT, "https://www.napi.com/benchmark_object_array.js",
+                         &functionValue) == NAPIExceptionOK);
+    CHECK(napi_create_double(env, referenceCount, &countValue) == NAPIErrorOK);
+    CHECK(napi_call_function(env, nullptr, functionValue, 1, &countValue, &arrayValue) == NAPIExceptionOK);
+
+    std::vector<NAPIRef> referenceList(referenceCount);
+    auto begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < referenceCount; ++i)
+    {
+        NAPIHandleScope innerHandleScope;
+        CHECK(napi_open_handle_scope(env, &innerHandleScope) == NAPIErrorOK);
+        NAPIValue indexValue, objectValue;
+        CHECK(napi_create_double(env, i, &indexValue) == NAPIErrorOK);
+        CHECK(napi_get_property(env, arrayValue, indexValue, &objectValue) == NAPIExceptionOK);
+        CHECK(napi_create_reference(env, objectValue, i % 2, &referenceList[i]) == NAPIExceptionOK);
+        napi_close_handle_scope(env, innerHandleScope);
+    }
+    auto end = std::chrono::steady_clock::now();
+    double createTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    GCTime withReference = measureFullGC(env);
+
+    begin = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < referenceCount; ++i)
+    {
+        CHECK(napi_delete_reference(env, referenceList[i]) == NAPIExceptionOK);
+    }
+    end = std::chrono::steady_clock::now();
+    double deleteTime = std::chrono::duration<double, std::milli>(end - begin).count();
+
+    printf("references: %u\n", referenceCount);
+    printf("create: %.3f ms\n", createTime);
+    printf("delete: %.3f ms\n", deleteTime);
+    printf("full gc without references: %.3f ms (engine %.3f ms)\n", baseline.wallTime, baseline.gcTime);
+    printf("full gc with references: %.3f ms (engine %.3f ms)\n", withReference.wallTime, withReference.gcTime);
+
+    napi_close_handle_scope(env, handleScope);
+    NAPIFreeEnv(env);
+    NAPIFreeRuntime(runtime);
+
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <napi/js_native_api.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "benchmark.h"
+
+// 冷启动基准，每次使用新的 runtime，对比源码、字节码、代码缓存和 NAPIRunScriptWithOptions 各编译选项的执行耗时
+// 用法：benchmark_startup_xxx [iterationCount] [scriptPath]，默认执行 5 次取平均
+// 不指定 scriptPath 时生成 2000 个函数的脚本，测量真实 bundle 时可以传入 test/builtin 的 webpack 产物
+// 源码副本和字节码不在 GC 堆中，内存对比需要同时观察进程 RSS
+
+namespace
+{
+
+const char *const SOURCE_URL = "https://www.napi.com/benchmark_startup.js";
+
+// 大部分函数只定义不执行，放大 lazy 和 eager 编译的差异
+std::string generateScript()
+{
+    std::string script;
+    for (int i = 0; i < 2000; ++i)
+    {
+        std::string index = std::to_string(i);
+        script += "function f" + index + "(a) { const o = { x: a, y: '" + index +
+                  "' }; return Math.max(o.x, o.y.length); }\n";
+    }
+    script += "f0(1) + f1999(2);";
+
+    return script;
+}
+
+std::string readScript(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    CHECK(file);
+    std::string script;
+    char buffer[4096];
+    size_t size;
+    while ((size = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        script.append(buffer, size);
+    }
+    CHECK(!ferror(file));
+    fclose(file);
+
+    return script;
+}
+
+struct StartupResult
+{
+    // 执行耗时平均值，不包含创建 runtime
+    double time;
+    // 执行后的 GC 堆大小平均值
+    size_t usedHeapSize;
+};
+
+// setup 在创建 runtime 之后、创建 env 之前调用，不计入耗时
+template <typename Setup, typename Run> StartupResult measureStartup(uint32_t iterationCount, Setup setup, Run run)
+{
+    double time = 0;
+    size_t usedHeapSize = 0;
+    for (uint32_t i = 0; i < iterationCount; ++i)
+    {
+        NAPIRuntime runtime;
+        NAPIEnv env;
+        CHECK(NAPICreateRuntime(&runtime) == NAPIErrorOK);
+        setup(runtime);
+        CHECK(NAPICreateEnv(&env, runtime) == NAPIErrorOK);
+        auto begin = std::chrono::steady_clock::now();
+        run(env);
+        auto end = std::chrono::steady_clock::now();
+        time += std::chrono::duration<double, std::milli>(end - begin).count();
+        NAPIHeapStats heapStats;
+        CHECK(NAPIGetHeapStatistics(env, &heapStats) == NAPICommonOK);
+        usedHeapSize += heapStats.usedHeapSize;
+        NAPIFreeEnv(env);
+        NAPIFreeRuntime(runtime);
+    }
+
+    return {time / iterationCount, usedHeapSize / iterationCount};
+}
+
+template <typename Run> StartupResult measureStartup(uint32_t iterationCount, Run run)
+{
+    return measureStartup(iterationCount, [](NAPIRuntime) {}, run);
+}
+
+void printResult(const char *name, StartupResult result)
+{
+    printf("%s: %.3f ms, used heap %zu bytes\n", name, result.time, result.usedHeapSize);
+}
+
+// 遍历缓存目录的条目，remove 为 true 时删除，返回删除前的总大小
+size_t visitCodeCacheEntries(const std::string &directory, bool remove)
+{
+    size_t totalSize = 0;
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+    {
+        return totalSize;
+    }
+    while (struct dirent *dirent = readdir(dir))
+    {
+        std::string name = dirent->d_name;
+        if (name.size() <= 6 || name.compare(name.size() - 6, 6, ".cache") != 0)
+        {
+            continue;
+        }
+        struct stat entryStat;
+        if (!fstatat(dirfd(dir), dirent->d_name, &entryStat, 0))
+        {
+            totalSize += static_cast<size_t>(entryStat.st_size);
+        }
+        if (remove)
+        {
+            unlinkat(dirfd(dir), dirent->d_name, 0);
+        }
+    }
+    closedir(dir);
+
+    return totalSize;
+}
+
+// miss 为每次清空缓存后执行，包含编译和写入缓存文件；hit 为缓存已经存在时执行
+void measureCodeCache(uint32_t iterationCount, const std::string &script)
+{
+    char parentDirectory[] = "/tmp/napi_benchmark_code_cache_XXXXXX";
+    CHECK(mkdtemp(parentDirectory));
+    std::string directory = std::string(parentDirectory) + "/cache";
+    auto run = [&script](NAPIEnv env) {
+        CHECK(NAPIRunScript(env, script.c_str(), SOURCE_URL, nullptr) == NAPIExceptionOK);
+    };
+    NAPIRuntime runtime;
+    CHECK(NAPICreateRuntime(&runtime) == NAPIErrorOK);
+    NAPIErrorStatus status = NAPISetCodeCacheDirectory(runtime, directory.c_str(), 0);
+    NAPIFreeRuntime(runtime);
+    // JavaScriptCore 不支持
+    if (status == NAPIErrorOK)
+    {
+        auto clearAndOpen = [&directory](NAPIRuntime runtime) {
+            visitCodeCacheEntries(directory, true);
+            CHECK(NAPISetCodeCacheDirectory(runtime, directory.c_str(), 0) == NAPIErrorOK);
+        };
+        auto openCache = [&directory](NAPIRuntime runtime) {
+            CHECK(NAPISetCodeCacheDirectory(runtime, directory.c_str(), 0) == NAPIErrorOK);
+        };
+        printResult("codeCacheMiss", measureStartup(iterationCount, clearAndOpen, run));
+        printf("code cache: %zu bytes\n", visitCodeCacheEntries(directory, false));
+        printResult("codeCacheHit", measureStartup(iterationCount, openCache, run));
+    }
+    visitCodeCacheEntries(directory, true);
+    unlink((directory + "/version").c_str());
+    rmdir(directory.c_str());
+    rmdir(parentDirectory);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    uint32_t iterationCount = argc > 1 ? (uint32_t)strtoul(argv[1], nullptr, 10) : 5;
+    CHECK(iterationCount > 0);
+    std::string script = argc > 2 ? readScript(argv[2]) : generateScript();
+    printf("script: %zu bytes\n", script.size());
+
+    printResult("source", measureStartup(iterationCount, [&script](NAPIEnv env) {
+                    CHECK(NAPIRunScript(env, script.c_str(), SOURCE_URL, nullptr) == NAPIExceptionOK);
+                }));
+
+    // 字节码只编译一次，每次使用新的 runtime 执行，编译用的 env 保留到最后释放字节码
+    NAPIRuntime compileRuntime;
+    NAPIEnv compileEnv;
+    CHECK(NAPICreateRuntime(&compileRuntime) == NAPIErrorOK);
+    CHECK(NAPICreateEnv(&compileEnv, compileRuntime) == NAPIErrorOK);
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    // JavaScriptCore 不支持
+    if (NAPICompileToByteBuffer(compileEnv, script.c_str(), SOURCE_URL, &byteBuffer, &bufferSize) == NAPIExceptionOK)
+    {
+        printf("byte buffer: %zu bytes\n", bufferSize);
+        printResult("byteBuffer", measureStartup(iterationCount, [byteBuffer, bufferSize](NAPIEnv env) {
+                        CHECK(NAPIRunByteBuffer(env, byteBuffer, bufferSize, nullptr) == NAPIExceptionOK);
+                    }));
+        NAPIFreeByteBuffer(compileEnv, byteBuffer);
+    }
+    NAPIFreeEnv(compileEnv);
+    NAPIFreeRuntime(compileRuntime);
+
+    measureCodeCache(iterationCount, script);
+
+    // 字段顺序为 version, eager, stripDebugInfo, optimize, strict, staticBuiltins
+    struct
+    {
+        const char *name;
+        NAPIRunScriptOptions options;
+    } configList[] = {
+        {"lazyDebug", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, false, false, false, false, false}},
+        {"lazy", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, false, true, false, false, false}},
+        {"eagerDebug", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, true, false, false, false, false}},
+        {"eager", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, true, true, false, false, false}},
+        {"eagerOptimize", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, true, true, true, false, false}},
+        {"eagerOptimizeStaticBuiltins", {NAPI_RUN_SCRIPT_OPTIONS_VERSION, true, true, true, false, true}},
+    };
+    for (const auto &config : configList)
+    {
+        const NAPIRunScriptOptions *options = &config.options;
+        printResult(config.name, measureStartup(iterationCount, [&script, options](NAPIEnv env) {
+                        CHECK(NAPIRunScriptWithOptions(env, script.c_str(), SOURCE_URL, options, nullptr) ==
+                              NAPIExceptionOK);
+                    }));
+    }
+
+    return 0;
+}
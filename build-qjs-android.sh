@@ -14,6 +14,9 @@ gn gen x86_64 --args="build_android=true cross_compile_target=\"x86_64\""
 
 ninja -C armv7 qjs  && ninja -C arm64 qjs  && ninja -C i386 qjs  && ninja -C x86_64 qjs
 
+# USDT 探针只在 64 位生效，只编译不打包
+ninja -C arm64 napi_qjs_usdt_check && ninja -C x86_64 napi_qjs_usdt_check
+
 mkdir -p napi/libs/armeabi-v7a && mkdir -p napi/libs/arm64-v8a && mkdir -p napi/libs/x86 && mkdir -p napi/libs/x86_64
 
 cp armv7/obj/lib{hermes,qjs}.so napi/libs/armeabi-v7a
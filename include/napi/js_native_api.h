@@ -75,14 +75,31 @@ NAPI_EXPORT NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NA
 
 NAPI_EXPORT NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **result);
 
+// 通知引擎 JS 对象持有的 native 内存变化，不会同步执行 GC
+// QuickJS 超过 NAPIRuntimeConfig.externalMemoryLimit 时降低 GC 阈值，Hermes 计入 GC external 额度，JavaScriptCore 上报 extra memory cost
+// adjustedValue 可空，返回调整后的总量
+NAPI_EXPORT NAPICommonStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue);
+
+// 只支持 NAPIDefineClass 创建的实例，其他对象返回 NAPIErrorObjectExpected，重复 wrap 返回 NAPIErrorInvalidArg
+// finalizeCB/finalizeHint/result 可空，result 为弱引用
+NAPI_EXPORT NAPIExceptionStatus napi_wrap(NAPIEnv env, NAPIValue jsObject, void *nativeObject, NAPIFinalize finalizeCB,
+                                          void *finalizeHint, NAPIRef *result);
+
+// 未 wrap 返回 NAPIErrorInvalidArg
+NAPI_EXPORT NAPIErrorStatus napi_unwrap(NAPIEnv env, NAPIValue jsObject, void **result);
+
+// 不会调用 finalizeCB，result 可空
+NAPI_EXPORT NAPIErrorStatus napi_remove_wrap(NAPIEnv env, NAPIValue jsObject, void **result);
+
 // Set initial_refcount to 0 for a weak reference, >0 for a strong reference.
 // QuickJS 和 JavaScriptCore 实现弱引用会产生异常
 NAPI_EXPORT NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount,
                                                       NAPIRef *result);
 
+// 删除后继续使用 ref，debug 下 assert，release 下返回 NAPIExceptionInvalidArg
 NAPI_EXPORT NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref);
 
-// result 可空
+// result 可空，引用计数达到 UINT32_MAX 返回 NAPIExceptionGenericFailure
 NAPI_EXPORT NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result);
 
 // result 可空
@@ -112,6 +129,11 @@ NAPI_EXPORT NAPICommonStatus NAPIClearLastException(NAPIEnv env);
 NAPI_EXPORT NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl,
                                               NAPIValue *result);
 
+// 同 napi_create_external，额外统计 externalMemorySize 字节外部内存，External 回收时自动扣除
+NAPI_EXPORT NAPIExceptionStatus NAPICreateExternalWithSize(NAPIEnv env, void *data, NAPIFinalize finalizeCB,
+                                                           void *finalizeHint, size_t externalMemorySize,
+                                                           NAPIValue *result);
+
 // 推荐实现层针对 utf8name 为空情况做处理，比如当做 ""
 // data 可空
 NAPI_EXPORT NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallback constructor, void *data,
@@ -121,6 +143,16 @@ NAPI_EXPORT NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime);
 
 NAPI_EXPORT NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime);
 
+// config 可空，为空等同于 NAPICreateRuntime
+// JavaScriptCore 公开 API 不支持设置堆和栈参数，只校验 version，其余字段全部忽略
+NAPI_EXPORT NAPIErrorStatus NAPICreateRuntimeWithConfig(NAPIRuntime *runtime, const NAPIRuntimeConfig *config);
+
+// config 可空，非 0 字段覆盖 runtime 的配置，只对 Hermes 生效（每个 env 独占一个 Hermes Runtime）
+// QuickJS/JavaScriptCore 的多个 env 共享 runtime 堆，只校验 version，其余字段全部忽略，不会返回错误
+// 这两个引擎的配置需要通过 NAPICreateRuntimeWithConfig 设置
+NAPI_EXPORT NAPIErrorStatus NAPICreateEnvWithConfig(NAPIEnv *env, NAPIRuntime runtime,
+                                                    const NAPIRuntimeConfig *config);
+
 NAPI_EXPORT NAPICommonStatus NAPIFreeEnv(NAPIEnv env);
 
 NAPI_EXPORT NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime);
@@ -129,14 +161,187 @@ NAPI_EXPORT NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value,
 
 NAPI_EXPORT NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString);
 
+// QuickJS 为 JS_WriteObject 字节码，Hermes 为 HBC 字节码，均和引擎版本绑定，需要使用同一版本编译和执行
+// JavaScriptCore 不支持，编译和执行均返回 NAPIExceptionGenericFailure
+// byteBuffer 需要使用 NAPIFreeByteBuffer 释放
 NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
                                                         const uint8_t **byteBuffer, size_t *bufferSize);
 
 NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer);
 
+// byteBuffer 为 NULL 或者 bufferSize 为 0 返回 NAPIExceptionInvalidArg
 NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
                                                   NAPIValue *result);
 
+// 只读映射 path 文件执行字节码，格式同 NAPIRunByteBuffer，打开或者映射失败返回 NAPIExceptionGenericFailure
+// Hermes 直接在映射内存上执行，不复制，页面在进程间共享并且可以被系统回收，env 销毁前不能修改或者截断文件；
+// QuickJS JS_ReadObject 会复制反序列化，执行后立即解除映射；JavaScriptCore 不支持，返回 NAPIExceptionGenericFailure
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFromFile(NAPIEnv env, const char *path, NAPIValue *result);
+
+// 开启 NAPIRunScript 磁盘字节码缓存，key 为引擎字节码版本 + sourceUrl + 源码，命中时直接执行字节码，跳过解析和编译
+// 未命中时编译后写入缓存，写入失败不影响执行；目录下 version 文件和引擎版本不一致时清空旧缓存
+// directory 不存在时只创建最后一级，不同引擎需要使用不同目录，多个进程可以共用同一目录；directory 为 NULL 关闭缓存
+// maxSize 为目录总大小上限，0 使用默认值 32MB，超过时按最近访问时间淘汰
+// 需要在 runtime 的 env 执行脚本之前调用，runtime 需要在它的 env 之后释放，目录不可用返回 NAPIErrorGenericFailure
+// Hermes 开启后全量编译并且不生成调试信息，命中时直接在映射内存上执行；JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIRuntime runtime, const char *directory, size_t maxSize);
+
+// 编译一次多次执行，script 在返回后即可释放，length 为 NAPI_AUTO_LENGTH 时 script 需要以 \0 结尾
+// 只能在编译时的 env 中执行和释放，否则返回 InvalidArg，需要在 NAPIFreeEnv 之前使用 NAPIFreeScript 释放
+// QuickJS 持有编译后的函数字节码；Hermes 持有全量编译的 BCProvider，每次执行只创建 RuntimeModule；
+// JavaScriptCore 没有公开的编译 API，编译时只检查语法并持有 JSStringRef，执行时依赖引擎内部的代码缓存
+NAPI_EXPORT NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, size_t length, const char *sourceUrl,
+                                                  NAPIScript *result);
+
+// 每次执行都在全局作用域，和 NAPIRunScript 相同
+NAPI_EXPORT NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result);
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script);
+
+// options 为 NULL 时等同于 NAPIRunScript，script 和 sourceUrl 为 NULL 时视为空字符串
+// 开启 NAPISetCodeCacheDirectory 时同样使用缓存，影响字节码的选项作为 key 的一部分；Hermes 命中和写入缓存时总是全量编译
+// 并且不生成调试信息，eager 和 stripDebugInfo 不生效，和 NAPIRunScript 开启缓存时相同
+// QuickJS 总是全量编译并且没有优化选项，只支持 strict；JavaScriptCore 通过在源码前插入 "use strict" 支持 strict，
+// 第一行的列号会偏移
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                         const NAPIRunScriptOptions *options, NAPIValue *result);
+
+// 在进程内共享的线程池中编译为字节码，不阻塞 JS 线程，script 在返回后即可释放，length 同 NAPICompileScript
+// 编译不依赖 env 状态，callback 需要自行投递到 JS 线程后使用 NAPIRunByteBuffer 执行，可以在该 runtime 的任意 env 中执行
+// QuickJS 每个任务在独立的 JSRuntime 中编译；Hermes 全量编译；JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+// 无法创建线程时返回 NAPIErrorGenericFailure，此时 callback 不会被调用
+NAPI_EXPORT NAPIErrorStatus NAPICompileScriptAsync(NAPIRuntime runtime, const char *script, size_t length,
+                                                   const char *sourceUrl, NAPICompileCallback callback, void *data);
+
+// 同 NAPIRunScript，length 为 NAPI_AUTO_LENGTH 时 script 需要以 \0 结尾，使用 NAPISetCodeCacheDirectory 缓存
+// 引擎 parser 要求源码以 \0 结尾，指定长度时复制一次；Hermes 总是复制一次并且将副本直接交给 lazy 编译持有，
+// 不再由 Runtime 复制，NAPI_AUTO_LENGTH 时 QuickJS 不复制
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithLength(NAPIEnv env, const char *script, size_t length,
+                                                        const char *sourceUrl, NAPIValue *result);
+
+// 按顺序拼接 chunks 后执行，等同于对拼接结果调用 NAPIRunScriptWithLength，直接复制到同一块内存，调用方不需要先拼接
+// lengths 可空，为 NULL 或者元素为 NAPI_AUTO_LENGTH 时对应分片需要以 \0 结尾，chunks[i] 为 NULL 视为空字符串
+// 只拼接源码，分片边界不会插入换行或者分号
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptChunks(NAPIEnv env, const char *const *chunks, const size_t *lengths,
+                                                    size_t chunkCount, const char *sourceUrl, NAPIValue *result);
+
+// 设置 env 的 ES 模块加载回调，静态 import 和动态 import() 均会使用，NULL 清除
+// resolveCallback 为 NULL 时 specifier 直接作为模块名；加载过的模块缓存在 env 内，不会重复调用 loadCallback
+// 开启 NAPISetCodeCacheDirectory 时模块同样使用字节码缓存
+// 只有 QuickJS 支持，Hermes 和 JavaScriptCore 返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPISetModuleLoader(NAPIEnv env, NAPIModuleResolveCallback resolveCallback,
+                                                NAPIModuleLoadCallback loadCallback, void *data);
+
+// 以 ES 模块执行 script，moduleName 作为 import 相对路径的 referrer，依赖通过 NAPISetModuleLoader 加载
+// QuickJS 模块求值结果为 undefined，不返回导出对象；Hermes 和 JavaScriptCore 返回 NAPIExceptionGenericFailure
+NAPI_EXPORT NAPIExceptionStatus NAPIRunModule(NAPIEnv env, const char *script, const char *moduleName,
+                                              NAPIValue *result);
+
+// 字节码归档，一个文件包含多个模块的字节码，按模块名查找，只有执行过的模块会被读入内存
+// 格式和引擎版本绑定，需要使用同一版本构建和执行；JavaScriptCore 不支持，全部返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPICreateArchiveBuilder(NAPIArchiveBuilder *result);
+
+// byteBuffer 为 NAPICompileToByteBuffer 或者 NAPICompileScriptAsync 的结果，会被复制，moduleName 重复返回 NAPIErrorInvalidArg
+NAPI_EXPORT NAPIErrorStatus NAPIArchiveBuilderAddModule(NAPIArchiveBuilder builder, const char *moduleName,
+                                                        const uint8_t *byteBuffer, size_t bufferSize);
+
+// 写入临时文件后 rename，写入失败返回 NAPIErrorGenericFailure，可以多次写入
+NAPI_EXPORT NAPIErrorStatus NAPIArchiveBuilderWrite(NAPIArchiveBuilder builder, const char *path);
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeArchiveBuilder(NAPIArchiveBuilder builder);
+
+// 只读映射整个文件，只校验文件头和模块表，不预读字节码；文件不存在、格式错误或者引擎版本不一致返回 NAPIErrorGenericFailure
+// archive 可以在多个 runtime/env 中使用，关闭前不能修改或者截断文件
+NAPI_EXPORT NAPIErrorStatus NAPIOpenArchive(const char *path, NAPIArchive *result);
+
+// 执行过的模块结果缓存持有映射，关闭后在 env 释放时才解除映射
+NAPI_EXPORT NAPICommonStatus NAPICloseArchive(NAPIArchive archive);
+
+// 执行 moduleName 对应的字节码，同 NAPIRunByteBuffer；结果按 env 和模块缓存，之后的调用直接返回同一个值，
+// 抛出异常时不缓存；缓存持有 archive 的映射直到 env 释放
+// 只预读该模块的页面，第一次加载时校验内容哈希；Hermes 直接在映射内存上执行，QuickJS 反序列化时复制
+// moduleName 不存在或者内容哈希不一致返回 NAPIExceptionGenericFailure，不抛出异常
+NAPI_EXPORT NAPIExceptionStatus NAPIRunArchiveModule(NAPIEnv env, NAPIArchive archive, const char *moduleName,
+                                                     NAPIValue *result);
+
+// options 为 NULL 时等同于 NAPICompileToByteBuffer
+// 两种引擎的字节码都不包含源码，字符串在 atom 表/字符串表中只存储一份，stripDebugInfo 之后只剩执行需要的内容
+// QuickJS 使用 JS_EVAL_FLAG_STRIP 编译，不生成文件名和行号表；Hermes 不写入 debug info 段
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBufferWithOptions(NAPIEnv env, const char *script,
+                                                                   const char *sourceUrl,
+                                                                   const NAPICompileOptions *options,
+                                                                   const uint8_t **byteBuffer, size_t *bufferSize);
+
+// 统计 NAPICompileToByteBuffer 字节码各部分的大小，不执行字节码，不需要 env
+// QuickJS 在独立的 JSRuntime 中反序列化后比较内存统计；Hermes 只读取文件头和函数头
+// 字节码格式错误或者和引擎版本不一致返回 NAPIErrorGenericFailure；JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPIGetBytecodeStats(const uint8_t *byteBuffer, size_t bufferSize,
+                                                 NAPIBytecodeStats *result);
+
+// 默认 NAPIFinalizerModeSync，GC 时直接调用 finalizer
+// NAPIFinalizerModeDeferred 下 External/wrap 的 finalizer 进入队列，在最外层 handle scope 关闭时执行一部分，
+// 剩余部分由业务方空闲时调用 NAPIRunPendingFinalizers 执行
+NAPI_EXPORT NAPICommonStatus NAPISetFinalizerMode(NAPIEnv env, NAPIFinalizerMode mode);
+
+// budget 为 0 代表全部执行，remaining 可空
+NAPI_EXPORT NAPICommonStatus NAPIRunPendingFinalizers(NAPIEnv env, size_t budget, size_t *remaining);
+
+NAPI_EXPORT NAPICommonStatus NAPIGetFinalizerStats(NAPIEnv env, NAPIFinalizerStats *stats);
+
+// 必须在 env 所在线程调用，其他线程（比如内存监控线程）需要向 JS 线程投递任务后调用
+// 同步执行，引擎只支持异步回收时为提示（JavaScriptCore）
+NAPI_EXPORT NAPICommonStatus NAPIRunGC(NAPIEnv env, NAPIGCKind kind);
+
+// 同 NAPIRunGC，需要在 env 所在线程调用
+NAPI_EXPORT NAPICommonStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level);
+
+// Hermes 为常数时间；QuickJS 多个 env 共享 runtime，统计为整个 runtime，并且需要遍历堆，耗时和堆大小成正比，
+// GC 次数只包含 N-API 触发的 GC；JavaScriptCore 只支持 externalMemorySize
+NAPI_EXPORT NAPICommonStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStats *stats);
+
+// 流式写入 Chrome .heapsnapshot 格式，不会关闭 fd，写入失败返回 NAPIErrorGenericFailure
+// Hermes 为完整的堆；QuickJS 遍历整个 runtime 的 GC 对象，不执行 getter 和 Proxy trap，Proxy 只记录 target 和 handler，
+// 节点大小为自身的 malloc 分配大小，字符串等原始值不会成为节点
+// JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, int fd);
+
+// sampleIntervalUs 为 0 使用默认值 1ms，已经在采样时返回 NAPIErrorGenericFailure
+// QuickJS 在解释器轮询中断时采样，同一个 runtime 同一时间只能有一个 env 采样；
+// Hermes 使用 SamplingProfiler，进程内只能有一个 env 采样，忽略 sampleIntervalUs；
+// JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPIStartProfiling(NAPIEnv env, uint32_t sampleIntervalUs);
+
+// 停止采样并写入 fd，不会关闭 fd，没有调用 NAPIStartProfiling 返回 NAPIErrorInvalidArg
+// QuickJS 为 Chrome .cpuprofile 格式，Hermes 为 Chrome trace event 格式，均可以导入 DevTools Performance 面板
+NAPI_EXPORT NAPIErrorStatus NAPIStopProfiling(NAPIEnv env, int fd);
+
+// handler 为 NULL 代表清除，QuickJS 的 JSRuntime 只有一个 interrupt handler，NAPIStartProfiling 也会使用，
+// 嵌入方需要通过这里设置，不能直接调用 JS_SetInterruptHandler，采样期间 handler 仍然会被调用
+// Hermes 和 JavaScriptCore 不支持，返回 NAPIErrorGenericFailure
+NAPI_EXPORT NAPIErrorStatus NAPISetInterruptHandler(NAPIRuntime runtime, NAPIInterruptHandler handler, void *data);
+
+// 进程内所有 env 和线程的调用统计，需要开启 GN 参数 napi_instrumentation，否则返回 NAPIErrorGenericFailure
+// stats 为空时 count 返回函数总数，否则 count 传入数组长度，返回写入数量
+NAPI_EXPORT NAPIErrorStatus NAPIGetCallStats(NAPICallStats *stats, size_t *count);
+
+// 开启 env 的 trace 记录，capacity 为环形缓冲区事件数量，0 使用默认值 4096，最大 1048576，满了以后覆盖最旧的事件
+// 记录 NAPIRunScript/NAPIRunByteBuffer/NAPICompileToByteBuffer、微任务执行、N-API 触发的 GC（Hermes 为全部 GC）
+// 和 NAPIBeginTraceSpan 标记的区间，已经开启返回 NAPIErrorGenericFailure
+// JavaScriptCore 没有 GC 回调，微任务由引擎自动执行，均不记录
+NAPI_EXPORT NAPIErrorStatus NAPIStartTracing(NAPIEnv env, uint32_t capacity);
+
+// 丢弃未写入的事件，没有开启时什么也不做
+NAPI_EXPORT NAPICommonStatus NAPIStopTracing(NAPIEnv env);
+
+// 以 Chrome Trace Event Format JSON 写入 fd 并清空缓冲区，不会关闭 fd，没有开启返回 NAPIErrorInvalidArg
+// 每次写入为完整 JSON，可以导入 chrome://tracing 或者 Perfetto
+NAPI_EXPORT NAPIErrorStatus NAPIFlushTrace(NAPIEnv env, int fd);
+
+// 标记 native 回调等区间，必须和 NAPIEndTraceSpan 成对在 env 线程调用，支持嵌套，没有开启时什么也不做
+NAPI_EXPORT NAPICommonStatus NAPIBeginTraceSpan(NAPIEnv env, const char *name);
+
+NAPI_EXPORT NAPICommonStatus NAPIEndTraceSpan(NAPIEnv env);
+
 #pragma mark - 间接函数
 
 NAPI_EXPORT NAPIExceptionStatus napi_set_named_property(NAPIEnv env, NAPIValue object, const char *utf8name,
@@ -15,6 +15,10 @@
 
 EXTERN_C_START
 
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
 typedef struct OpaqueNAPIRuntime *NAPIRuntime;
 typedef struct OpaqueNAPIEnv *NAPIEnv;
 typedef struct OpaqueNAPIValue *NAPIValue;
@@ -22,6 +26,12 @@ typedef struct OpaqueNAPIRef *NAPIRef;
 typedef struct OpaqueNAPIHandleScope *NAPIHandleScope;
 typedef struct OpaqueNAPIEscapableHandleScope *NAPIEscapableHandleScope;
 typedef struct OpaqueNAPICallbackInfo *NAPICallbackInfo;
+typedef struct OpaqueNAPIScript *NAPIScript;
+typedef struct OpaqueNAPIArchive *NAPIArchive;
+typedef struct OpaqueNAPIArchiveBuilder *NAPIArchiveBuilder;
+
+// 长度参数传入 NAPI_AUTO_LENGTH 代表字符串以 \0 结尾
+#define NAPI_AUTO_LENGTH SIZE_MAX
 
 typedef enum
 {
@@ -84,6 +94,162 @@ typedef NAPIValue (*NAPICallback)(NAPIEnv env, NAPICallbackInfo callbackInfo);
 
 typedef void (*NAPIFinalize)(void *finalizeData, void *finalizeHint);
 
+typedef enum
+{
+    // 默认，GC 过程中同步调用 NAPIFinalize
+    NAPIFinalizerModeSync,
+    // NAPIFinalize 进入 env 队列，由 NAPIRunPendingFinalizers 或者最外层 handle scope 关闭时调用
+    NAPIFinalizerModeDeferred,
+} NAPIFinalizerMode;
+
+typedef struct
+{
+    // 当前队列深度
+    size_t pendingCount;
+    size_t maxPendingCount;
+    uint64_t enqueuedCount;
+    uint64_t runCount;
+    uint64_t drainCount;
+    uint64_t totalDrainNanoseconds;
+    uint64_t lastDrainNanoseconds;
+} NAPIFinalizerStats;
+
+typedef enum
+{
+    // 完整 GC
+    NAPIGCKindFull,
+    // 只回收新生代，引擎不支持分代时等同于 NAPIGCKindFull
+    NAPIGCKindYoung,
+} NAPIGCKind;
+
+typedef enum
+{
+    // 回收垃圾
+    NAPIMemoryPressureLevelModerate,
+    // 回收垃圾，并且立即执行所有延迟的 finalizer 以释放 native 内存
+    NAPIMemoryPressureLevelCritical,
+} NAPIMemoryPressureLevel;
+
+// 引擎不支持的字段为 0
+typedef struct
+{
+    // 引擎堆中已使用的字节数
+    size_t usedHeapSize;
+    // 引擎向系统申请的字节数
+    size_t totalHeapSize;
+    size_t objectCount;
+    size_t stringCount;
+    size_t functionCount;
+    // napi_adjust_external_memory 和 NAPICreateExternalWithSize 统计的外部内存
+    int64_t externalMemorySize;
+    uint64_t gcCount;
+    uint64_t gcNanoseconds;
+    // 已经计入引擎 GC 额度的外部内存，只有 Hermes 支持，在 env 线程的安全点和 externalMemorySize 同步
+    int64_t gcExternalMemorySize;
+} NAPIHeapStats;
+
+// 耗时包含嵌套调用（例如 NAPIRunScript 执行期间回调中的 N-API 调用），分位数来自对数直方图，误差不超过 25%
+typedef struct
+{
+    // 函数名，静态字符串
+    const char *name;
+    uint64_t callCount;
+    uint64_t totalNanoseconds;
+    uint64_t maxNanoseconds;
+    uint64_t p50Nanoseconds;
+    uint64_t p90Nanoseconds;
+    uint64_t p99Nanoseconds;
+} NAPICallStats;
+
+// 新增字段时递增，实现层根据 version 判断调用方结构体包含哪些字段
+#define NAPI_RUNTIME_CONFIG_VERSION 2
+
+// 除 version 外，字段为 0 代表使用默认值，引擎不支持的字段忽略
+typedef struct
+{
+    // 必须为 1 ~ NAPI_RUNTIME_CONFIG_VERSION，否则返回 NAPIErrorInvalidArg
+    uint32_t version;
+    // Hermes 为 GC 最大堆，默认 1GB，超过 gcheapsize_t 上限（4GB）时按上限处理；QuickJS 在 memoryLimit 为 0 时作为内存上限
+    size_t maxHeapSize;
+    // Hermes 初始堆
+    size_t initialHeapSize;
+    // 新生代大小，当前引擎均不支持固定新生代（Hermes Hades 无独立配置）
+    size_t youngGenerationSize;
+    // QuickJS malloc 增长超过该值触发 GC，默认 256KB
+    size_t gcThreshold;
+    // QuickJS 最大栈，默认 4 * JS_DEFAULT_STACK_SIZE；Hermes 在 registerCount 为 0 时换算为寄存器栈
+    size_t stackSize;
+    // Hermes 寄存器数量，默认为 512KB 减去 Runtime 自身大小后可容纳的数量
+    uint32_t registerCount;
+    // QuickJS malloc 上限；Hermes 在 maxHeapSize 为 0 时作为最大堆
+    size_t memoryLimit;
+    // version 2 新增，QuickJS 外部内存自上次 GC 以来增长超过该值时提前触发 GC，默认 64MB
+    // Hermes 外部内存计入 GC 的 external 额度，JavaScriptCore 通过 JSReportExtraMemoryCost 上报，均由引擎自身决定
+    size_t externalMemoryLimit;
+} NAPIRuntimeConfig;
+
+#define NAPI_RUN_SCRIPT_OPTIONS_VERSION 1
+
+// 除 version 外，字段为 0 代表和 NAPIRunScript 相同，引擎不支持的字段忽略
+typedef struct
+{
+    // 必须为 1 ~ NAPI_RUN_SCRIPT_OPTIONS_VERSION，否则返回 NAPIExceptionInvalidArg
+    uint32_t version;
+    // Hermes 全量编译，默认 lazy 编译并且保留源码，函数首次调用时编译
+    bool eager;
+    // Hermes 不生成调试器使用的调试信息，不能断点调试
+    bool stripDebugInfo;
+    // Hermes 开启优化 pass，只在 eager 时生效
+    bool optimize;
+    // 严格模式执行，全部引擎均支持
+    bool strict;
+    // Hermes 假设内置对象没有被修改，直接调用内置函数
+    bool staticBuiltins;
+} NAPIRunScriptOptions;
+
+#define NAPI_COMPILE_OPTIONS_VERSION 1
+
+// 除 version 外，字段为 0 代表和 NAPICompileToByteBuffer 相同，引擎不支持的字段忽略
+typedef struct
+{
+    // 必须为 1 ~ NAPI_COMPILE_OPTIONS_VERSION，否则返回 NAPIExceptionInvalidArg
+    uint32_t version;
+    // 不生成文件名和行号表，异常堆栈没有位置信息
+    bool stripDebugInfo;
+} NAPICompileOptions;
+
+// QuickJS 除 totalSize 外为反序列化后的常驻内存，Hermes 为字节码文件中各段的大小
+typedef struct
+{
+    // 字节码大小
+    size_t totalSize;
+    size_t functionCount;
+    // 指令
+    size_t codeSize;
+    // QuickJS 为常量池中的字符串，Hermes 为数组和对象字面量缓冲区
+    size_t constantSize;
+    // QuickJS 为新增的 atom，Hermes 为字符串表
+    size_t atomSize;
+    // QuickJS 为行号表，Hermes 为 debug info 段
+    size_t debugInfoSize;
+} NAPIBytecodeStats;
+
+// 在线程池线程调用，byteBuffer 为 NULL 代表编译失败，errorMessage 为错误信息，可能为 NULL，只在回调期间有效
+// 成功时 byteBuffer 归调用方所有，格式同 NAPICompileToByteBuffer，使用 NAPIFreeByteBuffer 释放
+typedef void (*NAPICompileCallback)(const uint8_t *byteBuffer, size_t bufferSize, const char *errorMessage,
+                                    void *data);
+
+// 在 JS 线程调用，referrer 为发起 import 的模块名，specifier 为 import 的字符串
+// 返回 malloc 分配的模块名，同一模块需要返回相同的名字，作为模块缓存的 key；返回 NULL 代表无法解析
+typedef char *(*NAPIModuleResolveCallback)(const char *referrer, const char *specifier, void *data);
+
+// 在 JS 线程调用，只在 env 模块缓存未命中时调用
+// 返回 malloc 分配并且以 \0 结尾的源码；返回 NULL 代表模块不存在
+typedef char *(*NAPIModuleLoadCallback)(const char *moduleName, void *data);
+
+// 在 JS 线程执行脚本期间定期调用，返回 true 代表中断执行，抛出不可捕获的异常
+typedef bool (*NAPIInterruptHandler)(void *data);
+
 EXTERN_C_END
 
 #endif // SRC_JS_NATIVE_API_TYPES_H_
@@ -0,0 +1,214 @@
+#include <napi/js_native_api.h>
+#include <napi/js_native_api_debugger.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define RETURN_STATUS_IF_FALSE(condition, status)                                                                      \
+    if (!(condition))                                                                                                  \
+    {                                                                                                                  \
+        return status;                                                                                                 \
+    }
+
+#define CHECK_ARG(arg) RETURN_STATUS_IF_FALSE(arg, NAPIErrorInvalidArg)
+
+// HDR 风格的对数直方图，每个 2 的幂区间再均分为 SUB_BUCKET_COUNT 个桶
+#define SUB_BUCKET_BITS 2
+
+#define SUB_BUCKET_COUNT (1 << SUB_BUCKET_BITS)
+
+// 超过 2^41 纳秒（约 36 分钟）记录在最后一个桶
+#define MAX_EXPONENT 40
+
+#define BUCKET_COUNT ((MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT)
+
+enum
+{
+#define NAPI_INSTRUMENT_FUNCTION(returnType, name, parameterList, argumentList) FUNCTION_INDEX_##name,
+#include "js_native_api_instrument_functions.def"
+#undef NAPI_INSTRUMENT_FUNCTION
+    FUNCTION_COUNT
+};
+
+static const char *const functionNameList[] = {
+#define NAPI_INSTRUMENT_FUNCTION(returnType, name, parameterList, argumentList) #name,
+#include "js_native_api_instrument_functions.def"
+#undef NAPI_INSTRUMENT_FUNCTION
+};
+
+// 只有所属线程写入，NAPIGetCallStats 可能在其他线程读取，所以使用 relaxed 原子变量
+struct FunctionStats
+{
+    _Atomic(uint64_t) callCount;
+    _Atomic(uint64_t) totalNanoseconds;
+    _Atomic(uint64_t) maxNanoseconds;
+    _Atomic(uint64_t) bucketList[BUCKET_COUNT];
+};
+
+// 每个线程首次调用时创建，加入全局无锁链表，线程退出后保留统计，不会释放
+struct ThreadStats
+{
+    struct ThreadStats *next;
+    struct FunctionStats functionStatsList[FUNCTION_COUNT];
+};
+
+static _Atomic(struct ThreadStats *) threadStatsHead;
+
+static _Thread_local struct ThreadStats *currentThreadStats;
+
+static inline uint64_t getNanoseconds(void)
+{
+    struct timespec timespec;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+
+    return (uint64_t)timespec.tv_sec * 1000000000 + (uint64_t)timespec.tv_nsec;
+}
+
+static inline uint32_t getBucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKET_COUNT)
+    {
+        return (uint32_t)value;
+    }
+    uint32_t exponent = 63 - (uint32_t)__builtin_clzll(value);
+    if (exponent > MAX_EXPONENT)
+    {
+        return BUCKET_COUNT - 1;
+    }
+    uint32_t shift = exponent - SUB_BUCKET_BITS;
+
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + (uint32_t)((value >> shift) & (SUB_BUCKET_COUNT - 1));
+}
+
+// 桶内最大值
+static uint64_t getBucketValue(uint32_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+    {
+        return index;
+    }
+    uint32_t exponent = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    uint32_t shift = exponent - SUB_BUCKET_BITS;
+    uint64_t lowerBound = (uint64_t)(SUB_BUCKET_COUNT + index % SUB_BUCKET_COUNT) << shift;
+
+    return lowerBound + ((uint64_t)1 << shift) - 1;
+}
+
+// 单一写入者，不需要原子加
+static inline void addRelaxed(_Atomic(uint64_t) *counter, uint64_t value)
+{
+    atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+static void record(uint32_t functionIndex, uint64_t nanoseconds)
+{
+    struct ThreadStats *threadStats = currentThreadStats;
+    if (__builtin_expect(!threadStats, false))
+    {
+        threadStats = calloc(1, sizeof(struct ThreadStats));
+        // 内存不足时丢弃统计
+        if (!threadStats)
+        {
+            return;
+        }
+        threadStats->next = atomic_load_explicit(&threadStatsHead, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&threadStatsHead, &threadStats->next, threadStats,
+                                                      memory_order_release, memory_order_relaxed))
+        {
+        }
+        currentThreadStats = threadStats;
+    }
+    struct FunctionStats *functionStats = &threadStats->functionStatsList[functionIndex];
+    addRelaxed(&functionStats->callCount, 1);
+    addRelaxed(&functionStats->totalNanoseconds, nanoseconds);
+    if (nanoseconds > atomic_load_explicit(&functionStats->maxNanoseconds, memory_order_relaxed))
+    {
+        atomic_store_explicit(&functionStats->maxNanoseconds, nanoseconds, memory_order_relaxed);
+    }
+    addRelaxed(&functionStats->bucketList[getBucketIndex(nanoseconds)], 1);
+}
+
+// 引擎实现和 js_native_api_common.c 通过 js_native_api_instrument_rename.h 重命名为 NAPIImpl_ 前缀
+#define NAPI_INSTRUMENT_FUNCTION(returnType, name, parameterList, argumentList)                                        \
+    returnType NAPIImpl_##name parameterList;                                                                          \
+                                                                                                                       \
+    returnType name parameterList                                                                                      \
+    {                                                                                                                  \
+        uint64_t begin = getNanoseconds();                                                                             \
+        returnType status = NAPIImpl_##name argumentList;                                                              \
+        record(FUNCTION_INDEX_##name, getNanoseconds() - begin);                                                       \
+                                                                                                                       \
+        return status;                                                                                                 \
+    }
+#include "js_native_api_instrument_functions.def"
+#undef NAPI_INSTRUMENT_FUNCTION
+
+// 读取期间其他线程可能继续写入，callCount 和直方图之间不保证一致，分位数以直方图为准
+static uint64_t getPercentile(const uint64_t *bucketList, uint64_t count, uint64_t percent, uint64_t maxNanoseconds)
+{
+    if (!count)
+    {
+        return 0;
+    }
+    // 向上取整，至少为 1
+    uint64_t targetCount = (count * percent + 99) / 100;
+    uint64_t accumulatedCount = 0;
+    for (uint32_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        accumulatedCount += bucketList[i];
+        if (accumulatedCount >= targetCount)
+        {
+            uint64_t value = getBucketValue(i);
+
+            return value < maxNanoseconds ? value : maxNanoseconds;
+        }
+    }
+
+    return maxNanoseconds;
+}
+
+NAPIErrorStatus NAPIGetCallStats(NAPICallStats *stats, size_t *count)
+{
+    CHECK_ARG(count)
+
+    if (!stats)
+    {
+        *count = FUNCTION_COUNT;
+
+        return NAPIErrorOK;
+    }
+    size_t functionCount = *count < FUNCTION_COUNT ? *count : FUNCTION_COUNT;
+    struct ThreadStats *head = atomic_load_explicit(&threadStatsHead, memory_order_acquire);
+    uint64_t bucketList[BUCKET_COUNT];
+    for (size_t i = 0; i < functionCount; ++i)
+    {
+        memset(&stats[i], 0, sizeof(NAPICallStats));
+        stats[i].name = functionNameList[i];
+        memset(bucketList, 0, sizeof(bucketList));
+        uint64_t histogramCount = 0;
+        for (struct ThreadStats *threadStats = head; threadStats; threadStats = threadStats->next)
+        {
+            struct FunctionStats *functionStats = &threadStats->functionStatsList[i];
+            stats[i].callCount += atomic_load_explicit(&functionStats->callCount, memory_order_relaxed);
+            stats[i].totalNanoseconds += atomic_load_explicit(&functionStats->totalNanoseconds, memory_order_relaxed);
+            uint64_t maxNanoseconds = atomic_load_explicit(&functionStats->maxNanoseconds, memory_order_relaxed);
+            if (maxNanoseconds > stats[i].maxNanoseconds)
+            {
+                stats[i].maxNanoseconds = maxNanoseconds;
+            }
+            for (uint32_t j = 0; j < BUCKET_COUNT; ++j)
+            {
+                uint64_t bucketCount = atomic_load_explicit(&functionStats->bucketList[j], memory_order_relaxed);
+                bucketList[j] += bucketCount;
+                histogramCount += bucketCount;
+            }
+        }
+        stats[i].p50Nanoseconds = getPercentile(bucketList, histogramCount, 50, stats[i].maxNanoseconds);
+        stats[i].p90Nanoseconds = getPercentile(bucketList, histogramCount, 90, stats[i].maxNanoseconds);
+        stats[i].p99Nanoseconds = getPercentile(bucketList, histogramCount, 99, stats[i].maxNanoseconds);
+    }
+    *count = functionCount;
+
+    return NAPIErrorOK;
+}
@@ -0,0 +1,115 @@
+#ifndef SRC_INSTRUMENT_JS_NATIVE_API_INSTRUMENT_RENAME_H_
+#define SRC_INSTRUMENT_JS_NATIVE_API_INSTRUMENT_RENAME_H_
+
+// 私有头文件，开启 napi_instrumentation 时通过 -include 注入引擎实现和 js_native_api_common.c
+// 导出函数被重命名为 NAPIImpl_ 前缀的内部函数，js_native_api_instrument.c 定义原名函数，统计耗时后转发
+// 必须和 js_native_api_instrument_functions.def 一致，遗漏会导致链接时符号重复或者未定义
+
+#include <napi/js_native_api_types.h>
+
+// 内部函数不导出，js_native_api_types.h 已经被包含，不会重新定义
+#undef NAPI_EXPORT
+#define NAPI_EXPORT __attribute__((visibility("hidden")))
+
+// js_native_api.h
+#define napi_get_undefined NAPIImpl_napi_get_undefined
+#define napi_get_null NAPIImpl_napi_get_null
+#define napi_get_global NAPIImpl_napi_get_global
+#define napi_get_boolean NAPIImpl_napi_get_boolean
+#define napi_create_double NAPIImpl_napi_create_double
+#define napi_create_string_utf8 NAPIImpl_napi_create_string_utf8
+#define napi_create_function NAPIImpl_napi_create_function
+#define napi_typeof NAPIImpl_napi_typeof
+#define napi_get_value_double NAPIImpl_napi_get_value_double
+#define napi_get_value_bool NAPIImpl_napi_get_value_bool
+#define napi_coerce_to_bool NAPIImpl_napi_coerce_to_bool
+#define napi_coerce_to_number NAPIImpl_napi_coerce_to_number
+#define napi_coerce_to_string NAPIImpl_napi_coerce_to_string
+#define napi_set_property NAPIImpl_napi_set_property
+#define napi_has_property NAPIImpl_napi_has_property
+#define napi_get_property NAPIImpl_napi_get_property
+#define napi_delete_property NAPIImpl_napi_delete_property
+#define napi_is_array NAPIImpl_napi_is_array
+#define napi_call_function NAPIImpl_napi_call_function
+#define napi_new_instance NAPIImpl_napi_new_instance
+#define napi_instanceof NAPIImpl_napi_instanceof
+#define napi_get_cb_info NAPIImpl_napi_get_cb_info
+#define napi_get_new_target NAPIImpl_napi_get_new_target
+#define napi_create_external NAPIImpl_napi_create_external
+#define napi_get_value_external NAPIImpl_napi_get_value_external
+#define napi_adjust_external_memory NAPIImpl_napi_adjust_external_memory
+#define napi_wrap NAPIImpl_napi_wrap
+#define napi_unwrap NAPIImpl_napi_unwrap
+#define napi_remove_wrap NAPIImpl_napi_remove_wrap
+#define napi_create_reference NAPIImpl_napi_create_reference
+#define napi_delete_reference NAPIImpl_napi_delete_reference
+#define napi_reference_ref NAPIImpl_napi_reference_ref
+#define napi_reference_unref NAPIImpl_napi_reference_unref
+#define napi_get_reference_value NAPIImpl_napi_get_reference_value
+#define napi_open_handle_scope NAPIImpl_napi_open_handle_scope
+#define napi_close_handle_scope NAPIImpl_napi_close_handle_scope
+#define napi_open_escapable_handle_scope NAPIImpl_napi_open_escapable_handle_scope
+#define napi_close_escapable_handle_scope NAPIImpl_napi_close_escapable_handle_scope
+#define napi_escape_handle NAPIImpl_napi_escape_handle
+#define napi_throw NAPIImpl_napi_throw
+#define napi_get_and_clear_last_exception NAPIImpl_napi_get_and_clear_last_exception
+#define NAPIClearLastException NAPIImpl_NAPIClearLastException
+#define NAPIRunScript NAPIImpl_NAPIRunScript
+#define NAPICreateExternalWithSize NAPIImpl_NAPICreateExternalWithSize
+#define NAPIDefineClass NAPIImpl_NAPIDefineClass
+#define NAPICreateRuntime NAPIImpl_NAPICreateRuntime
+#define NAPICreateEnv NAPIImpl_NAPICreateEnv
+#define NAPICreateRuntimeWithConfig NAPIImpl_NAPICreateRuntimeWithConfig
+#define NAPICreateEnvWithConfig NAPIImpl_NAPICreateEnvWithConfig
+#define NAPIFreeEnv NAPIImpl_NAPIFreeEnv
+#define NAPIFreeRuntime NAPIImpl_NAPIFreeRuntime
+#define NAPIGetValueStringUTF8 NAPIImpl_NAPIGetValueStringUTF8
+#define NAPIFreeUTF8String NAPIImpl_NAPIFreeUTF8String
+#define NAPICompileToByteBuffer NAPIImpl_NAPICompileToByteBuffer
+#define NAPIFreeByteBuffer NAPIImpl_NAPIFreeByteBuffer
+#define NAPIRunByteBuffer NAPIImpl_NAPIRunByteBuffer
+#define NAPIRunByteBufferFromFile NAPIImpl_NAPIRunByteBufferFromFile
+#define NAPISetCodeCacheDirectory NAPIImpl_NAPISetCodeCacheDirectory
+#define NAPICompileScript NAPIImpl_NAPICompileScript
+#define NAPIRunCompiledScript NAPIImpl_NAPIRunCompiledScript
+#define NAPIFreeScript NAPIImpl_NAPIFreeScript
+#define NAPIRunScriptWithOptions NAPIImpl_NAPIRunScriptWithOptions
+#define NAPICompileScriptAsync NAPIImpl_NAPICompileScriptAsync
+#define NAPIRunScriptWithLength NAPIImpl_NAPIRunScriptWithLength
+#define NAPIRunScriptChunks NAPIImpl_NAPIRunScriptChunks
+#define NAPISetModuleLoader NAPIImpl_NAPISetModuleLoader
+#define NAPIRunModule NAPIImpl_NAPIRunModule
+#define NAPICreateArchiveBuilder NAPIImpl_NAPICreateArchiveBuilder
+#define NAPIArchiveBuilderAddModule NAPIImpl_NAPIArchiveBuilderAddModule
+#define NAPIArchiveBuilderWrite NAPIImpl_NAPIArchiveBuilderWrite
+#define NAPIFreeArchiveBuilder NAPIImpl_NAPIFreeArchiveBuilder
+#define NAPIOpenArchive NAPIImpl_NAPIOpenArchive
+#define NAPICloseArchive NAPIImpl_NAPICloseArchive
+#define NAPIRunArchiveModule NAPIImpl_NAPIRunArchiveModule
+#define NAPICompileToByteBufferWithOptions NAPIImpl_NAPICompileToByteBufferWithOptions
+#define NAPIGetBytecodeStats NAPIImpl_NAPIGetBytecodeStats
+#define NAPISetFinalizerMode NAPIImpl_NAPISetFinalizerMode
+#define NAPIRunPendingFinalizers NAPIImpl_NAPIRunPendingFinalizers
+#define NAPIGetFinalizerStats NAPIImpl_NAPIGetFinalizerStats
+#define NAPIRunGC NAPIImpl_NAPIRunGC
+#define NAPINotifyMemoryPressure NAPIImpl_NAPINotifyMemoryPressure
+#define NAPIGetHeapStatistics NAPIImpl_NAPIGetHeapStatistics
+#define NAPIWriteHeapSnapshot NAPIImpl_NAPIWriteHeapSnapshot
+#define NAPIStartProfiling NAPIImpl_NAPIStartProfiling
+#define NAPIStopProfiling NAPIImpl_NAPIStopProfiling
+#define NAPISetInterruptHandler NAPIImpl_NAPISetInterruptHandler
+#define NAPIStartTracing NAPIImpl_NAPIStartTracing
+#define NAPIStopTracing NAPIImpl_NAPIStopTracing
+#define NAPIFlushTrace NAPIImpl_NAPIFlushTrace
+#define NAPIBeginTraceSpan NAPIImpl_NAPIBeginTraceSpan
+#define NAPIEndTraceSpan NAPIImpl_NAPIEndTraceSpan
+#define napi_set_named_property NAPIImpl_napi_set_named_property
+#define napi_get_named_property NAPIImpl_napi_get_named_property
+#define napi_strict_equals NAPIImpl_napi_strict_equals
+#define NAPIParseUTF8JSONString NAPIImpl_NAPIParseUTF8JSONString
+// js_native_api_debugger.h
+#define NAPISetMessageQueueThread NAPIImpl_NAPISetMessageQueueThread
+#define NAPIEnableDebugger NAPIImpl_NAPIEnableDebugger
+#define NAPIDisableDebugger NAPIImpl_NAPIDisableDebugger
+
+#endif // SRC_INSTRUMENT_JS_NATIVE_API_INSTRUMENT_RENAME_H_
@@ -0,0 +1,610 @@
+#include "js_native_api_bytecode_archive.h"
+
+#include <napi/js_native_api.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "js_native_api_mapped_file.h"
+
+#define ARCHIVE_MAGIC "NAPIARCH"
+#define ARCHIVE_FORMAT_VERSION 2
+#define ARCHIVE_ALIGNMENT 8
+
+#define RETURN_STATUS_IF_FALSE(condition, status)                                                                      \
+    if (!(condition))                                                                                                  \
+    {                                                                                                                  \
+        return status;                                                                                                 \
+    }
+
+#define CHECK_ARG(arg, status)                                                                                         \
+    if (!(arg))                                                                                                        \
+    {                                                                                                                  \
+        return NAPI##status##InvalidArg;                                                                               \
+    }
+
+// 32 字节
+struct ArchiveHeader
+{
+    char magic[8];                // uint64_t
+    uint32_t formatVersion;       // uint32_t
+    uint32_t entryCount;          // uint32_t
+    uint32_t engineVersionLength; // uint32_t
+    uint32_t nameAreaSize;        // uint32_t
+    // 用于检查截断
+    uint64_t fileSize; // uint64_t
+};
+
+// 40 字节
+struct ArchiveEntry
+{
+    uint64_t nameHash; // uint64_t
+    // 字节码的 FNV-1a，第一次加载时校验
+    uint64_t contentHash; // uint64_t
+    // 字节码相对文件开头的偏移
+    uint64_t offset; // uint64_t
+    uint64_t size;   // uint64_t
+    // 模块名相对模块名区域开头的偏移，不包含结尾的 \0
+    uint32_t nameOffset; // uint32_t
+    uint32_t nameLength; // uint32_t
+};
+
+struct BuilderModule
+{
+    char *name;        // size_t
+    size_t nameLength; // size_t
+    uint8_t *data;     // size_t
+    size_t size;       // size_t
+    uint64_t nameHash; // uint64_t
+};
+
+struct BytecodeArchiveBuilder
+{
+    char *engineVersion;              // size_t
+    struct BuilderModule *moduleList; // size_t
+    size_t moduleCount;               // size_t
+    size_t moduleCapacity;            // size_t
+};
+
+struct BytecodeArchive
+{
+    struct MappedFile mappedFile;         // size_t * 2
+    const struct ArchiveEntry *entryList; // size_t
+    const char *nameArea;                 // size_t
+    // 和 entryList 一一对应，多个线程同时第一次加载时可能重复校验，结果相同
+    atomic_bool *verifiedList;    // size_t
+    atomic_size_t referenceCount; // size_t
+    uint32_t entryCount;          // uint32_t
+};
+
+struct ResultCacheEntry
+{
+    // 持有引用，NULL 代表空位
+    struct BytecodeArchive *archive; // size_t
+    void *value;                     // size_t
+    uint32_t moduleIndex;            // uint32_t
+};
+
+struct BytecodeArchiveResultCache
+{
+    // 开放寻址
+    struct ResultCacheEntry *entryList; // size_t
+    // 2 的幂
+    size_t capacity; // size_t
+    size_t count;    // size_t
+};
+
+static size_t alignSize(size_t size)
+{
+    return (size + ARCHIVE_ALIGNMENT - 1) & ~(size_t)(ARCHIVE_ALIGNMENT - 1);
+}
+
+// FNV-1a，模块名哈希只用于二分查找，相同哈希再比较模块名
+static uint64_t hashData(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+static uint64_t hashName(const char *name, size_t length)
+{
+    return hashData((const uint8_t *)name, length);
+}
+
+static int compareKey(uint64_t lhsHash, const char *lhsName, size_t lhsLength, uint64_t rhsHash, const char *rhsName,
+                      size_t rhsLength)
+{
+    if (lhsHash != rhsHash)
+    {
+        return lhsHash < rhsHash ? -1 : 1;
+    }
+    int result = memcmp(lhsName, rhsName, lhsLength < rhsLength ? lhsLength : rhsLength);
+    if (result)
+    {
+        return result;
+    }
+
+    return (lhsLength > rhsLength) - (lhsLength < rhsLength);
+}
+
+static int compareModule(const void *lhs, const void *rhs)
+{
+    const struct BuilderModule *lhsModule = *(const struct BuilderModule *const *)lhs;
+    const struct BuilderModule *rhsModule = *(const struct BuilderModule *const *)rhs;
+
+    return compareKey(lhsModule->nameHash, lhsModule->name, lhsModule->nameLength, rhsModule->nameHash,
+                      rhsModule->name, rhsModule->nameLength);
+}
+
+struct BytecodeArchiveBuilder *bytecodeArchiveBuilderCreate(const char *engineVersion)
+{
+    struct BytecodeArchiveBuilder *builder = calloc(1, sizeof(struct BytecodeArchiveBuilder));
+    if (!builder)
+    {
+        return NULL;
+    }
+    builder->engineVersion = strdup(engineVersion);
+    if (!builder->engineVersion)
+    {
+        free(builder);
+
+        return NULL;
+    }
+
+    return builder;
+}
+
+void bytecodeArchiveBuilderFree(struct BytecodeArchiveBuilder *builder)
+{
+    if (!builder)
+    {
+        return;
+    }
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        free(builder->moduleList[i].name);
+        free(builder->moduleList[i].data);
+    }
+    free(builder->moduleList);
+    free(builder->engineVersion);
+    free(builder);
+}
+
+// 构建时才调用，模块数量为几百的量级，线性查找即可
+bool bytecodeArchiveBuilderHasModule(const struct BytecodeArchiveBuilder *builder, const char *moduleName)
+{
+    size_t nameLength = strlen(moduleName);
+    uint64_t nameHash = hashName(moduleName, nameLength);
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        const struct BuilderModule *module = &builder->moduleList[i];
+        if (!compareKey(module->nameHash, module->name, module->nameLength, nameHash, moduleName, nameLength))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool bytecodeArchiveBuilderAddModule(struct BytecodeArchiveBuilder *builder, const char *moduleName,
+                                     const uint8_t *data, size_t size)
+{
+    if (builder->moduleCount == builder->moduleCapacity)
+    {
+        size_t capacity = builder->moduleCapacity ? builder->moduleCapacity * 2 : 16;
+        struct BuilderModule *list = realloc(builder->moduleList, capacity * sizeof(struct BuilderModule));
+        if (!list)
+        {
+            return false;
+        }
+        builder->moduleList = list;
+        builder->moduleCapacity = capacity;
+    }
+    struct BuilderModule *module = &builder->moduleList[builder->moduleCount];
+    module->name = strdup(moduleName);
+    // malloc(0) 可能返回 NULL
+    module->data = malloc(size ? size : 1);
+    if (!module->name || !module->data)
+    {
+        free(module->name);
+        free(module->data);
+
+        return false;
+    }
+    memcpy(module->data, data, size);
+    module->size = size;
+    module->nameLength = strlen(moduleName);
+    module->nameHash = hashName(moduleName, module->nameLength);
+    ++builder->moduleCount;
+
+    return true;
+}
+
+bool bytecodeArchiveBuilderWrite(const struct BytecodeArchiveBuilder *builder, const char *path)
+{
+    size_t engineVersionLength = strlen(builder->engineVersion);
+    size_t nameAreaSize = 0;
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        nameAreaSize += builder->moduleList[i].nameLength;
+    }
+    if (builder->moduleCount > UINT32_MAX || engineVersionLength > UINT32_MAX || nameAreaSize > UINT32_MAX)
+    {
+        return false;
+    }
+    const struct BuilderModule **sortedList = malloc((builder->moduleCount ? builder->moduleCount : 1) *
+                                                     sizeof(struct BuilderModule *));
+    if (!sortedList)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        sortedList[i] = &builder->moduleList[i];
+    }
+    qsort(sortedList, builder->moduleCount, sizeof(struct BuilderModule *), compareModule);
+    size_t tableOffset = sizeof(struct ArchiveHeader) + alignSize(engineVersionLength);
+    size_t nameAreaOffset = tableOffset + builder->moduleCount * sizeof(struct ArchiveEntry);
+    size_t fileSize = nameAreaOffset + alignSize(nameAreaSize);
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        fileSize += alignSize(sortedList[i]->size);
+    }
+    // 补齐部分为 0
+    uint8_t *buffer = calloc(1, fileSize);
+    if (!buffer)
+    {
+        free(sortedList);
+
+        return false;
+    }
+    struct ArchiveHeader *header = (struct ArchiveHeader *)buffer;
+    memcpy(header->magic, ARCHIVE_MAGIC, sizeof(header->magic));
+    header->formatVersion = ARCHIVE_FORMAT_VERSION;
+    header->entryCount = (uint32_t)builder->moduleCount;
+    header->engineVersionLength = (uint32_t)engineVersionLength;
+    header->nameAreaSize = (uint32_t)nameAreaSize;
+    header->fileSize = fileSize;
+    memcpy(buffer + sizeof(struct ArchiveHeader), builder->engineVersion, engineVersionLength);
+    struct ArchiveEntry *entryList = (struct ArchiveEntry *)(buffer + tableOffset);
+    size_t nameOffset = 0;
+    size_t offset = nameAreaOffset + alignSize(nameAreaSize);
+    for (size_t i = 0; i < builder->moduleCount; ++i)
+    {
+        const struct BuilderModule *module = sortedList[i];
+        entryList[i].nameHash = module->nameHash;
+        entryList[i].contentHash = hashData(module->data, module->size);
+        entryList[i].offset = offset;
+        entryList[i].size = module->size;
+        entryList[i].nameOffset = (uint32_t)nameOffset;
+        entryList[i].nameLength = (uint32_t)module->nameLength;
+        memcpy(buffer + nameAreaOffset + nameOffset, module->name, module->nameLength);
+        memcpy(buffer + offset, module->data, module->size);
+        nameOffset += module->nameLength;
+        offset += alignSize(module->size);
+    }
+    free(sortedList);
+    bool isSuccess = mappedFileWrite(path, NULL, 0, buffer, fileSize, true);
+    free(buffer);
+
+    return isSuccess;
+}
+
+// 只访问文件头和模块表，不访问字节码
+static bool checkArchive(const struct MappedFile *mappedFile, const char *engineVersion)
+{
+    if (mappedFile->size < sizeof(struct ArchiveHeader))
+    {
+        return false;
+    }
+    const struct ArchiveHeader *header = (const struct ArchiveHeader *)mappedFile->data;
+    size_t engineVersionLength = strlen(engineVersion);
+    if (memcmp(header->magic, ARCHIVE_MAGIC, sizeof(header->magic)) ||
+        header->formatVersion != ARCHIVE_FORMAT_VERSION || header->fileSize != mappedFile->size ||
+        header->engineVersionLength != engineVersionLength)
+    {
+        return false;
+    }
+    size_t tableOffset = sizeof(struct ArchiveHeader) + alignSize(engineVersionLength);
+    // 先除后比较，避免乘法溢出
+    if (tableOffset > mappedFile->size ||
+        header->entryCount > (mappedFile->size - tableOffset) / sizeof(struct ArchiveEntry))
+    {
+        return false;
+    }
+    size_t nameAreaOffset = tableOffset + header->entryCount * sizeof(struct ArchiveEntry);
+    if (header->nameAreaSize > mappedFile->size - nameAreaOffset ||
+        memcmp(mappedFile->data + sizeof(struct ArchiveHeader), engineVersion, engineVersionLength))
+    {
+        return false;
+    }
+    const struct ArchiveEntry *entryList = (const struct ArchiveEntry *)(mappedFile->data + tableOffset);
+    for (uint32_t i = 0; i < header->entryCount; ++i)
+    {
+        const struct ArchiveEntry *entry = &entryList[i];
+        if ((uint64_t)entry->nameOffset + entry->nameLength > header->nameAreaSize ||
+            entry->offset % ARCHIVE_ALIGNMENT || entry->offset > mappedFile->size ||
+            entry->size > mappedFile->size - entry->offset)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+struct BytecodeArchive *bytecodeArchiveOpen(const char *path, const char *engineVersion)
+{
+    struct MappedFile mappedFile;
+    if (!mappedFileOpen(path, true, &mappedFile))
+    {
+        return NULL;
+    }
+    struct BytecodeArchive *archive = checkArchive(&mappedFile, engineVersion)
+                                          ? malloc(sizeof(struct BytecodeArchive))
+                                          : NULL;
+    const struct ArchiveHeader *header = (const struct ArchiveHeader *)mappedFile.data;
+    atomic_bool *verifiedList =
+        archive ? malloc((header->entryCount ? header->entryCount : 1) * sizeof(atomic_bool)) : NULL;
+    if (!verifiedList)
+    {
+        free(archive);
+        mappedFileClose(&mappedFile);
+
+        return NULL;
+    }
+    size_t tableOffset = sizeof(struct ArchiveHeader) + alignSize(header->engineVersionLength);
+    archive->mappedFile = mappedFile;
+    archive->entryList = (const struct ArchiveEntry *)(mappedFile.data + tableOffset);
+    archive->nameArea = (const char *)(archive->entryList + header->entryCount);
+    archive->verifiedList = verifiedList;
+    archive->entryCount = header->entryCount;
+    for (uint32_t i = 0; i < archive->entryCount; ++i)
+    {
+        atomic_init(&verifiedList[i], false);
+    }
+    atomic_init(&archive->referenceCount, 1);
+
+    return archive;
+}
+
+struct BytecodeArchive *bytecodeArchiveRetain(struct BytecodeArchive *archive)
+{
+    if (archive)
+    {
+        atomic_fetch_add_explicit(&archive->referenceCount, 1, memory_order_relaxed);
+    }
+
+    return archive;
+}
+
+void bytecodeArchiveRelease(struct BytecodeArchive *archive)
+{
+    if (archive && atomic_fetch_sub_explicit(&archive->referenceCount, 1, memory_order_acq_rel) == 1)
+    {
+        mappedFileClose(&archive->mappedFile);
+        free(archive->verifiedList);
+        free(archive);
+    }
+}
+
+bool bytecodeArchiveFindModule(const struct BytecodeArchive *archive, const char *moduleName, uint32_t *moduleIndex)
+{
+    size_t nameLength = strlen(moduleName);
+    uint64_t nameHash = hashName(moduleName, nameLength);
+    size_t low = 0;
+    size_t high = archive->entryCount;
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        const struct ArchiveEntry *entry = &archive->entryList[middle];
+        int result = compareKey(nameHash, moduleName, nameLength, entry->nameHash, archive->nameArea + entry->nameOffset,
+                                entry->nameLength);
+        if (!result)
+        {
+            *moduleIndex = (uint32_t)middle;
+
+            return true;
+        }
+        if (result < 0)
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return false;
+}
+
+bool bytecodeArchiveLoadModule(const struct BytecodeArchive *archive, uint32_t moduleIndex, const uint8_t **data,
+                               size_t *size)
+{
+    const struct ArchiveEntry *entry = &archive->entryList[moduleIndex];
+    const uint8_t *moduleData = archive->mappedFile.data + entry->offset;
+    // 只预读这一个模块，其他模块保持在磁盘上
+    mappedFileWillNeed(&archive->mappedFile, entry->offset, entry->size);
+    if (!atomic_load_explicit(&archive->verifiedList[moduleIndex], memory_order_acquire))
+    {
+        // 校验会读入整个模块，之后执行时不会再次缺页
+        if (hashData(moduleData, entry->size) != entry->contentHash)
+        {
+            return false;
+        }
+        atomic_store_explicit(&archive->verifiedList[moduleIndex], true, memory_order_release);
+    }
+    *data = moduleData;
+    *size = entry->size;
+
+    return true;
+}
+
+struct BytecodeArchiveResultCache *bytecodeArchiveResultCacheCreate(void)
+{
+    return calloc(1, sizeof(struct BytecodeArchiveResultCache));
+}
+
+void bytecodeArchiveResultCacheFree(struct BytecodeArchiveResultCache *cache)
+{
+    if (!cache)
+    {
+        return;
+    }
+    for (size_t i = 0; i < cache->capacity; ++i)
+    {
+        bytecodeArchiveRelease(cache->entryList[i].archive);
+    }
+    free(cache->entryList);
+    free(cache);
+}
+
+// 指针低位对齐为 0，混合高位后加上模块下标
+static size_t getResultCacheIndex(const struct BytecodeArchiveResultCache *cache,
+                                  const struct BytecodeArchive *archive, uint32_t moduleIndex)
+{
+    uint64_t key = (uint64_t)(uintptr_t)archive;
+    key = (key ^ (key >> 16)) * 0x9e3779b97f4a7c15ULL + moduleIndex;
+
+    return (size_t)(key ^ (key >> 32)) & (cache->capacity - 1);
+}
+
+void *bytecodeArchiveResultCacheGet(const struct BytecodeArchiveResultCache *cache,
+                                    const struct BytecodeArchive *archive, uint32_t moduleIndex)
+{
+    if (!cache->count)
+    {
+        return NULL;
+    }
+    for (size_t index = getResultCacheIndex(cache, archive, moduleIndex); cache->entryList[index].archive;
+         index = (index + 1) & (cache->capacity - 1))
+    {
+        const struct ResultCacheEntry *entry = &cache->entryList[index];
+        if (entry->archive == archive && entry->moduleIndex == moduleIndex)
+        {
+            return entry->value;
+        }
+    }
+
+    return NULL;
+}
+
+static void insertResultCacheEntry(struct BytecodeArchiveResultCache *cache, struct ResultCacheEntry entry)
+{
+    size_t index = getResultCacheIndex(cache, entry.archive, entry.moduleIndex);
+    while (cache->entryList[index].archive)
+    {
+        index = (index + 1) & (cache->capacity - 1);
+    }
+    cache->entryList[index] = entry;
+    ++cache->count;
+}
+
+bool bytecodeArchiveResultCacheSet(struct BytecodeArchiveResultCache *cache, struct BytecodeArchive *archive,
+                                   uint32_t moduleIndex, void *value)
+{
+    // 负载因子不超过 1/2
+    if ((cache->count + 1) * 2 > cache->capacity)
+    {
+        size_t capacity = cache->capacity ? cache->capacity * 2 : 16;
+        struct BytecodeArchiveResultCache newCache = {calloc(capacity, sizeof(struct ResultCacheEntry)), capacity, 0};
+        if (!newCache.entryList)
+        {
+            return false;
+        }
+        for (size_t i = 0; i < cache->capacity; ++i)
+        {
+            if (cache->entryList[i].archive)
+            {
+                insertResultCacheEntry(&newCache, cache->entryList[i]);
+            }
+        }
+        free(cache->entryList);
+        *cache = newCache;
+    }
+    struct ResultCacheEntry entry = {bytecodeArchiveRetain(archive), value, moduleIndex};
+    insertResultCacheEntry(cache, entry);
+
+    return true;
+}
+
+// 引擎不支持时先于参数检查返回，和没有实现时的行为一致
+NAPI_EXPORT NAPIErrorStatus NAPICreateArchiveBuilder(NAPIArchiveBuilder *result)
+{
+    const char *engineVersion = bytecodeArchiveGetEngineVersion();
+    RETURN_STATUS_IF_FALSE(engineVersion, NAPIErrorGenericFailure)
+    CHECK_ARG(result, Error)
+
+    *result = (NAPIArchiveBuilder)bytecodeArchiveBuilderCreate(engineVersion);
+    RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIArchiveBuilderAddModule(NAPIArchiveBuilder builder, const char *moduleName,
+                                                        const uint8_t *byteBuffer, size_t bufferSize)
+{
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveGetEngineVersion(), NAPIErrorGenericFailure)
+    CHECK_ARG(builder, Error)
+    CHECK_ARG(moduleName, Error)
+    CHECK_ARG(byteBuffer, Error)
+
+    struct BytecodeArchiveBuilder *archiveBuilder = (struct BytecodeArchiveBuilder *)builder;
+    RETURN_STATUS_IF_FALSE(!bytecodeArchiveBuilderHasModule(archiveBuilder, moduleName), NAPIErrorInvalidArg)
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveBuilderAddModule(archiveBuilder, moduleName, byteBuffer, bufferSize),
+                           NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIArchiveBuilderWrite(NAPIArchiveBuilder builder, const char *path)
+{
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveGetEngineVersion(), NAPIErrorGenericFailure)
+    CHECK_ARG(builder, Error)
+    CHECK_ARG(path, Error)
+
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveBuilderWrite((struct BytecodeArchiveBuilder *)builder, path),
+                           NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeArchiveBuilder(NAPIArchiveBuilder builder)
+{
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveGetEngineVersion(), NAPICommonOK)
+    CHECK_ARG(builder, Common)
+
+    bytecodeArchiveBuilderFree((struct BytecodeArchiveBuilder *)builder);
+
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIOpenArchive(const char *path, NAPIArchive *result)
+{
+    const char *engineVersion = bytecodeArchiveGetEngineVersion();
+    RETURN_STATUS_IF_FALSE(engineVersion, NAPIErrorGenericFailure)
+    CHECK_ARG(path, Error)
+    CHECK_ARG(result, Error)
+
+    *result = (NAPIArchive)bytecodeArchiveOpen(path, engineVersion);
+    RETURN_STATUS_IF_FALSE(*result, NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPICommonStatus NAPICloseArchive(NAPIArchive archive)
+{
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveGetEngineVersion(), NAPICommonOK)
+    CHECK_ARG(archive, Common)
+
+    bytecodeArchiveRelease((struct BytecodeArchive *)archive);
+
+    return NAPICommonOK;
+}
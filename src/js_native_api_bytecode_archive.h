@@ -0,0 +1,75 @@
+#ifndef SRC_JS_NATIVE_API_BYTECODE_ARCHIVE_H_
+#define SRC_JS_NATIVE_API_BYTECODE_ARCHIVE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，QuickJS 和 Hermes 共用的多模块字节码归档
+// 文件布局（本机字节序，模块表记录每个模块的内容哈希）：
+// ArchiveHeader | engineVersion | ArchiveEntry * entryCount（按 nameHash + 模块名排序）| 模块名 | 字节码 ...
+// engineVersion 和模块名区域补齐到 8 字节，每个字节码的 offset 满足 8 字节对齐，Hermes 可以直接在映射内存上执行
+// 打开时只映射整个文件并且校验文件头和模块表，不预读；查找模块时二分模块表，加载时只预读该模块的页面并且
+// 第一次加载时校验内容哈希，没有执行的模块不会被读入内存
+struct BytecodeArchiveBuilder;
+
+struct BytecodeArchive;
+
+// 按模块缓存 NAPIRunArchiveModule 的结果，只在 env 线程访问
+struct BytecodeArchiveResultCache;
+
+struct BytecodeArchiveBuilder *bytecodeArchiveBuilderCreate(const char *engineVersion);
+
+// builder 可空
+void bytecodeArchiveBuilderFree(struct BytecodeArchiveBuilder *builder);
+
+bool bytecodeArchiveBuilderHasModule(const struct BytecodeArchiveBuilder *builder, const char *moduleName);
+
+// 复制 data，返回 false 代表内存不足，调用方需要先检查模块名是否重复
+bool bytecodeArchiveBuilderAddModule(struct BytecodeArchiveBuilder *builder, const char *moduleName,
+                                     const uint8_t *data, size_t size);
+
+// 写入临时文件 fsync 后 rename，返回 false 代表内存不足或者写入失败
+bool bytecodeArchiveBuilderWrite(const struct BytecodeArchiveBuilder *builder, const char *path);
+
+// 文件不存在、格式错误或者 engineVersion 不一致时返回 NULL，引用计数为 1
+struct BytecodeArchive *bytecodeArchiveOpen(const char *path, const char *engineVersion);
+
+// 多线程安全，archive 可空
+struct BytecodeArchive *bytecodeArchiveRetain(struct BytecodeArchive *archive);
+
+// 多线程安全，引用计数为 0 时解除映射，archive 可空
+void bytecodeArchiveRelease(struct BytecodeArchive *archive);
+
+// moduleIndex 在 archive 内唯一，可以作为缓存的 key
+bool bytecodeArchiveFindModule(const struct BytecodeArchive *archive, const char *moduleName, uint32_t *moduleIndex);
+
+// data 指向映射内存，在 archive 释放前有效，内容哈希不一致返回 false
+bool bytecodeArchiveLoadModule(const struct BytecodeArchive *archive, uint32_t moduleIndex, const uint8_t **data,
+                               size_t *size);
+
+// 返回 NULL 代表内存不足
+struct BytecodeArchiveResultCache *bytecodeArchiveResultCacheCreate(void);
+
+// 释放持有的 archive 引用，不处理 value，cache 可空
+void bytecodeArchiveResultCacheFree(struct BytecodeArchiveResultCache *cache);
+
+// 没有缓存返回 NULL
+void *bytecodeArchiveResultCacheGet(const struct BytecodeArchiveResultCache *cache,
+                                    const struct BytecodeArchive *archive, uint32_t moduleIndex);
+
+// 持有 archive 引用直到 cache 释放，调用方需要先检查没有缓存，返回 false 代表内存不足
+bool bytecodeArchiveResultCacheSet(struct BytecodeArchiveResultCache *cache, struct BytecodeArchive *archive,
+                                   uint32_t moduleIndex, void *value);
+
+// 由各引擎实现，NAPICreateArchiveBuilder 和 NAPIOpenArchive 使用，返回 NULL 代表引擎不支持字节码归档
+// 除 NAPIRunArchiveModule 外的归档 API 由本模块统一实现
+const char *bytecodeArchiveGetEngineVersion(void);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_BYTECODE_ARCHIVE_H_
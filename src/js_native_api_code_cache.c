@@ -0,0 +1,329 @@
+#include "js_native_api_code_cache.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define CODE_CACHE_MAGIC "NAPICODE"
+#define CODE_CACHE_SUFFIX ".cache"
+#define CODE_CACHE_VERSION_FILE "version"
+
+struct CodeCache
+{
+    char *directory;     // size_t
+    char *engineVersion; // size_t
+    size_t maxSize;      // size_t
+};
+
+// 40 字节，保证字节码 8 字节对齐
+struct CodeCacheHeader
+{
+    char magic[8];           // uint64_t
+    struct CodeCacheKey key; // uint64_t * 2
+    uint64_t byteBufferSize; // uint64_t
+    // 字节码的 FNV-1a，写入不 fsync，掉电后可能残留内容不完整的文件，读取前校验
+    uint64_t checksum; // uint64_t
+};
+
+struct CodeCacheEntry
+{
+    char name[NAME_MAX + 1];
+    off_t size;
+    struct timespec modifyTime;
+};
+
+static bool isEntryName(const char *name)
+{
+    size_t length = strlen(name);
+    size_t suffixLength = strlen(CODE_CACHE_SUFFIX);
+
+    return length > suffixLength && !strcmp(name + length - suffixLength, CODE_CACHE_SUFFIX);
+}
+
+// 写入中崩溃残留的临时文件
+static bool isTemporaryName(const char *name)
+{
+    return strstr(name, CODE_CACHE_SUFFIX ".tmp.") != NULL;
+}
+
+static bool getEntryPath(const struct CodeCache *codeCache, const struct CodeCacheKey *key, char *path, size_t size)
+{
+    int length = snprintf(path, size, "%s/%016llx%016llx" CODE_CACHE_SUFFIX, codeCache->directory,
+                          (unsigned long long)key->hash[0], (unsigned long long)key->hash[1]);
+
+    return length > 0 && (size_t)length < size;
+}
+
+static void removeAllEntries(const char *directory)
+{
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        return;
+    }
+    struct dirent *dirent;
+    while ((dirent = readdir(dir)))
+    {
+        if (isEntryName(dirent->d_name) || isTemporaryName(dirent->d_name))
+        {
+            unlinkat(dirfd(dir), dirent->d_name, 0);
+        }
+    }
+    closedir(dir);
+}
+
+// version 文件不存在或者不一致时视为引擎升级，旧字节码全部失效
+static bool checkEngineVersion(const char *directory, const char *engineVersion)
+{
+    char path[PATH_MAX];
+    int length = snprintf(path, sizeof(path), "%s/" CODE_CACHE_VERSION_FILE, directory);
+    if (length <= 0 || (size_t)length >= sizeof(path))
+    {
+        return false;
+    }
+    size_t engineVersionLength = strlen(engineVersion);
+    FILE *file = fopen(path, "rb");
+    if (file)
+    {
+        char version[256];
+        size_t versionLength = fread(version, 1, sizeof(version), file);
+        fclose(file);
+        if (versionLength == engineVersionLength && !memcmp(version, engineVersion, versionLength))
+        {
+            return true;
+        }
+    }
+    removeAllEntries(directory);
+
+    return mappedFileWrite(path, NULL, 0, engineVersion, engineVersionLength, false);
+}
+
+struct CodeCache *codeCacheCreate(const char *directory, const char *engineVersion, size_t maxSize)
+{
+    // 只创建最后一级目录
+    if (mkdir(directory, 0700) && errno != EEXIST)
+    {
+        return NULL;
+    }
+    struct stat directoryStat;
+    if (stat(directory, &directoryStat) || !S_ISDIR(directoryStat.st_mode) ||
+        !checkEngineVersion(directory, engineVersion))
+    {
+        return NULL;
+    }
+    struct CodeCache *codeCache = malloc(sizeof(struct CodeCache));
+    if (!codeCache)
+    {
+        return NULL;
+    }
+    codeCache->directory = strdup(directory);
+    codeCache->engineVersion = strdup(engineVersion);
+    codeCache->maxSize = maxSize ? maxSize : CODE_CACHE_DEFAULT_MAX_SIZE;
+    if (!codeCache->directory || !codeCache->engineVersion)
+    {
+        codeCacheFree(codeCache);
+
+        return NULL;
+    }
+
+    return codeCache;
+}
+
+void codeCacheFree(struct CodeCache *codeCache)
+{
+    if (!codeCache)
+    {
+        return;
+    }
+    free(codeCache->directory);
+    free(codeCache->engineVersion);
+    free(codeCache);
+}
+
+// FNV-1a 和乘法混合两路独立的 64 位哈希，只用于定位条目，不需要抗碰撞攻击
+static void hashUpdate(struct CodeCacheKey *key, const void *data, size_t size)
+{
+    const uint8_t *cursor = data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        key->hash[0] = (key->hash[0] ^ cursor[i]) * 0x100000001b3ULL;
+        uint64_t hash = (key->hash[1] ^ cursor[i]) * 0x9e3779b97f4a7c15ULL;
+        key->hash[1] = hash ^ (hash >> 29);
+    }
+}
+
+static uint64_t getChecksum(const uint8_t *data, size_t size)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash = (hash ^ data[i]) * 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+void codeCacheGetKey(const struct CodeCache *codeCache, const char *script, size_t scriptLength, const char *sourceUrl,
+                     uint32_t kind, struct CodeCacheKey *key)
+{
+    key->hash[0] = 0xcbf29ce484222325ULL;
+    key->hash[1] = 0x84222325cbf29ce4ULL;
+    // 包含结尾的 \0 作为分隔，避免拼接歧义
+    hashUpdate(key, codeCache->engineVersion, strlen(codeCache->engineVersion) + 1);
+    hashUpdate(key, sourceUrl, strlen(sourceUrl) + 1);
+    hashUpdate(key, &kind, sizeof(kind));
+    hashUpdate(key, &scriptLength, sizeof(scriptLength));
+    hashUpdate(key, script, scriptLength);
+}
+
+bool codeCacheOpen(const struct CodeCache *codeCache, const struct CodeCacheKey *key, struct MappedFile *mappedFile,
+                   size_t *offset)
+{
+    char path[PATH_MAX];
+    if (!getEntryPath(codeCache, key, path, sizeof(path)) || !mappedFileOpen(path, false, mappedFile))
+    {
+        return false;
+    }
+    const struct CodeCacheHeader *header = (const struct CodeCacheHeader *)mappedFile->data;
+    if (mappedFile->size <= sizeof(struct CodeCacheHeader) ||
+        memcmp(header->magic, CODE_CACHE_MAGIC, sizeof(header->magic)) ||
+        memcmp(&header->key, key, sizeof(struct CodeCacheKey)) ||
+        header->byteBufferSize != mappedFile->size - sizeof(struct CodeCacheHeader) ||
+        header->checksum != getChecksum(mappedFile->data + sizeof(struct CodeCacheHeader), header->byteBufferSize))
+    {
+        mappedFileClose(mappedFile);
+        unlink(path);
+
+        return false;
+    }
+    // 更新 mtime 作为 LRU 的访问时间，失败不影响结果
+    utimes(path, NULL);
+    *offset = sizeof(struct CodeCacheHeader);
+
+    return true;
+}
+
+void codeCacheRemove(const struct CodeCache *codeCache, const struct CodeCacheKey *key)
+{
+    char path[PATH_MAX];
+    if (getEntryPath(codeCache, key, path, sizeof(path)))
+    {
+        unlink(path);
+    }
+}
+
+// st_mtime 只有秒级精度，同一秒内的访问无法区分先后
+static struct timespec getModifyTime(const struct stat *entryStat)
+{
+#ifdef __APPLE__
+    return entryStat->st_mtimespec;
+#else
+    return entryStat->st_mtim;
+#endif
+}
+
+// 时间相同时按文件名排序，保证淘汰顺序稳定
+static int compareEntry(const void *lhs, const void *rhs)
+{
+    const struct CodeCacheEntry *lhsEntry = lhs;
+    const struct CodeCacheEntry *rhsEntry = rhs;
+    if (lhsEntry->modifyTime.tv_sec != rhsEntry->modifyTime.tv_sec)
+    {
+        return lhsEntry->modifyTime.tv_sec < rhsEntry->modifyTime.tv_sec ? -1 : 1;
+    }
+    if (lhsEntry->modifyTime.tv_nsec != rhsEntry->modifyTime.tv_nsec)
+    {
+        return lhsEntry->modifyTime.tv_nsec < rhsEntry->modifyTime.tv_nsec ? -1 : 1;
+    }
+
+    return strcmp(lhsEntry->name, rhsEntry->name);
+}
+
+// 只在写入新条目后调用，未命中本身需要编译，遍历目录的开销可以忽略
+// writtenName 为刚写入的条目，写入前已经保证不超过上限，淘汰其他条目即可
+static void evict(const struct CodeCache *codeCache, const char *writtenName)
+{
+    DIR *dir = opendir(codeCache->directory);
+    if (!dir)
+    {
+        return;
+    }
+    struct CodeCacheEntry *entryList = NULL;
+    size_t entryCount = 0;
+    size_t entryCapacity = 0;
+    size_t totalSize = 0;
+    struct dirent *dirent;
+    while ((dirent = readdir(dir)))
+    {
+        struct stat entryStat;
+        if (!isEntryName(dirent->d_name) || fstatat(dirfd(dir), dirent->d_name, &entryStat, 0))
+        {
+            continue;
+        }
+        if (entryCount == entryCapacity)
+        {
+            size_t capacity = entryCapacity ? entryCapacity * 2 : 16;
+            struct CodeCacheEntry *list = realloc(entryList, capacity * sizeof(struct CodeCacheEntry));
+            if (!list)
+            {
+                break;
+            }
+            entryList = list;
+            entryCapacity = capacity;
+        }
+        struct CodeCacheEntry *entry = &entryList[entryCount++];
+        strncpy(entry->name, dirent->d_name, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+        entry->size = entryStat.st_size;
+        entry->modifyTime = getModifyTime(&entryStat);
+        totalSize += (size_t)entryStat.st_size;
+    }
+    if (totalSize > codeCache->maxSize)
+    {
+        qsort(entryList, entryCount, sizeof(struct CodeCacheEntry), compareEntry);
+        for (size_t i = 0; i < entryCount && totalSize > codeCache->maxSize; ++i)
+        {
+            if (!strcmp(entryList[i].name, writtenName))
+            {
+                continue;
+            }
+            // 其他进程可能已经删除，忽略失败
+            unlinkat(dirfd(dir), entryList[i].name, 0);
+            totalSize -= (size_t)entryList[i].size;
+        }
+    }
+    free(entryList);
+    closedir(dir);
+}
+
+void codeCacheWrite(const struct CodeCache *codeCache, const struct CodeCacheKey *key, const uint8_t *data,
+                    size_t size)
+{
+    if (!size || sizeof(struct CodeCacheHeader) + size > codeCache->maxSize)
+    {
+        return;
+    }
+    char path[PATH_MAX];
+    if (!getEntryPath(codeCache, key, path, sizeof(path)))
+    {
+        return;
+    }
+    struct CodeCacheHeader header;
+    memcpy(header.magic, CODE_CACHE_MAGIC, sizeof(header.magic));
+    header.key = *key;
+    header.byteBufferSize = size;
+    header.checksum = getChecksum(data, size);
+    // 在 JS 线程上，不 fsync，损坏的文件由 checksum 发现
+    if (mappedFileWrite(path, &header, sizeof(header), data, size, false))
+    {
+        evict(codeCache, strrchr(path, '/') + 1);
+    }
+}
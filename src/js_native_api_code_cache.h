@@ -0,0 +1,53 @@
+#ifndef SRC_JS_NATIVE_API_CODE_CACHE_H_
+#define SRC_JS_NATIVE_API_CODE_CACHE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+#include "js_native_api_mapped_file.h"
+
+// 私有头文件，QuickJS 和 Hermes 共用的磁盘字节码缓存
+// 每个条目为目录下的 <key>.cache 文件，key 为引擎版本 + sourceUrl + kind + 源码的 128 位哈希
+// 文件内容为 CodeCacheHeader + 字节码，写入临时文件后 rename，读取方不会看到写了一半的文件
+// 写入在 JS 线程上，不 fsync，打开时校验字节码的 checksum，掉电等原因损坏的条目视为未命中并删除
+// 命中时更新 mtime，写入后按纳秒精度的 mtime 从旧到新淘汰其他条目，直到总大小不超过上限
+// 创建后只读，可以多线程使用，多个进程共用同一个目录也是安全的
+struct CodeCache;
+
+struct CodeCacheKey
+{
+    uint64_t hash[2]; // uint64_t * 2
+};
+
+#define CODE_CACHE_DEFAULT_MAX_SIZE (32 * 1024 * 1024)
+
+// 目录不存在时创建，目录下 version 文件和 engineVersion 不一致时清空全部条目
+// maxSize 为 0 使用默认值，返回 NULL 代表目录不可用或者内存不足
+struct CodeCache *codeCacheCreate(const char *directory, const char *engineVersion, size_t maxSize);
+
+// codeCache 可空
+void codeCacheFree(struct CodeCache *codeCache);
+
+// kind 区分同一源码的不同编译方式（比如脚本和模块），由引擎自行定义
+void codeCacheGetKey(const struct CodeCache *codeCache, const char *script, size_t scriptLength, const char *sourceUrl,
+                     uint32_t kind, struct CodeCacheKey *key);
+
+// 命中时映射整个文件，字节码位于 mappedFile->data + *offset，offset 满足 8 字节对齐，调用方负责 mappedFileClose
+bool codeCacheOpen(const struct CodeCache *codeCache, const struct CodeCacheKey *key, struct MappedFile *mappedFile,
+                   size_t *offset);
+
+// 引擎拒绝加载时调用，删除条目
+void codeCacheRemove(const struct CodeCache *codeCache, const struct CodeCacheKey *key);
+
+// 写入失败或者超过上限时直接放弃，不影响执行
+void codeCacheWrite(const struct CodeCache *codeCache, const struct CodeCacheKey *key, const uint8_t *data,
+                    size_t size);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_CODE_CACHE_H_
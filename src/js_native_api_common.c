@@ -83,3 +83,11 @@ NAPIExceptionStatus NAPIParseUTF8JSONString(NAPIEnv env, const char *utf8String,
 
     return NAPIExceptionOK;
 }
+
+#ifndef NAPI_INSTRUMENTATION
+// 开启 napi_instrumentation 时由 js_native_api_instrument.c 实现
+NAPIErrorStatus NAPIGetCallStats(__attribute__((unused)) NAPICallStats *stats, __attribute__((unused)) size_t *count)
+{
+    return NAPIErrorGenericFailure;
+}
+#endif
@@ -0,0 +1,233 @@
+#include "js_native_api_cpu_profile.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace/js_native_api_output.h"
+
+// 0 号节点为 (root)，不会成为子节点，所以 0 也代表没有子节点/兄弟节点
+struct CPUProfileNode
+{
+    char *functionName;        // size_t
+    char *url;                 // size_t
+    int32_t lineNumber;        // int32_t
+    int32_t columnNumber;      // int32_t
+    uint32_t firstChildIndex;  // uint32_t
+    uint32_t nextSiblingIndex; // uint32_t
+    uint32_t hitCount;         // uint32_t
+};
+
+struct CPUProfile
+{
+    struct CPUProfileNode *nodeList; // size_t
+    // 每次采样的栈顶节点下标
+    uint32_t *sampleList; // size_t
+    // 和上一次采样的时间间隔
+    uint32_t *timeDeltaList; // size_t
+    uint64_t sampleIntervalUs;
+    uint64_t startTime;
+    uint64_t lastSampleTime;
+    uint32_t nodeCount;
+    uint32_t nodeCapacity;
+    uint32_t sampleCount;
+    uint32_t sampleCapacity;
+};
+
+static bool initNode(struct CPUProfileNode *node, const struct CPUProfileFrame *frame)
+{
+    node->functionName = strdup(frame->functionName ? frame->functionName : "");
+    node->url = strdup(frame->url ? frame->url : "");
+    if (!node->functionName || !node->url)
+    {
+        free(node->functionName);
+        free(node->url);
+
+        return false;
+    }
+    node->lineNumber = frame->lineNumber;
+    node->columnNumber = frame->columnNumber;
+    node->firstChildIndex = 0;
+    node->nextSiblingIndex = 0;
+    node->hitCount = 0;
+
+    return true;
+}
+
+struct CPUProfile *cpuProfileCreate(uint32_t sampleIntervalUs)
+{
+    struct CPUProfile *profile = malloc(sizeof(struct CPUProfile));
+    if (!profile)
+    {
+        return NULL;
+    }
+    profile->nodeList = malloc(sizeof(struct CPUProfileNode));
+    struct CPUProfileFrame rootFrame = {"(root)", "", -1, -1};
+    if (!profile->nodeList || !initNode(profile->nodeList, &rootFrame))
+    {
+        free(profile->nodeList);
+        free(profile);
+
+        return NULL;
+    }
+    profile->nodeCount = 1;
+    profile->nodeCapacity = 1;
+    profile->sampleList = NULL;
+    profile->timeDeltaList = NULL;
+    profile->sampleCount = 0;
+    profile->sampleCapacity = 0;
+    profile->sampleIntervalUs = sampleIntervalUs ? sampleIntervalUs : CPU_PROFILE_DEFAULT_SAMPLE_INTERVAL_US;
+    profile->startTime = outputGetMicroseconds();
+    profile->lastSampleTime = profile->startTime;
+
+    return profile;
+}
+
+void cpuProfileFree(struct CPUProfile *profile)
+{
+    if (!profile)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < profile->nodeCount; ++i)
+    {
+        free(profile->nodeList[i].functionName);
+        free(profile->nodeList[i].url);
+    }
+    free(profile->nodeList);
+    free(profile->sampleList);
+    free(profile->timeDeltaList);
+    free(profile);
+}
+
+bool cpuProfileIsSampleDue(struct CPUProfile *profile)
+{
+    return outputGetMicroseconds() - profile->lastSampleTime >= profile->sampleIntervalUs;
+}
+
+// 返回 0 代表内存不足
+static uint32_t getChildIndex(struct CPUProfile *profile, uint32_t parentIndex, const struct CPUProfileFrame *frame)
+{
+    const char *functionName = frame->functionName ? frame->functionName : "";
+    const char *url = frame->url ? frame->url : "";
+    for (uint32_t index = profile->nodeList[parentIndex].firstChildIndex; index;
+         index = profile->nodeList[index].nextSiblingIndex)
+    {
+        struct CPUProfileNode *node = &profile->nodeList[index];
+        if (node->lineNumber == frame->lineNumber && node->columnNumber == frame->columnNumber &&
+            !strcmp(node->functionName, functionName) && !strcmp(node->url, url))
+        {
+            return index;
+        }
+    }
+    if (profile->nodeCount == profile->nodeCapacity)
+    {
+        struct CPUProfileNode *nodeList =
+            realloc(profile->nodeList, sizeof(struct CPUProfileNode) * profile->nodeCapacity * 2);
+        if (!nodeList)
+        {
+            return 0;
+        }
+        profile->nodeList = nodeList;
+        profile->nodeCapacity *= 2;
+    }
+    uint32_t index = profile->nodeCount;
+    if (!initNode(&profile->nodeList[index], frame))
+    {
+        return 0;
+    }
+    ++profile->nodeCount;
+    profile->nodeList[index].nextSiblingIndex = profile->nodeList[parentIndex].firstChildIndex;
+    profile->nodeList[parentIndex].firstChildIndex = index;
+
+    return index;
+}
+
+bool cpuProfileAddSample(struct CPUProfile *profile, const struct CPUProfileFrame *frames, size_t frameCount)
+{
+    uint64_t now = outputGetMicroseconds();
+    if (profile->sampleCount == profile->sampleCapacity)
+    {
+        uint32_t sampleCapacity = profile->sampleCapacity ? profile->sampleCapacity * 2 : 1024;
+        uint32_t *sampleList = realloc(profile->sampleList, sizeof(uint32_t) * sampleCapacity);
+        if (!sampleList)
+        {
+            return false;
+        }
+        profile->sampleList = sampleList;
+        uint32_t *timeDeltaList = realloc(profile->timeDeltaList, sizeof(uint32_t) * sampleCapacity);
+        if (!timeDeltaList)
+        {
+            return false;
+        }
+        profile->timeDeltaList = timeDeltaList;
+        profile->sampleCapacity = sampleCapacity;
+    }
+    if (frameCount > CPU_PROFILE_MAX_FRAME_COUNT)
+    {
+        frameCount = CPU_PROFILE_MAX_FRAME_COUNT;
+    }
+    // 从栈底开始查找路径，中途内存不足时已经创建的节点保留，hitCount 为 0 不影响结果
+    uint32_t index = 0;
+    for (size_t i = frameCount; i > 0; --i)
+    {
+        index = getChildIndex(profile, index, &frames[i - 1]);
+        if (!index)
+        {
+            return false;
+        }
+    }
+    ++profile->nodeList[index].hitCount;
+    profile->sampleList[profile->sampleCount] = index;
+    profile->timeDeltaList[profile->sampleCount] = (uint32_t)(now - profile->lastSampleTime);
+    ++profile->sampleCount;
+    profile->lastSampleTime = now;
+
+    return true;
+}
+
+static void writeProfile(struct CPUProfile *profile, FILE *file)
+{
+    fputs("{\"nodes\":[", file);
+    for (uint32_t i = 0; i < profile->nodeCount; ++i)
+    {
+        const struct CPUProfileNode *node = &profile->nodeList[i];
+        // 节点 id 从 1 开始
+        fprintf(file, "%s{\"id\":%u,\"callFrame\":{\"functionName\":", i ? "," : "", i + 1);
+        outputWriteString(file, node->functionName);
+        // scriptId 不可知，DevTools 使用 url 定位源码
+        fputs(",\"scriptId\":\"0\",\"url\":", file);
+        outputWriteString(file, node->url);
+        fprintf(file, ",\"lineNumber\":%d,\"columnNumber\":%d},\"hitCount\":%u,\"children\":[", node->lineNumber,
+                node->columnNumber, node->hitCount);
+        for (uint32_t index = node->firstChildIndex; index; index = profile->nodeList[index].nextSiblingIndex)
+        {
+            fprintf(file, "%s%u", index == node->firstChildIndex ? "" : ",", index + 1);
+        }
+        fputs("]}", file);
+    }
+    fprintf(file, "],\"startTime\":%llu,\"endTime\":%llu,\"samples\":[", (unsigned long long)profile->startTime,
+            (unsigned long long)outputGetMicroseconds());
+    for (uint32_t i = 0; i < profile->sampleCount; ++i)
+    {
+        fprintf(file, "%s%u", i ? "," : "", profile->sampleList[i] + 1);
+    }
+    fputs("],\"timeDeltas\":[", file);
+    for (uint32_t i = 0; i < profile->sampleCount; ++i)
+    {
+        fprintf(file, "%s%u", i ? "," : "", profile->timeDeltaList[i]);
+    }
+    fputs("]}", file);
+}
+
+bool cpuProfileWrite(struct CPUProfile *profile, int fd)
+{
+    FILE *file = outputOpenFile(fd);
+    if (!file)
+    {
+        return false;
+    }
+    writeProfile(profile, file);
+
+    return outputCloseFile(file);
+}
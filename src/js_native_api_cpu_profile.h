@@ -0,0 +1,49 @@
+#ifndef SRC_JS_NATIVE_API_CPU_PROFILE_H_
+#define SRC_JS_NATIVE_API_CPU_PROFILE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，采样结果构造为调用树，输出 Chrome DevTools .cpuprofile 格式
+// 只在 env 线程访问，不加锁
+struct CPUProfile;
+
+// 默认采样间隔
+#define CPU_PROFILE_DEFAULT_SAMPLE_INTERVAL_US 1000
+
+// 单次采样最多记录的栈帧数量，超出部分丢弃最外层
+#define CPU_PROFILE_MAX_FRAME_COUNT 128
+
+struct CPUProfileFrame
+{
+    const char *functionName; // size_t
+    const char *url;          // size_t
+    // 从 0 开始，未知为 -1
+    int32_t lineNumber;   // int32_t
+    int32_t columnNumber; // int32_t
+};
+
+// sampleIntervalUs 为 0 使用默认值，返回 NULL 代表内存不足
+struct CPUProfile *cpuProfileCreate(uint32_t sampleIntervalUs);
+
+// profile 可空
+void cpuProfileFree(struct CPUProfile *profile);
+
+// 距离上次采样超过采样间隔时返回 true
+bool cpuProfileIsSampleDue(struct CPUProfile *profile);
+
+// frames 从栈顶到栈底，和 Error.prototype.stack 顺序相同，字符串会被复制
+// 返回 false 代表内存不足，本次采样丢弃
+bool cpuProfileAddSample(struct CPUProfile *profile, const struct CPUProfileFrame *frames, size_t frameCount);
+
+// 写入 fd，不会关闭 fd，返回 false 代表写入失败
+bool cpuProfileWrite(struct CPUProfile *profile, int fd);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_CPU_PROFILE_H_
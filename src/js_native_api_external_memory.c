@@ -0,0 +1,72 @@
+#include "js_native_api_external_memory.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+
+struct ExternalMemory
+{
+    _Atomic(int64_t) totalSize;
+    atomic_size_t referenceCount;
+    // 上次触发 GC 时的总量，只在 JS 线程访问
+    int64_t baselineSize;
+    int64_t softLimit;
+};
+
+struct ExternalMemory *externalMemoryCreate(size_t softLimit)
+{
+    struct ExternalMemory *externalMemory = malloc(sizeof(struct ExternalMemory));
+    if (!externalMemory)
+    {
+        return NULL;
+    }
+    atomic_init(&externalMemory->totalSize, 0);
+    atomic_init(&externalMemory->referenceCount, 1);
+    externalMemory->baselineSize = 0;
+    if (!softLimit)
+    {
+        softLimit = EXTERNAL_MEMORY_DEFAULT_LIMIT;
+    }
+    externalMemory->softLimit = softLimit < INT64_MAX ? (int64_t)softLimit : INT64_MAX;
+
+    return externalMemory;
+}
+
+struct ExternalMemory *externalMemoryRetain(struct ExternalMemory *externalMemory)
+{
+    if (externalMemory)
+    {
+        atomic_fetch_add_explicit(&externalMemory->referenceCount, 1, memory_order_relaxed);
+    }
+
+    return externalMemory;
+}
+
+void externalMemoryRelease(struct ExternalMemory *externalMemory)
+{
+    if (externalMemory && atomic_fetch_sub_explicit(&externalMemory->referenceCount, 1, memory_order_acq_rel) == 1)
+    {
+        free(externalMemory);
+    }
+}
+
+int64_t externalMemoryAdjust(struct ExternalMemory *externalMemory, int64_t changeInBytes)
+{
+    return atomic_fetch_add_explicit(&externalMemory->totalSize, changeInBytes, memory_order_relaxed) + changeInBytes;
+}
+
+bool externalMemoryCheckPressure(struct ExternalMemory *externalMemory)
+{
+    int64_t totalSize = atomic_load_explicit(&externalMemory->totalSize, memory_order_relaxed);
+    // GC 回收后基线跟随下降
+    if (totalSize < externalMemory->baselineSize)
+    {
+        externalMemory->baselineSize = totalSize;
+    }
+    if (totalSize - externalMemory->baselineSize <= externalMemory->softLimit)
+    {
+        return false;
+    }
+    externalMemory->baselineSize = totalSize;
+
+    return true;
+}
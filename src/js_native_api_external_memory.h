@@ -0,0 +1,39 @@
+#ifndef SRC_JS_NATIVE_API_EXTERNAL_MEMORY_H_
+#define SRC_JS_NATIVE_API_EXTERNAL_MEMORY_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，三个引擎共用的外部内存统计
+// External 只占用少量引擎内存，引擎感知不到 native 内存压力，需要额外统计并且交给引擎的 GC 启发式
+// 和 FinalizerQueue 一样，对象可能比 env 存活更久，所以使用引用计数
+// 创建者（QuickJS 为 runtime，其他引擎为 env）持有一个引用，每个 externalMemorySize 非 0 的 External 持有一个引用
+struct ExternalMemory;
+
+// NAPIRuntimeConfig.externalMemoryLimit 为 0 时的默认值
+#define EXTERNAL_MEMORY_DEFAULT_LIMIT (64 * 1024 * 1024)
+
+// softLimit 为 0 使用 EXTERNAL_MEMORY_DEFAULT_LIMIT
+// 返回 NULL 代表内存不足，返回的统计引用计数为 1
+struct ExternalMemory *externalMemoryCreate(size_t softLimit);
+
+// 返回 externalMemory 自身，externalMemory 可空
+struct ExternalMemory *externalMemoryRetain(struct ExternalMemory *externalMemory);
+
+// externalMemory 可空
+void externalMemoryRelease(struct ExternalMemory *externalMemory);
+
+// 可以在 GC 中调用，返回调整后的总量
+int64_t externalMemoryAdjust(struct ExternalMemory *externalMemory, int64_t changeInBytes);
+
+// JS 线程调用，自上次返回 true 以来增长超过软上限返回 true，调用方需要让引擎尽快 GC
+bool externalMemoryCheckPressure(struct ExternalMemory *externalMemory);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_EXTERNAL_MEMORY_H_
@@ -0,0 +1,204 @@
+#include "js_native_api_finalizer_queue.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+// handle scope 关闭时最多执行的数量
+#define SAFE_POINT_BUDGET 64
+
+struct FinalizerNode
+{
+    struct FinalizerNode *next;    // size_t
+    NAPIFinalize finalizeCallback; // size_t
+    void *finalizeData;            // size_t
+    void *finalizeHint;            // size_t
+};
+
+struct FinalizerQueue
+{
+    // 无锁栈，GC 入队，drain 时整体取出
+    _Atomic(struct FinalizerNode *) head;
+    // 已经取出但是没有执行完的节点，先进先出，只在 env 线程访问
+    struct FinalizerNode *localHead;
+    atomic_size_t referenceCount;
+    atomic_int mode;
+    atomic_size_t pendingCount;
+    atomic_size_t maxPendingCount;
+    _Atomic(uint64_t) enqueuedCount;
+    // 以下只在 env 线程访问
+    uint64_t runCount;
+    uint64_t drainCount;
+    uint64_t totalDrainNanoseconds;
+    uint64_t lastDrainNanoseconds;
+};
+
+static uint64_t getNanoseconds(void)
+{
+    struct timespec timespec;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+
+    return (uint64_t)timespec.tv_sec * 1000000000 + (uint64_t)timespec.tv_nsec;
+}
+
+struct FinalizerQueue *finalizerQueueCreate(void)
+{
+    struct FinalizerQueue *queue = malloc(sizeof(struct FinalizerQueue));
+    if (!queue)
+    {
+        return NULL;
+    }
+    atomic_init(&queue->head, NULL);
+    queue->localHead = NULL;
+    atomic_init(&queue->referenceCount, 1);
+    atomic_init(&queue->mode, NAPIFinalizerModeSync);
+    atomic_init(&queue->pendingCount, 0);
+    atomic_init(&queue->maxPendingCount, 0);
+    atomic_init(&queue->enqueuedCount, 0);
+    queue->runCount = 0;
+    queue->drainCount = 0;
+    queue->totalDrainNanoseconds = 0;
+    queue->lastDrainNanoseconds = 0;
+
+    return queue;
+}
+
+struct FinalizerQueue *finalizerQueueRetain(struct FinalizerQueue *queue)
+{
+    if (queue)
+    {
+        atomic_fetch_add_explicit(&queue->referenceCount, 1, memory_order_relaxed);
+    }
+
+    return queue;
+}
+
+void finalizerQueueRelease(struct FinalizerQueue *queue)
+{
+    if (queue && atomic_fetch_sub_explicit(&queue->referenceCount, 1, memory_order_acq_rel) == 1)
+    {
+        // 最后一个引用，队列必然已经 close 并且为空
+        free(queue);
+    }
+}
+
+void finalizerQueueSetMode(struct FinalizerQueue *queue, NAPIFinalizerMode mode)
+{
+    atomic_store_explicit(&queue->mode, mode, memory_order_relaxed);
+}
+
+void finalizerQueueFinalize(struct FinalizerQueue *queue, NAPIFinalize finalizeCallback, void *finalizeData,
+                            void *finalizeHint)
+{
+    if (queue && atomic_load_explicit(&queue->mode, memory_order_relaxed) == NAPIFinalizerModeDeferred)
+    {
+        struct FinalizerNode *node = malloc(sizeof(struct FinalizerNode));
+        // 内存不足时退化为同步调用
+        if (node)
+        {
+            node->finalizeCallback = finalizeCallback;
+            node->finalizeData = finalizeData;
+            node->finalizeHint = finalizeHint;
+            node->next = atomic_load_explicit(&queue->head, memory_order_relaxed);
+            while (!atomic_compare_exchange_weak_explicit(&queue->head, &node->next, node, memory_order_release,
+                                                          memory_order_relaxed))
+            {
+            }
+            atomic_fetch_add_explicit(&queue->enqueuedCount, 1, memory_order_relaxed);
+            size_t pendingCount = atomic_fetch_add_explicit(&queue->pendingCount, 1, memory_order_relaxed) + 1;
+            size_t maxPendingCount = atomic_load_explicit(&queue->maxPendingCount, memory_order_relaxed);
+            while (pendingCount > maxPendingCount &&
+                   !atomic_compare_exchange_weak_explicit(&queue->maxPendingCount, &maxPendingCount, pendingCount,
+                                                          memory_order_relaxed, memory_order_relaxed))
+            {
+            }
+
+            // 引用转移给 node
+            return;
+        }
+    }
+    finalizeCallback(finalizeData, finalizeHint);
+    finalizerQueueRelease(queue);
+}
+
+// 取出无锁栈中的全部节点并反转为入队顺序
+static void takeNodes(struct FinalizerQueue *queue)
+{
+    struct FinalizerNode *node = atomic_exchange_explicit(&queue->head, NULL, memory_order_acquire);
+    struct FinalizerNode *reversedNode = NULL;
+    while (node)
+    {
+        struct FinalizerNode *next = node->next;
+        node->next = reversedNode;
+        reversedNode = node;
+        node = next;
+    }
+    queue->localHead = reversedNode;
+}
+
+size_t finalizerQueueDrain(struct FinalizerQueue *queue, size_t budget)
+{
+    if (!queue->localHead && !atomic_load_explicit(&queue->head, memory_order_relaxed))
+    {
+        return 0;
+    }
+    uint64_t begin = getNanoseconds();
+    size_t count = 0;
+    while (!budget || count < budget)
+    {
+        if (!queue->localHead)
+        {
+            takeNodes(queue);
+            if (!queue->localHead)
+            {
+                break;
+            }
+        }
+        struct FinalizerNode *node = queue->localHead;
+        // finalizer 可能重入 drain，先出队
+        queue->localHead = node->next;
+        atomic_fetch_sub_explicit(&queue->pendingCount, 1, memory_order_relaxed);
+        node->finalizeCallback(node->finalizeData, node->finalizeHint);
+        free(node);
+        ++count;
+        ++queue->runCount;
+        // env 持有引用，这里不会归零
+        finalizerQueueRelease(queue);
+    }
+    queue->lastDrainNanoseconds = getNanoseconds() - begin;
+    queue->totalDrainNanoseconds += queue->lastDrainNanoseconds;
+    ++queue->drainCount;
+
+    return atomic_load_explicit(&queue->pendingCount, memory_order_relaxed);
+}
+
+void finalizerQueueDrainAtSafePoint(struct FinalizerQueue *queue)
+{
+    if (queue && atomic_load_explicit(&queue->mode, memory_order_relaxed) == NAPIFinalizerModeDeferred)
+    {
+        finalizerQueueDrain(queue, SAFE_POINT_BUDGET);
+    }
+}
+
+void finalizerQueueGetStats(struct FinalizerQueue *queue, NAPIFinalizerStats *stats)
+{
+    stats->pendingCount = atomic_load_explicit(&queue->pendingCount, memory_order_relaxed);
+    stats->maxPendingCount = atomic_load_explicit(&queue->maxPendingCount, memory_order_relaxed);
+    stats->enqueuedCount = atomic_load_explicit(&queue->enqueuedCount, memory_order_relaxed);
+    stats->runCount = queue->runCount;
+    stats->drainCount = queue->drainCount;
+    stats->totalDrainNanoseconds = queue->totalDrainNanoseconds;
+    stats->lastDrainNanoseconds = queue->lastDrainNanoseconds;
+}
+
+void finalizerQueueClose(struct FinalizerQueue *queue)
+{
+    if (!queue)
+    {
+        return;
+    }
+    finalizerQueueSetMode(queue, NAPIFinalizerModeSync);
+    finalizerQueueDrain(queue, 0);
+    finalizerQueueRelease(queue);
+}
@@ -0,0 +1,46 @@
+#ifndef SRC_JS_NATIVE_API_FINALIZER_QUEUE_H_
+#define SRC_JS_NATIVE_API_FINALIZER_QUEUE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，三个引擎共用的延迟 finalizer 队列
+// 生产者为 GC（JavaScriptCore 可能在其他线程），使用无锁栈入队，消费者只能是 env 所在线程
+// 对象可能比 env 存活更久（QuickJS 同一个 runtime 多个 env），所以队列使用引用计数
+// env 持有一个引用，每个设置了 finalizeCallback 的 ExternalInfo/NativeInfo 持有一个引用
+struct FinalizerQueue;
+
+// 返回 NULL 代表内存不足，返回的队列引用计数为 1
+struct FinalizerQueue *finalizerQueueCreate(void);
+
+// 返回 queue 自身，queue 可空
+struct FinalizerQueue *finalizerQueueRetain(struct FinalizerQueue *queue);
+
+// queue 可空
+void finalizerQueueRelease(struct FinalizerQueue *queue);
+
+void finalizerQueueSetMode(struct FinalizerQueue *queue, NAPIFinalizerMode mode);
+
+// GC 中调用，延迟模式下入队，否则或者内存不足时同步调用
+// 会消耗调用方持有的一个引用，queue 可空
+void finalizerQueueFinalize(struct FinalizerQueue *queue, NAPIFinalize finalizeCallback, void *finalizeData,
+                            void *finalizeHint);
+
+// budget 为 0 代表全部执行，返回剩余数量
+size_t finalizerQueueDrain(struct FinalizerQueue *queue, size_t budget);
+
+// 最外层 handle scope 关闭时调用，只执行有限数量，避免长时间阻塞
+void finalizerQueueDrainAtSafePoint(struct FinalizerQueue *queue);
+
+void finalizerQueueGetStats(struct FinalizerQueue *queue, NAPIFinalizerStats *stats);
+
+// env 销毁时调用，执行剩余 finalizer，之后的 finalizer 同步调用，并且释放 env 持有的引用
+void finalizerQueueClose(struct FinalizerQueue *queue);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_FINALIZER_QUEUE_H_
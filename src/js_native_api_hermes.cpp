@@ -1,6 +1,15 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <hermes/BCGen/HBC/BytecodeDataProvider.h>
+#include <hermes/BCGen/HBC/BytecodeFileFormat.h>
 #include <hermes/BCGen/HBC/BytecodeProviderFromSrc.h>
+#include <hermes/BCGen/HBC/BytecodeVersion.h>
+#include <hermes/BCGen/HBC/HBC.h>
 #include <hermes/Public/GCConfig.h>
 #include <hermes/VM/Callable.h>
+#include <hermes/VM/DecoratedObject.h>
 #include <hermes/VM/GCBase.h>
 #include <hermes/VM/HostModel.h>
 #include <hermes/VM/JSArray.h>
@@ -10,26 +19,40 @@
 #include <hermes/VM/WeakRef.h>
 #include <hermes/hermes.h>
 #include <jsi/decorator.h>
+#include <limits>
 #include <llvh/Support/ConvertUTF.h>
+#include <llvh/Support/SHA1.h>
+#include <llvh/Support/raw_ostream.h>
+#include <memory>
+#include <mutex>
 #include <napi/js_native_api.h>
 #include <napi/js_native_api_debugger.h>
 #include <napi/js_native_api_debugger_hermes_types.h>
-#include <sys/queue.h>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <unistd.h>
 #include <unordered_set>
+#include <vector>
 
 // private header
 #include "inspector/js_native_api_hermes_inspector.h"
+#include "js_native_api_bytecode_archive.h"
+#include "js_native_api_code_cache.h"
+#include "js_native_api_external_memory.h"
+#include "js_native_api_finalizer_queue.h"
+#include "js_native_api_mapped_file.h"
+#include "js_native_api_reference_table.h"
+#include "js_native_api_script_source.h"
+#include "js_native_api_thread_pool.h"
+#include "trace/js_native_api_trace.h"
+#include "trace/js_native_api_usdt.h"
 
 #ifdef HERMES_ENABLE_DEBUGGER
 #include <cxxreact/MessageQueueThread.h>
 #include <hermes/inspector/RuntimeAdapter.h>
 #endif
 
-#ifndef LIST_FOREACH_SAFE
-#define LIST_FOREACH_SAFE(var, head, field, tvar)                                                                      \
-    for ((var) = LIST_FIRST((head)); (var) && ((tvar) = LIST_NEXT((var), field), 1); (var) = (tvar))
-#endif
-
 #include <utility>
 
 #define RETURN_STATUS_IF_FALSE(condition, status)                                                                      \
@@ -65,40 +88,225 @@
 
 namespace
 {
-class External final : public hermes::vm::HostObjectProxy
+// External 和 napi_wrap 均存储在 DecoratedObject 的 decoration 中
+// External 不再使用 HostObject，避免 get/set/getHostPropertyNames 虚函数和枚举时创建 JSArray
+class NativeInfo final : public hermes::vm::DecoratedObject::Decoration
 {
   public:
-    External(hermes::vm::Runtime *runtime, void *data, NAPIFinalize finalizeCallback, void *finalizeHint);
+    // 有 finalizeCallback 时持有 finalizerQueue，对象销毁时交给队列处理
+    // externalMemorySize 非 0 时持有 externalMemory，对象销毁时扣除
+    NativeInfo(void *data, NAPIFinalize finalizeCallback, void *finalizeHint, bool isExternal,
+               FinalizerQueue *finalizerQueue, ExternalMemory *externalMemory = nullptr,
+               size_t externalMemorySize = 0)
+        : data(data), finalizeCallback(finalizeCallback), finalizeHint(finalizeHint),
+          finalizerQueue(finalizeCallback ? finalizerQueueRetain(finalizerQueue) : nullptr),
+          externalMemory(externalMemorySize ? externalMemoryRetain(externalMemory) : nullptr),
+          externalMemorySize(externalMemorySize), isExternal(isExternal)
+    {
+    }
 
-    void *getData() const;
+    ~NativeInfo() override
+    {
+        if (externalMemory)
+        {
+            externalMemoryAdjust(externalMemory, -static_cast<int64_t>(externalMemorySize));
+            externalMemoryRelease(externalMemory);
+        }
+        if (finalizeCallback)
+        {
+            finalizerQueueFinalize(finalizerQueue, finalizeCallback, data, finalizeHint);
+        }
+    }
 
-    ~External() override;
+    void *getData() const
+    {
+        return data;
+    }
 
-    hermes::vm::CallResult<hermes::vm::HermesValue> get(hermes::vm::SymbolID symbolId) override;
+    // napi_remove_wrap 不调用回调
+    void clearFinalizeCallback()
+    {
+        finalizeCallback = nullptr;
+        finalizerQueueRelease(finalizerQueue);
+        finalizerQueue = nullptr;
+    }
 
-    hermes::vm::CallResult<bool> set(hermes::vm::SymbolID symbolId, hermes::vm::HermesValue value) override;
+    bool getIsExternal() const
+    {
+        return isExternal;
+    }
 
-    hermes::vm::CallResult<hermes::vm::Handle<hermes::vm::JSArray>> getHostPropertyNames() override;
+    // externalMemorySize 通过 napi_adjust_external_memory 计入 GC external 额度，不算作 malloc 内存
+    size_t getMallocSize() const override
+    {
+        return sizeof(NativeInfo);
+    }
 
-    // copy ctor
-    External(const External &) = delete;
+    NativeInfo(const NativeInfo &) = delete;
 
-    // move ctor
-    External(External &&) = delete;
+    NativeInfo(NativeInfo &&) = delete;
 
-    // copy assign
-    External &operator=(const External &) = delete;
+    NativeInfo &operator=(const NativeInfo &) = delete;
 
-    // move assign
-    External &operator=(External &&) = delete;
+    NativeInfo &operator=(NativeInfo &&) = delete;
 
   private:
-    hermes::vm::Runtime *runtime;
     void *data;
     NAPIFinalize finalizeCallback;
     void *finalizeHint;
+    FinalizerQueue *finalizerQueue;
+    ExternalMemory *externalMemory;
+    size_t externalMemorySize;
+    bool isExternal;
+};
+
+// dumpSampledTraceToStream 只接受 std::ostream，使用固定大小缓冲区边生成边写入 fd，不关闭 fd
+class FileDescriptorStreamBuffer final : public std::streambuf
+{
+  public:
+    explicit FileDescriptorStreamBuffer(int fd) : fd(fd)
+    {
+        setp(buffer, buffer + sizeof(buffer));
+    }
+
+    bool hasError() const
+    {
+        return isError;
+    }
+
+    FileDescriptorStreamBuffer(const FileDescriptorStreamBuffer &) = delete;
+
+    FileDescriptorStreamBuffer(FileDescriptorStreamBuffer &&) = delete;
+
+    FileDescriptorStreamBuffer &operator=(const FileDescriptorStreamBuffer &) = delete;
+
+    FileDescriptorStreamBuffer &operator=(FileDescriptorStreamBuffer &&) = delete;
+
+  protected:
+    int_type overflow(int_type character) override
+    {
+        if (!writeBuffer())
+        {
+            return traits_type::eof();
+        }
+        if (!traits_type::eq_int_type(character, traits_type::eof()))
+        {
+            *pptr() = traits_type::to_char_type(character);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(character);
+    }
+
+    int sync() override
+    {
+        return writeBuffer() ? 0 : -1;
+    }
+
+  private:
+    bool writeBuffer()
+    {
+        const char *begin = pbase();
+        while (!isError && begin < pptr())
+        {
+            ssize_t count = write(fd, begin, static_cast<size_t>(pptr() - begin));
+            if (count >= 0)
+            {
+                begin += count;
+            }
+            else if (errno != EINTR)
+            {
+                isError = true;
+            }
+        }
+        setp(buffer, buffer + sizeof(buffer));
+
+        return !isError;
+    }
+
+    int fd;
+    bool isError = false;
+    char buffer[4096];
+};
+
+// runBytecode 之后 RuntimeModule 直接引用 buffer 中的字符串表和函数体，buffer 由 BCProvider 持有，malloc 分配
+class MallocBuffer final : public hermes::Buffer
+{
+  public:
+    MallocBuffer(const uint8_t *data, size_t size) : hermes::Buffer(data, size)
+    {
+    }
+
+    ~MallocBuffer() override
+    {
+        free(const_cast<uint8_t *>(data()));
+    }
+
+    MallocBuffer(const MallocBuffer &) = delete;
+
+    MallocBuffer(MallocBuffer &&) = delete;
+
+    MallocBuffer &operator=(const MallocBuffer &) = delete;
+
+    MallocBuffer &operator=(MallocBuffer &&) = delete;
+};
+
+// 直接在映射内存上执行，不复制，页面可以在进程间共享，内存紧张时被系统回收后按需重新读取
+class MappedFileBuffer final : public hermes::Buffer
+{
+  public:
+    // offset 需要满足字节码的对齐要求
+    explicit MappedFileBuffer(const MappedFile &mappedFile, size_t offset = 0)
+        : hermes::Buffer(mappedFile.data + offset, mappedFile.size - offset), mappedFile(mappedFile)
+    {
+    }
+
+    ~MappedFileBuffer() override
+    {
+        mappedFileClose(&mappedFile);
+    }
+
+    MappedFileBuffer(const MappedFileBuffer &) = delete;
+
+    MappedFileBuffer(MappedFileBuffer &&) = delete;
+
+    MappedFileBuffer &operator=(const MappedFileBuffer &) = delete;
+
+    MappedFileBuffer &operator=(MappedFileBuffer &&) = delete;
+
+  private:
+    MappedFile mappedFile;
+};
+
+// 直接在归档的映射内存上执行，持有 archive 引用，NAPICloseArchive 之后模块仍然可用
+class ArchiveBuffer final : public hermes::Buffer
+{
+  public:
+    ArchiveBuffer(BytecodeArchive *archive, const uint8_t *data, size_t size)
+        : hermes::Buffer(data, size), archive(bytecodeArchiveRetain(archive))
+    {
+    }
+
+    ~ArchiveBuffer() override
+    {
+        bytecodeArchiveRelease(archive);
+    }
+
+    ArchiveBuffer(const ArchiveBuffer &) = delete;
+
+    ArchiveBuffer(ArchiveBuffer &&) = delete;
+
+    ArchiveBuffer &operator=(const ArchiveBuffer &) = delete;
+
+    ArchiveBuffer &operator=(ArchiveBuffer &&) = delete;
+
+  private:
+    BytecodeArchive *archive;
 };
 
+// SamplingProfiler 为进程单例，记录正在采样的 env
+std::atomic<NAPIEnv> profilingEnv(nullptr);
+
 // hermes.cpp -> kMaxNumRegisters
 constexpr unsigned int kMaxNumRegisters =
     (512 * 1024 - sizeof(hermes::vm::Runtime) - 4096 * 8) / sizeof(hermes::vm::PinnedHermesValue);
@@ -148,38 +356,9 @@ class HermesExecutorRuntimeAdapter final : public facebook::hermes::inspector::R
 #endif
 } // namespace
 
-External::External(hermes::vm::Runtime *runtime, void *data, NAPIFinalize finalizeCallback, void *finalizeHint)
-    : runtime(runtime), data(data), finalizeCallback(finalizeCallback), finalizeHint(finalizeHint)
-{
-}
-
-void *External::getData() const
-{
-    return data;
-}
-External::~External()
-{
-    if (finalizeCallback)
-    {
-        finalizeCallback(data, finalizeHint);
-    }
-}
-hermes::vm::CallResult<hermes::vm::HermesValue> External::get(hermes::vm::SymbolID symbolId)
-{
-    return hermes::vm::Runtime::getUndefinedValue().get();
-}
-hermes::vm::CallResult<bool> External::set(hermes::vm::SymbolID symbolId, hermes::vm::HermesValue value)
-{
-    return false;
-}
-hermes::vm::CallResult<hermes::vm::Handle<hermes::vm::JSArray>> External::getHostPropertyNames()
-{
-    return hermes::vm::JSArray::create(runtime, 0, 0);
-}
-
 EXTERN_C_START
 
-struct OpaqueNAPIRef;
+struct Reference;
 
 struct OpaqueNAPIEnv final
 {
@@ -200,11 +379,61 @@ struct OpaqueNAPIEnv final
 
     OpaqueNAPIEnv &operator=(OpaqueNAPIEnv &&) = delete;
 
-    LIST_HEAD(, OpaqueNAPIRef) valueList;
+    // NAPIRef 为 slot 句柄，slot 为 Reference
+    ReferenceTable referenceTable;
+
+    // 构造失败为 nullptr
+    FinalizerQueue *finalizerQueue;
+
+    // 构造失败为 nullptr
+    ExternalMemory *externalMemory;
+
+    // 已经 credit 给 GC 的外部内存，只在 env 线程访问
+    int64_t creditedExternalMemory = 0;
+
+    // 按 externalMemory 总量向 GC credit/debit 差值
+    void syncExternalMemory();
+
+    // NAPICreateEnv 传入，可能为 nullptr
+    NAPIRuntime napiRuntime = nullptr;
+
+    // 第一次调用 NAPIRunArchiveModule 时创建，value 为强引用的 NAPIRef
+    BytecodeArchiveResultCache *archiveResultCache = nullptr;
+
+    // 强引用和对象弱引用分别存储在连续数组中，GC 根函数只需要线性扫描
+    // 删除时和末尾元素交换，*ReferenceList 用于更新被移动元素的 rootIndex
+    std::vector<hermes::vm::PinnedHermesValue> strongRootList;
+
+    std::vector<Reference *> strongReferenceList;
+
+    std::vector<hermes::vm::WeakRef<hermes::vm::HermesValue>> weakRootList;
+
+    std::vector<Reference *> weakReferenceList;
+
+    uint32_t addStrongRoot(Reference *reference, hermes::vm::HermesValue hermesValue);
 
-    LIST_HEAD(, OpaqueNAPIRef) weakRefList;
+    void removeStrongRoot(uint32_t index);
 
-    LIST_HEAD(, OpaqueNAPIRef) strongRefList;
+    uint32_t addWeakRoot(Reference *reference, const hermes::vm::WeakRef<hermes::vm::HermesValue> &weakRef);
+
+    void removeWeakRoot(uint32_t index);
+
+    // Hades 的 GC 回调可能来自后台线程，新生代和老年代回收可能重叠，只统计有 GC 进行的总时长
+    std::mutex gcMutex;
+
+    uint32_t gcDepth = 0;
+
+    std::chrono::steady_clock::time_point gcBeginTime;
+
+    uint64_t gcNanoseconds = 0;
+
+    // NAPIStartTracing 开启，否则为 nullptr，只在 env 线程修改，修改和 GC 回调读取时需要持有 gcMutex
+    Trace *trace = nullptr;
+
+    // 开启 trace 之前开始的 GC 为 0，不记录
+    uint64_t gcTraceBeginTime = 0;
+
+    void onGCEvent(hermes::vm::GCEventKind kind);
 
     void enableDebugger(const char *debuggerTitle, bool waitForDebugger);
 
@@ -222,6 +451,9 @@ struct OpaqueNAPIEnv final
 #endif
 
   private:
+    // 在 runtimeConfig 中加入 GC 回调
+    hermes::vm::RuntimeConfig addGCCallback(const hermes::vm::RuntimeConfig &runtimeConfig);
+
     hermes::vm::Runtime *runtime;
 
     std::shared_ptr<facebook::hermes::HermesRuntime> hermesRuntimeSharedPtr;
@@ -250,79 +482,75 @@ void OpaqueNAPIEnv::disableDebugger()
 }
 
 // 初始状态
-// !referenceCount && !isObject => (undefined, 0) => addValue
-// referenceCount > 0 => 强引用 => addStrong
-// !referenceCount && isObject => 弱引用 => addWeak
+// !referenceCount && !isObject => (undefined, 0) => 值，不需要根
+// referenceCount > 0 => 强引用 => env->strongRootList
+// !referenceCount && isObject => 弱引用 => env->weakRootList
 
-// 1 + ref => undefined 强引用 => removeValue + addStrong
+// 1 + ref => undefined 强引用
 // 2 + ref => 强引用
-// (2 + unref) && isObject => weakRef => removeStrong + addWeak
-// (2 + unref) && !isObject => (undefined, 0) => removeStrong + addValue
-// (3 + ref) && 有效 => 强引用 => removeWeak + addStrong
-// (3 + ref) && 无效 => undefined 强引用 => removeWeak + addStrong + isObject = false;
+// (2 + unref) && isObject => 弱引用
+// (2 + unref) && !isObject => (undefined, 0)
+// (3 + ref) && 有效 => 强引用
+// (3 + ref) && 无效 => undefined 强引用 + isObject = false;
 
-struct OpaqueNAPIRef final
+// 构造在 env->referenceTable 的 slot 中，rootIndex 为 strongRootList 或者 weakRootList 下标
+struct Reference final
 {
-    OpaqueNAPIRef(NAPIEnv env, const hermes::vm::PinnedHermesValue &pinnedHermesValue, uint8_t referenceCount)
-        : env(env), referenceCount(referenceCount), isObject(pinnedHermesValue.isObject())
+    Reference(NAPIEnv env, const hermes::vm::PinnedHermesValue &pinnedHermesValue, uint32_t referenceCount)
+        : env(env), referenceCount(referenceCount), rootIndex(0), isObject(pinnedHermesValue.isObject())
     {
-        // 标量 && 弱引用
-        if (!referenceCount && !isObject)
-        {
-            LIST_INSERT_HEAD(&env->valueList, this, node);
-            this->pinnedHermesValue = *hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
-        }
-        else if (referenceCount)
+        if (referenceCount)
         {
             // 强引用
-            this->pinnedHermesValue = pinnedHermesValue;
-            LIST_INSERT_HEAD(&env->strongRefList, this, node);
+            rootIndex = env->addStrongRoot(this, pinnedHermesValue);
         }
-        else
+        else if (isObject)
         {
             // 对象 && 弱引用
-            // addWeak
             // runtime->getHeap() mutable，因此不能使用 const hermes::vm::Runtime *
-            this->hermesValueWeakRef =
-                hermes::vm::WeakRef<hermes::vm::HermesValue>(&env->getRuntime()->getHeap(), pinnedHermesValue);
-            LIST_INSERT_HEAD(&env->weakRefList, this, node);
+            rootIndex = env->addWeakRoot(
+                this, hermes::vm::WeakRef<hermes::vm::HermesValue>(&env->getRuntime()->getHeap(), pinnedHermesValue));
         }
     }
-    OpaqueNAPIRef(const OpaqueNAPIRef &) = delete;
+    Reference(const Reference &) = delete;
 
-    OpaqueNAPIRef(OpaqueNAPIRef &&) = delete;
+    Reference(Reference &&) = delete;
 
-    OpaqueNAPIRef &operator=(const OpaqueNAPIRef &) = delete;
+    Reference &operator=(const Reference &) = delete;
 
-    OpaqueNAPIRef &operator=(OpaqueNAPIRef &&) = delete;
+    Reference &operator=(Reference &&) = delete;
 
-    ~OpaqueNAPIRef()
+    ~Reference()
     {
-        LIST_REMOVE(this, node);
+        if (referenceCount)
+        {
+            env->removeStrongRoot(rootIndex);
+        }
+        else if (isObject)
+        {
+            env->removeWeakRoot(rootIndex);
+        }
     }
     void ref()
     {
         if (!referenceCount)
         {
-            LIST_REMOVE(this, node);
-            if (!isObject)
-            {
-                LIST_INSERT_HEAD(&env->strongRefList, this, node);
-            }
-            else
+            hermes::vm::HermesValue hermesValue = hermes::vm::HermesValue::encodeUndefinedValue();
+            if (isObject)
             {
-                auto hermesValueOptional = hermesValueWeakRef.unsafeGetOptional(&env->getRuntime()->getHeap());
+                auto hermesValueOptional =
+                    env->weakRootList[rootIndex].unsafeGetOptional(&env->getRuntime()->getHeap());
+                env->removeWeakRoot(rootIndex);
                 if (hermesValueOptional.hasValue())
                 {
-                    pinnedHermesValue = hermesValueOptional.getValue();
+                    hermesValue = hermesValueOptional.getValue();
                 }
                 else
                 {
-                    pinnedHermesValue = *hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
                     isObject = false;
                 }
-                LIST_INSERT_HEAD(&env->strongRefList, this, node);
             }
+            rootIndex = env->addStrongRoot(this, hermesValue);
         }
         ++referenceCount;
     }
@@ -331,32 +559,25 @@ struct OpaqueNAPIRef final
         assert(referenceCount);
         if (referenceCount == 1)
         {
-            LIST_REMOVE(this, node);
+            uint32_t strongRootIndex = rootIndex;
             if (isObject)
             {
-                hermesValueWeakRef =
-                    hermes::vm::WeakRef<hermes::vm::HermesValue>(&env->getRuntime()->getHeap(), pinnedHermesValue);
-                LIST_INSERT_HEAD(&env->weakRefList, this, node);
-            }
-            else
-            {
-                pinnedHermesValue = *hermes::vm::Runtime::getUndefinedValue().unsafeGetPinnedHermesValue();
-                LIST_INSERT_HEAD(&env->valueList, this, node);
+                // 先加入弱根，再移除强根
+                rootIndex = env->addWeakRoot(this, hermes::vm::WeakRef<hermes::vm::HermesValue>(
+                                                       &env->getRuntime()->getHeap(), env->strongRootList[rootIndex]));
             }
+            env->removeStrongRoot(strongRootIndex);
         }
         --referenceCount;
     }
-    uint8_t getReferenceCount() const
+    uint32_t getReferenceCount() const
     {
         return referenceCount;
     }
-
-    LIST_ENTRY(OpaqueNAPIRef) node;
-
-    union {
-        hermes::vm::PinnedHermesValue pinnedHermesValue;                 // 64
-        hermes::vm::WeakRef<hermes::vm::HermesValue> hermesValueWeakRef; // size_t
-    };
+    void setRootIndex(uint32_t index)
+    {
+        rootIndex = index;
+    }
     const hermes::vm::PinnedHermesValue *getHermesValue() const
     {
         if (!referenceCount && !isObject)
@@ -365,13 +586,15 @@ struct OpaqueNAPIRef final
         }
         else if (referenceCount)
         {
-            return hermes::vm::Handle<hermes::vm::HermesValue>::vmcast(env->getRuntime(), pinnedHermesValue)
+            return hermes::vm::Handle<hermes::vm::HermesValue>::vmcast(env->getRuntime(),
+                                                                        env->strongRootList[rootIndex])
                 .unsafeGetPinnedHermesValue();
         }
         else
         {
             // 会创建 Handle
-            auto hermesValueHandleOptional = hermesValueWeakRef.get(env->getRuntime(), &env->getRuntime()->getHeap());
+            auto hermesValueHandleOptional =
+                env->weakRootList[rootIndex].get(env->getRuntime(), &env->getRuntime()->getHeap());
             if (hermesValueHandleOptional.hasValue())
             {
                 return hermesValueHandleOptional.getValue().unsafeGetPinnedHermesValue();
@@ -385,33 +608,149 @@ struct OpaqueNAPIRef final
 
   private:
     NAPIEnv env;
-    uint8_t referenceCount;
+    uint32_t referenceCount;
+    uint32_t rootIndex;
     bool isObject;
 };
 
 EXTERN_C_END
 
+uint32_t OpaqueNAPIEnv::addStrongRoot(Reference *reference, hermes::vm::HermesValue hermesValue)
+{
+    strongRootList.emplace_back(hermesValue);
+    strongReferenceList.push_back(reference);
+
+    return (uint32_t)(strongRootList.size() - 1);
+}
+
+void OpaqueNAPIEnv::removeStrongRoot(uint32_t index)
+{
+    size_t lastIndex = strongRootList.size() - 1;
+    if (index != lastIndex)
+    {
+        strongRootList[index] = strongRootList[lastIndex];
+        strongReferenceList[index] = strongReferenceList[lastIndex];
+        strongReferenceList[index]->setRootIndex(index);
+    }
+    strongRootList.pop_back();
+    strongReferenceList.pop_back();
+}
+
+uint32_t OpaqueNAPIEnv::addWeakRoot(Reference *reference, const hermes::vm::WeakRef<hermes::vm::HermesValue> &weakRef)
+{
+    weakRootList.push_back(weakRef);
+    weakReferenceList.push_back(reference);
+
+    return (uint32_t)(weakRootList.size() - 1);
+}
+
+void OpaqueNAPIEnv::removeWeakRoot(uint32_t index)
+{
+    size_t lastIndex = weakRootList.size() - 1;
+    if (index != lastIndex)
+    {
+        weakRootList[index] = weakRootList[lastIndex];
+        weakReferenceList[index] = weakReferenceList[lastIndex];
+        weakReferenceList[index]->setRootIndex(index);
+    }
+    weakRootList.pop_back();
+    weakReferenceList.pop_back();
+}
+
 OpaqueNAPIEnv::~OpaqueNAPIEnv()
 {
     disableDebugger();
+    {
+        // 成员析构时 runtime 销毁仍然可能触发 GC 回调
+        std::lock_guard<std::mutex> lock(gcMutex);
+        traceFree(trace);
+        trace = nullptr;
+    }
+
+    for (uint32_t i = 0; i < referenceTable.slotCount; ++i)
+    {
+        auto reference = static_cast<Reference *>(referenceTableGetSlot(&referenceTable, i));
+        if (reference)
+        {
+            reference->~Reference();
+        }
+    }
+    referenceTableFinalize(&referenceTable);
+    // 缓存的 NAPIRef 已经随引用表释放
+    bytecodeArchiveResultCacheFree(archiveResultCache);
+    // 执行剩余 finalizer，之后 runtime 销毁时的 finalizer 同步调用
+    finalizerQueueClose(finalizerQueue);
+    // runtime 销毁时 NativeInfo 仍然持有引用，最后一个释放
+    externalMemoryRelease(externalMemory);
+}
 
-    NAPIRef ref, temp;
-    LIST_FOREACH_SAFE(ref, &valueList, node, temp)
+// NativeInfo 析构时拿不到 GC 和对象，无法按对象 debit，统一记在全局对象上，只在 env 线程同步
+void OpaqueNAPIEnv::syncExternalMemory()
+{
+    int64_t totalSize = std::max<int64_t>(externalMemoryAdjust(externalMemory, 0), 0);
+    auto &heap = runtime->getHeap();
+    auto global = runtime->getGlobal().get();
+    while (creditedExternalMemory < totalSize)
+    {
+        auto size = static_cast<uint32_t>(std::min<int64_t>(totalSize - creditedExternalMemory, UINT32_MAX));
+        // 超过最大堆时不再 credit，由 GC 自身处理 OOM
+        if (!heap.canAllocExternalMemory(size))
+        {
+            break;
+        }
+        heap.creditExternalMemory(global, size);
+        creditedExternalMemory += size;
+    }
+    while (creditedExternalMemory > totalSize)
     {
-        delete ref;
+        auto size = static_cast<uint32_t>(std::min<int64_t>(creditedExternalMemory - totalSize, UINT32_MAX));
+        heap.debitExternalMemory(global, size);
+        creditedExternalMemory -= size;
     }
-    LIST_FOREACH_SAFE(ref, &strongRefList, node, temp)
+}
+
+void OpaqueNAPIEnv::onGCEvent(hermes::vm::GCEventKind kind)
+{
+    std::lock_guard<std::mutex> lock(gcMutex);
+    if (kind == hermes::vm::GCEventKind::CollectionStart)
     {
-        delete ref;
+        NAPI_USDT_PROBE0(gc_start);
+        if (!gcDepth++)
+        {
+            gcBeginTime = std::chrono::steady_clock::now();
+            gcTraceBeginTime = traceGetTimestamp(trace);
+        }
     }
-    LIST_FOREACH_SAFE(ref, &weakRefList, node, temp)
+    else
     {
-        delete ref;
+        NAPI_USDT_PROBE0(gc_done);
+        if (gcDepth && !--gcDepth)
+        {
+            gcNanoseconds += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - gcBeginTime)
+                    .count());
+            if (gcTraceBeginTime)
+            {
+                traceAddEvent(trace, TRACE_CATEGORY_GC, "GC", nullptr, gcTraceBeginTime);
+            }
+        }
     }
 }
 
+hermes::vm::RuntimeConfig OpaqueNAPIEnv::addGCCallback(const hermes::vm::RuntimeConfig &runtimeConfig)
+{
+    // gcMutex 等成员先于 hermesRuntimeSharedPtr 构造，后于其析构
+    auto gcConfig = runtimeConfig.getGCConfig()
+                        .rebuild()
+                        .withCallback([this](hermes::vm::GCEventKind kind, const char *) { onGCEvent(kind); })
+                        .build();
+
+    return runtimeConfig.rebuild().withGCConfig(gcConfig).build();
+}
+
 OpaqueNAPIEnv::OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig)
-    : hermesRuntimeSharedPtr(facebook::hermes::makeHermesRuntime(runtimeConfig)), hermesRuntime(*hermesRuntimeSharedPtr)
+    : hermesRuntimeSharedPtr(facebook::hermes::makeHermesRuntime(addGCCallback(runtimeConfig))),
+      hermesRuntime(*hermesRuntimeSharedPtr)
 {
     // HermesExecutorFactory -> heapSizeMB 1024 -> HermesExecutor -> initHybrid
     // https://github.com/facebook/react-native/blob/v0.64.2/ReactAndroid/src/main/java/com/facebook/hermes/reactexecutor/OnLoad.cpp#L85
@@ -434,22 +773,20 @@ OpaqueNAPIEnv::OpaqueNAPIEnv(const hermes::vm::RuntimeConfig &runtimeConfig)
     // 0.8.x 版本开始会执行 runInternalBytecode -> runBytecode -> clearThrownValue，0.7.2 版本没有执行，需要手动执行清空
     // RuntimeHermesValueFields.def 文件定义了 PinnedHermesValue thrownValue_ = {} => undefined
     //    runtime->clearThrownValue();
-    LIST_INIT(&valueList);
-    LIST_INIT(&weakRefList);
-    LIST_INIT(&strongRefList);
+    referenceTableInit(&referenceTable, sizeof(Reference));
+    finalizerQueue = finalizerQueueCreate();
+    externalMemory = externalMemoryCreate(0);
 
     runtime->addCustomRootsFunction([this](hermes::vm::GC *, hermes::vm::RootAcceptor &rootAcceptor) {
-        NAPIRef ref;
-        LIST_FOREACH(ref, &this->strongRefList, node)
+        for (auto &pinnedHermesValue : this->strongRootList)
         {
-            rootAcceptor.accept(ref->pinnedHermesValue);
+            rootAcceptor.accept(pinnedHermesValue);
         }
     });
     runtime->addCustomWeakRootsFunction([this](hermes::vm::GC *, hermes::vm::WeakRefAcceptor &weakRefAcceptor) {
-        NAPIRef ref;
-        LIST_FOREACH(ref, &this->weakRefList, node)
+        for (auto &weakRef : this->weakRootList)
         {
-            weakRefAcceptor.accept(ref->hermesValueWeakRef);
+            weakRefAcceptor.accept(weakRef);
         }
     });
 }
@@ -656,7 +993,9 @@ NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPI
             return {hermes::vm::Runtime::getUndefinedValue().get()};
         }
         struct OpaqueNAPICallbackInfo callbackInfo(args, innerFunctionInfo->getData());
+        NAPI_USDT_PROBE2(callback_entry, innerFunctionInfo->getEnv(), innerFunctionInfo->getCallback());
         NAPIValue returnValue = innerFunctionInfo->getCallback()(innerFunctionInfo->getEnv(), &callbackInfo);
+        NAPI_USDT_PROBE2(callback_return, innerFunctionInfo->getEnv(), innerFunctionInfo->getCallback());
         RETURN_STATUS_IF_FALSE(innerFunctionInfo->getEnv()->getRuntime()->getThrownValue().isEmpty(),
                                hermes::vm::ExecutionStatus::EXCEPTION)
         if (!returnValue)
@@ -686,6 +1025,25 @@ NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPI
     return NAPIExceptionOK;
 }
 
+// HostObject 同样继承自 DecoratedObject，需要排除
+static hermes::vm::DecoratedObject *getDecoratedObject(NAPIValue value)
+{
+    const auto &hermesValue = *(const hermes::vm::PinnedHermesValue *)value;
+    if (hermes::vm::vmisa<hermes::vm::HostObject>(hermesValue))
+    {
+        return nullptr;
+    }
+
+    return hermes::vm::dyn_vmcast_or_null<hermes::vm::DecoratedObject>(hermesValue);
+}
+
+static NativeInfo *getNativeInfo(NAPIValue value)
+{
+    auto decoratedObject = getDecoratedObject(value);
+
+    return decoratedObject ? static_cast<NativeInfo *>(decoratedObject->getDecoration()) : nullptr;
+}
+
 NAPICommonStatus napi_typeof(NAPIEnv /*env*/, NAPIValue value, NAPIValueType *result)
 {
     CHECK_ARG(value, Common)
@@ -725,7 +1083,8 @@ NAPICommonStatus napi_typeof(NAPIEnv /*env*/, NAPIValue value, NAPIValueType *re
         }
         else
         {
-            *result = hermes::vm::vmisa<hermes::vm::HostObject>(hermesValue) ? NAPIExternal : NAPIObject;
+            auto nativeInfo = getNativeInfo(value);
+            *result = nativeInfo && nativeInfo->getIsExternal() ? NAPIExternal : NAPIObject;
         }
     }
     else
@@ -1109,17 +1468,30 @@ NAPICommonStatus napi_get_new_target(NAPIEnv env, NAPICallbackInfo callbackInfo,
 
 NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
                                          NAPIValue *result)
+{
+    return NAPICreateExternalWithSize(env, data, finalizeCB, finalizeHint, 0, result);
+}
+
+NAPIExceptionStatus NAPICreateExternalWithSize(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
+                                               size_t externalMemorySize, NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
     CHECK_ARG(result, Exception)
 
-    auto hermesExternalObject = new (std::nothrow)::External(env->getRuntime(), data, finalizeCB, finalizeHint);
-    RETURN_STATUS_IF_FALSE(hermesExternalObject, NAPIExceptionMemoryError)
+    auto nativeInfo = new (std::nothrow) NativeInfo(data, finalizeCB, finalizeHint, true, env->finalizerQueue,
+                                                    env->externalMemory, externalMemorySize);
+    RETURN_STATUS_IF_FALSE(nativeInfo, NAPIExceptionMemoryError)
 
-    auto callResult = hermes::vm::HostObject::createWithoutPrototype(env->getRuntime(),
-                                                                     std::unique_ptr<External>(hermesExternalObject));
-    CHECK_HERMES(callResult)
-    *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    // 和 HostObject::createWithoutPrototype 一致，[[prototype]] 为 null
+    auto decoratedObject = hermes::vm::DecoratedObject::create(
+        env->getRuntime(), hermes::vm::HandleRootOwner::makeNullHandle<hermes::vm::JSObject>(),
+        std::unique_ptr<NativeInfo>(nativeInfo));
+    *result = (NAPIValue)env->getRuntime()->makeHandle(decoratedObject.getHermesValue()).unsafeGetPinnedHermesValue();
+    if (externalMemorySize)
+    {
+        // result 已经位于 handle scope，GC 不会回收
+        napi_adjust_external_memory(env, static_cast<int64_t>(externalMemorySize), nullptr);
+    }
 
     return NAPIExceptionOK;
 }
@@ -1130,76 +1502,180 @@ NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **res
     CHECK_ARG(value, Error)
     CHECK_ARG(result, Error)
 
-    auto hostObject =
-        hermes::vm::dyn_vmcast_or_null<hermes::vm::HostObject>(*(const hermes::vm::PinnedHermesValue *)value);
-    RETURN_STATUS_IF_FALSE(hostObject, NAPIErrorExternalExpected)
-
-    auto external = (External *)hostObject->getProxy();
-    *result = external ? external->getData() : nullptr;
+    auto nativeInfo = getNativeInfo(value);
+    RETURN_STATUS_IF_FALSE(nativeInfo && nativeInfo->getIsExternal(), NAPIErrorExternalExpected)
+    *result = nativeInfo->getData();
 
     return NAPIErrorOK;
 }
 
-NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+NAPICommonStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(value, Exception)
-    CHECK_ARG(result, Exception)
+    CHECK_ARG(env, Common)
 
-    *result = new (std::nothrow) OpaqueNAPIRef(env, *(const hermes::vm::PinnedHermesValue *)value, initialRefCount);
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    int64_t totalSize = externalMemoryAdjust(env->externalMemory, changeInBytes);
+    // 同时扣除已经析构的 External，由 GC 根据 external 额度决定何时回收
+    env->syncExternalMemory();
+    if (adjustedValue)
+    {
+        *adjustedValue = totalSize;
+    }
 
-    return NAPIExceptionOK;
+    return NAPICommonOK;
 }
 
-NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+// External 同样为 DecoratedObject，需要排除
+static hermes::vm::DecoratedObject *getInstanceObject(NAPIValue value)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
-
-    delete ref;
+    auto decoratedObject = getDecoratedObject(value);
+    if (decoratedObject && decoratedObject->getDecoration() &&
+        static_cast<NativeInfo *>(decoratedObject->getDecoration())->getIsExternal())
+    {
+        return nullptr;
+    }
 
-    return NAPIExceptionOK;
+    return decoratedObject;
 }
 
-NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+NAPIExceptionStatus napi_wrap(NAPIEnv env, NAPIValue jsObject, void *nativeObject, NAPIFinalize finalizeCB,
+                              void *finalizeHint, NAPIRef *result)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
-
-    ref->ref();
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(jsObject, Exception)
+
+    auto decoratedObject = getInstanceObject(jsObject);
+    RETURN_STATUS_IF_FALSE(decoratedObject, NAPIExceptionObjectExpected)
+    RETURN_STATUS_IF_FALSE(!decoratedObject->getDecoration(), NAPIExceptionInvalidArg)
+    auto nativeInfo =
+        new (std::nothrow) NativeInfo(nativeObject, finalizeCB, finalizeHint, false, env->finalizerQueue);
+    RETURN_STATUS_IF_FALSE(nativeInfo, NAPIExceptionMemoryError)
+    decoratedObject->setDecoration(std::unique_ptr<NativeInfo>(nativeInfo));
     if (result)
     {
-        *result = ref->getReferenceCount();
+        auto status = napi_create_reference(env, jsObject, 0, result);
+        if (status != NAPIExceptionOK)
+        {
+            // 同 napi_create_external，出错不回调
+            nativeInfo->clearFinalizeCallback();
+            decoratedObject->setDecoration(nullptr);
+
+            return status;
+        }
     }
 
     return NAPIExceptionOK;
 }
 
-NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+NAPIErrorStatus napi_unwrap(NAPIEnv env, NAPIValue jsObject, void **result)
 {
-    CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+    CHECK_ARG(result, Error)
 
-    RETURN_STATUS_IF_FALSE(ref->getReferenceCount(), NAPIExceptionGenericFailure)
-    ref->unref();
-    if (result)
-    {
-        *result = ref->getReferenceCount();
-    }
+    auto decoratedObject = getInstanceObject(jsObject);
+    RETURN_STATUS_IF_FALSE(decoratedObject, NAPIErrorObjectExpected)
+    auto nativeInfo = static_cast<NativeInfo *>(decoratedObject->getDecoration());
+    RETURN_STATUS_IF_FALSE(nativeInfo, NAPIErrorInvalidArg)
+    *result = nativeInfo->getData();
 
-    return NAPIExceptionOK;
+    return NAPIErrorOK;
 }
 
-NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
+NAPIErrorStatus napi_remove_wrap(NAPIEnv env, NAPIValue jsObject, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+
+    auto decoratedObject = getInstanceObject(jsObject);
+    RETURN_STATUS_IF_FALSE(decoratedObject, NAPIErrorObjectExpected)
+    auto nativeInfo = static_cast<NativeInfo *>(decoratedObject->getDecoration());
+    RETURN_STATUS_IF_FALSE(nativeInfo, NAPIErrorInvalidArg)
+    if (result)
+    {
+        *result = nativeInfo->getData();
+    }
+    nativeInfo->clearFinalizeCallback();
+    decoratedObject->setDecoration(nullptr);
+
+    return NAPIErrorOK;
+}
+
+NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t initialRefCount, NAPIRef *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(value, Exception)
+    CHECK_ARG(result, Exception)
+
+    void *slot = referenceTableAlloc(&env->referenceTable, result);
+    RETURN_STATUS_IF_FALSE(slot, NAPIExceptionMemoryError)
+    new (slot) Reference(env, *(const hermes::vm::PinnedHermesValue *)value, initialRefCount);
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    auto reference = static_cast<Reference *>(referenceTableGet(&env->referenceTable, ref));
+    CHECK_ARG(reference, Exception)
+
+    reference->~Reference();
+    referenceTableFree(&env->referenceTable, ref);
+
+    return NAPIExceptionOK;
+}
+
+// NAPIGenericFailure
+NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    auto reference = static_cast<Reference *>(referenceTableGet(&env->referenceTable, ref));
+    CHECK_ARG(reference, Exception)
+
+    RETURN_STATUS_IF_FALSE(reference->getReferenceCount() != UINT32_MAX, NAPIExceptionGenericFailure)
+    reference->ref();
+    if (result)
+    {
+        *result = reference->getReferenceCount();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *result)
+{
+    CHECK_ARG(env, Exception)
+    CHECK_ARG(ref, Exception)
+
+    auto reference = static_cast<Reference *>(referenceTableGet(&env->referenceTable, ref));
+    CHECK_ARG(reference, Exception)
+
+    RETURN_STATUS_IF_FALSE(reference->getReferenceCount(), NAPIExceptionGenericFailure)
+    reference->unref();
+    if (result)
+    {
+        *result = reference->getReferenceCount();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue *result)
 {
     CHECK_ARG(env, Exception)
     CHECK_ARG(ref, Exception)
     CHECK_ARG(result, Exception)
 
+    auto reference = static_cast<Reference *>(referenceTableGet(&env->referenceTable, ref));
+    CHECK_ARG(reference, Exception)
+
     RETURN_STATUS_IF_FALSE(env->getRuntime()->getTopGCScope(), NAPIExceptionHandleScopeEmpty)
 
-    *result = (NAPIValue)ref->getHermesValue();
+    *result = (NAPIValue)reference->getHermesValue();
 
     return NAPIExceptionOK;
 }
@@ -1211,6 +1687,7 @@ NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
 
     *result = (NAPIHandleScope) new (std::nothrow) hermes::vm::GCScope(env->getRuntime());
     RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
@@ -1220,7 +1697,14 @@ NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
     CHECK_ARG(env, Common)
     CHECK_ARG(scope, Common)
 
+    NAPI_USDT_PROBE2(handle_scope_close, env, scope);
     delete (hermes::vm::GCScope *)scope;
+    // 最外层 handle scope 关闭，没有 native 代码在栈上，可以执行延迟的 finalizer，并扣除已经析构的 External
+    if (!env->getRuntime()->getTopGCScope())
+    {
+        finalizerQueueDrainAtSafePoint(env->finalizerQueue);
+        env->syncExternalMemory();
+    }
 
     return NAPICommonOK;
 }
@@ -1273,6 +1757,7 @@ NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandl
         return NAPIErrorMemoryError;
     }
     (*result)->gcScope = gcScope;
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
@@ -1282,8 +1767,14 @@ NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHan
     CHECK_ARG(env, Common)
     CHECK_ARG(scope, Common)
 
+    NAPI_USDT_PROBE2(handle_scope_close, env, scope);
     delete scope->gcScope;
     delete scope;
+    if (!env->getRuntime()->getTopGCScope())
+    {
+        finalizerQueueDrainAtSafePoint(env->finalizerQueue);
+        env->syncExternalMemory();
+    }
 
     return NAPICommonOK;
 }
@@ -1344,6 +1835,87 @@ NAPICommonStatus NAPIClearLastException(NAPIEnv env)
     return NAPICommonOK;
 }
 
+// 每个 env 独占一个 hermes::vm::Runtime，NAPIRuntime 只保存默认配置和代码缓存
+struct OpaqueNAPIRuntime final
+{
+    NAPIRuntimeConfig config;
+
+    // NAPISetCodeCacheDirectory 开启，否则为 nullptr
+    CodeCache *codeCache = nullptr;
+};
+
+// 序列化要求全部函数完成编译，bcProvider 编译时不能 lazy
+// stripDebugInfo 时写入空的 debug info 段，异常堆栈没有行号
+static std::string serializeBytecode(hermes::hbc::BCProviderFromSrc &bcProvider, const char *script,
+                                     size_t scriptLength, bool stripDebugInfo)
+{
+    std::string bytecode;
+    llvh::raw_string_ostream outputStream(bytecode);
+    hermes::BytecodeGenerationOptions generationOptions(hermes::EmitBundle);
+    generationOptions.stripDebugInfoSection = stripDebugInfo;
+    hermes::hbc::serializeBytecodeModule(
+        *bcProvider.getBytecodeModule(),
+        llvh::SHA1::hash(llvh::makeArrayRef(reinterpret_cast<const uint8_t *>(script), scriptLength)), outputStream,
+        generationOptions);
+    outputStream.flush();
+
+    return bytecode;
+}
+
+// 返回值和 Runtime::run 一致，缓存读取或者写入失败时退化为直接编译
+// script[scriptLength] 需要为 \0，options 可空，总是全量编译并且不生成调试信息，忽略 eager 和 stripDebugInfo
+// optimize、strict 和 staticBuiltins 影响字节码，作为 key 的一部分，全部为 false 时和 NAPIRunScript 共用条目
+static hermes::vm::CallResult<hermes::vm::HermesValue> runWithCodeCache(NAPIEnv env, const char *script,
+                                                                        size_t scriptLength, const char *sourceUrl,
+                                                                        const NAPIRunScriptOptions *options)
+{
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.format = hermes::EmitBundle;
+    uint32_t kind = 0;
+    if (options)
+    {
+        compileFlags.optimize = options->optimize;
+        compileFlags.strict = options->strict;
+        if (options->staticBuiltins)
+        {
+            compileFlags.staticBuiltins = true;
+        }
+        kind = (options->optimize ? 1 : 0) | (options->strict ? 2 : 0) | (options->staticBuiltins ? 4 : 0);
+    }
+    CodeCache *codeCache = env->napiRuntime->codeCache;
+    CodeCacheKey key;
+    codeCacheGetKey(codeCache, script, scriptLength, sourceUrl, kind, &key);
+    hermes::vm::RuntimeModuleFlags runtimeModuleFlags;
+    runtimeModuleFlags.persistent = true;
+    MappedFile mappedFile;
+    size_t offset;
+    if (codeCacheOpen(codeCache, &key, &mappedFile, &offset))
+    {
+        // 映射由 BCProvider 持有，直接在映射内存上执行
+        auto bcProviderAndError = hermes::hbc::BCProviderFromBuffer::createBCProviderFromBuffer(
+            std::make_unique<MappedFileBuffer>(mappedFile, offset));
+        if (bcProviderAndError.first)
+        {
+            return env->getRuntime()->runBytecode(std::move(bcProviderAndError.first), runtimeModuleFlags, sourceUrl,
+                                                  hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+        }
+        codeCacheRemove(codeCache, &key);
+    }
+    // 同 Runtime::run 非 lazy 模式，Buffer 不持有 script，只在编译期间使用
+    auto bcProviderAndError = hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(
+        std::make_unique<hermes::Buffer>(reinterpret_cast<const uint8_t *>(script), scriptLength), sourceUrl,
+        compileFlags);
+    if (!bcProviderAndError.first)
+    {
+        return env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(bcProviderAndError.second.c_str()));
+    }
+    std::string bytecode = serializeBytecode(*bcProviderAndError.first, script, scriptLength, false);
+    codeCacheWrite(codeCache, &key, reinterpret_cast<const uint8_t *>(bytecode.data()), bytecode.size());
+
+    return env->getRuntime()->runBytecode(std::move(bcProviderAndError.first), runtimeModuleFlags, sourceUrl,
+                                          hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+}
+
 NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
 {
     NAPI_PREAMBLE(env)
@@ -1351,7 +1923,15 @@ NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *s
     hermes::hbc::CompileFlags compileFlags = {};
     compileFlags.lazy = true;
     compileFlags.debug = true;
-    auto callResult = env->getRuntime()->run(script, sourceUrl, compileFlags);
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    auto callResult = env->napiRuntime && env->napiRuntime->codeCache
+                          ? runWithCodeCache(env, script ? script : "", script ? std::strlen(script) : 0,
+                                             sourceUrl ? sourceUrl : "", nullptr)
+                          : env->getRuntime()->run(script, sourceUrl, compileFlags);
+    NAPI_USDT_PROBE1(script_done, env);
+    // Hermes 在 run 中编译源码，编译时间包含在内
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScript", sourceUrl, traceBeginTime);
     CHECK_HERMES(callResult)
     if (result)
     {
@@ -1394,7 +1974,9 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
             return args.getThisArg();
         }
         struct OpaqueNAPICallbackInfo callbackInfo(args, innerFunctionInfo->getData());
+        NAPI_USDT_PROBE2(constructor_entry, innerFunctionInfo->getEnv(), innerFunctionInfo->getCallback());
         NAPIValue returnValue = innerFunctionInfo->getCallback()(innerFunctionInfo->getEnv(), &callbackInfo);
+        NAPI_USDT_PROBE2(constructor_return, innerFunctionInfo->getEnv(), innerFunctionInfo->getCallback());
         RETURN_STATUS_IF_FALSE(innerFunctionInfo->getEnv()->getRuntime()->getThrownValue().isEmpty(),
                                hermes::vm::ExecutionStatus::EXCEPTION)
         if (!returnValue || !((const hermes::vm::PinnedHermesValue *)returnValue)->isObject())
@@ -1406,8 +1988,13 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
     };
     auto nativeConstructor = hermes::vm::NativeConstructor::create(
         env->getRuntime(), hermes::vm::Handle<hermes::vm::JSObject>::vmcast(&env->getRuntime()->functionPrototype),
-        functionInfo, nativeFunctionPtr, 0, hermes::vm::NativeConstructor::creatorFunction<hermes::vm::JSObject>,
-        hermes::vm::CellKind::ObjectKind);
+        functionInfo, nativeFunctionPtr, 0,
+        [](hermes::vm::Runtime *runtime, hermes::vm::Handle<hermes::vm::JSObject> prototype,
+           void *) -> hermes::vm::CallResult<hermes::vm::PseudoHandle<hermes::vm::JSObject>> {
+            // 实例使用 DecoratedObject，decoration 用于 napi_wrap
+            return hermes::vm::DecoratedObject::create(runtime, prototype, nullptr);
+        },
+        hermes::vm::CellKind::DecoratedObjectKind);
 
     NAPIValue stringValue;
     CHECK_NAPI(napi_create_string_utf8(env, utf8name, &stringValue), Exception, Exception)
@@ -1432,32 +2019,114 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
     return NAPIExceptionOK;
 }
 
+static bool isRuntimeConfigValid(const NAPIRuntimeConfig *config)
+{
+    return !config || (config->version && config->version <= NAPI_RUNTIME_CONFIG_VERSION);
+}
+
 NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
 {
+    return NAPICreateRuntimeWithConfig(runtime, nullptr);
+}
+
+NAPIErrorStatus NAPICreateRuntimeWithConfig(NAPIRuntime *runtime, const NAPIRuntimeConfig *config)
+{
+    CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(isRuntimeConfigValid(config), NAPIErrorInvalidArg)
+
+    *runtime = new (std::nothrow) OpaqueNAPIRuntime();
+    RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError)
+    if (config)
+    {
+        // version 1 的结构体不包含 externalMemoryLimit，不能整体拷贝
+        std::memcpy(&(*runtime)->config, config,
+                    config->version >= 2 ? sizeof(NAPIRuntimeConfig)
+                                         : offsetof(NAPIRuntimeConfig, externalMemoryLimit));
+    }
+    (*runtime)->config.version = NAPI_RUNTIME_CONFIG_VERSION;
+
     return NAPIErrorOK;
 }
 
 NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
 {
+    CHECK_ARG(runtime, Common)
+
+    codeCacheFree(runtime->codeCache);
+    delete runtime;
+
     return NAPICommonOK;
 }
 
 NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+{
+    return NAPICreateEnvWithConfig(env, runtime, nullptr);
+}
+
+// env 配置的非 0 字段优先，其次是 runtime 配置
+static size_t getConfigValue(NAPIRuntime runtime, const NAPIRuntimeConfig *config,
+                             size_t NAPIRuntimeConfig::*field)
+{
+    if (config && config->*field)
+    {
+        return config->*field;
+    }
+
+    return runtime ? runtime->config.*field : 0;
+}
+
+// runtime 可空，兼容之前 NAPICreateRuntime 不返回对象的用法
+NAPIErrorStatus NAPICreateEnvWithConfig(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeConfig *config)
 {
     CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(isRuntimeConfigValid(config), NAPIErrorInvalidArg)
 
+    size_t maxHeapSize = getConfigValue(runtime, config, &NAPIRuntimeConfig::maxHeapSize);
+    if (!maxHeapSize)
+    {
+        maxHeapSize = getConfigValue(runtime, config, &NAPIRuntimeConfig::memoryLimit);
+    }
+    if (!maxHeapSize)
+    {
+        maxHeapSize = 1024 << 20;
+    }
+    // gcheapsize_t 为 32 位，直接转换会截断，超过上限时按上限处理
+    maxHeapSize = std::min<size_t>(maxHeapSize, std::numeric_limits<hermes::vm::gcheapsize_t>::max());
     auto gcConfigBuilder = hermes::vm::GCConfig::Builder()
                                .withName("N-API")
                                //                                   .withAllocInYoung(false)
                                //                                   .withRevertToYGAtTTI(true)
-                               .withMaxHeapSize(1024 << 20);
+                               .withMaxHeapSize(static_cast<hermes::vm::gcheapsize_t>(maxHeapSize));
+    size_t initialHeapSize = getConfigValue(runtime, config, &NAPIRuntimeConfig::initialHeapSize);
+    if (initialHeapSize)
+    {
+        gcConfigBuilder.withInitHeapSize(static_cast<hermes::vm::gcheapsize_t>(std::min(initialHeapSize, maxHeapSize)));
+    }
+    uint32_t registerCount = config ? config->registerCount : 0;
+    if (!registerCount && runtime)
+    {
+        registerCount = runtime->config.registerCount;
+    }
+    if (!registerCount)
+    {
+        size_t stackSize = getConfigValue(runtime, config, &NAPIRuntimeConfig::stackSize);
+        registerCount =
+            stackSize ? static_cast<uint32_t>(stackSize / sizeof(hermes::vm::PinnedHermesValue)) : kMaxNumRegisters;
+    }
     auto runtimeConfig = hermes::vm::RuntimeConfig::Builder()
                              .withGCConfig(gcConfigBuilder.build())
                              //                                 .withRegisterStack(nullptr)
-                             .withMaxNumRegisters(kMaxNumRegisters)
+                             .withMaxNumRegisters(registerCount)
                              .build();
     *env = new (std::nothrow) OpaqueNAPIEnv(runtimeConfig);
     RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
+    if (!(*env)->finalizerQueue || !(*env)->externalMemory)
+    {
+        delete *env;
+
+        return NAPIErrorMemoryError;
+    }
+    (*env)->napiRuntime = runtime;
 
     return NAPIErrorOK;
 }
@@ -1493,11 +2162,216 @@ NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
 {
     CHECK_ARG(env, Common)
 
+    // 未调用 NAPIStopProfiling 直接丢弃采样结果
+    NAPIEnv expectedEnv = env;
+    if (profilingEnv.compare_exchange_strong(expectedEnv, nullptr))
+    {
+        facebook::hermes::HermesRuntime::disableSamplingProfiler();
+    }
     delete env;
 
     return NAPICommonOK;
 }
 
+NAPICommonStatus NAPISetFinalizerMode(NAPIEnv env, NAPIFinalizerMode mode)
+{
+    CHECK_ARG(env, Common)
+
+    finalizerQueueSetMode(env->finalizerQueue, mode);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIRunPendingFinalizers(NAPIEnv env, size_t budget, size_t *remaining)
+{
+    CHECK_ARG(env, Common)
+
+    size_t count = finalizerQueueDrain(env->finalizerQueue, budget);
+    if (remaining)
+    {
+        *remaining = count;
+    }
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIGetFinalizerStats(NAPIEnv env, NAPIFinalizerStats *stats)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
+
+    finalizerQueueGetStats(env->finalizerQueue, stats);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIRunGC(NAPIEnv env, NAPIGCKind kind)
+{
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(kind == NAPIGCKindFull || kind == NAPIGCKindYoung, NAPICommonInvalidArg)
+
+    // Hades 没有公开单独回收新生代的接口，collect 为同步完整 GC
+    env->getRuntime()->collect(kind == NAPIGCKindFull ? "napi full" : "napi young");
+    // GC 期间析构的 External 只扣除了计数，这里同步给 GC
+    env->syncExternalMemory();
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level)
+{
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(level == NAPIMemoryPressureLevelModerate || level == NAPIMemoryPressureLevelCritical,
+                           NAPICommonInvalidArg)
+
+    env->getRuntime()->collect(level == NAPIMemoryPressureLevelCritical ? "memory pressure critical"
+                                                                        : "memory pressure moderate");
+    if (level == NAPIMemoryPressureLevelCritical)
+    {
+        finalizerQueueDrain(env->finalizerQueue, 0);
+    }
+    env->syncExternalMemory();
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStats *stats)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
+
+    // getHeapInfo 只读取计数，不遍历堆；Hermes 不统计对象数量
+    hermes::vm::GCBase::HeapInfo heapInfo;
+    env->getRuntime()->getHeap().getHeapInfo(heapInfo);
+    stats->usedHeapSize = heapInfo.allocatedBytes;
+    stats->totalHeapSize = heapInfo.heapSize;
+    stats->objectCount = 0;
+    stats->stringCount = 0;
+    stats->functionCount = 0;
+    stats->externalMemorySize = externalMemoryAdjust(env->externalMemory, 0);
+    stats->gcCount = heapInfo.numCollections;
+    stats->gcExternalMemorySize = env->creditedExternalMemory;
+    {
+        std::lock_guard<std::mutex> lock(env->gcMutex);
+        stats->gcNanoseconds = env->gcNanoseconds;
+    }
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+
+    // raw_fd_ostream 使用固定大小缓冲区，snapshot 边生成边写入，shouldClose 为 false 不关闭调用方 fd
+    llvh::raw_fd_ostream outputStream(fd, false);
+    env->getRuntime()->getHeap().createSnapshot(outputStream);
+    outputStream.flush();
+    if (outputStream.has_error())
+    {
+        // raw_fd_ostream 析构时存在错误会 report_fatal_error
+        outputStream.clear_error();
+
+        return NAPIErrorGenericFailure;
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIStartProfiling(NAPIEnv env, uint32_t /*sampleIntervalUs*/)
+{
+    CHECK_ARG(env, Error)
+
+    // SamplingProfiler 使用独立线程按固定间隔发送信号采样所有 runtime，不支持自定义间隔
+    NAPIEnv expectedEnv = nullptr;
+    RETURN_STATUS_IF_FALSE(profilingEnv.compare_exchange_strong(expectedEnv, env), NAPIErrorGenericFailure)
+    facebook::hermes::HermesRuntime::enableSamplingProfiler();
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIStopProfiling(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+    NAPIEnv expectedEnv = env;
+    RETURN_STATUS_IF_FALSE(profilingEnv.compare_exchange_strong(expectedEnv, nullptr), NAPIErrorInvalidArg)
+
+    facebook::hermes::HermesRuntime::disableSamplingProfiler();
+    FileDescriptorStreamBuffer streamBuffer(fd);
+    std::ostream outputStream(&streamBuffer);
+    facebook::hermes::HermesRuntime::dumpSampledTraceToStream(outputStream);
+    outputStream.flush();
+    RETURN_STATUS_IF_FALSE(!streamBuffer.hasError(), NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPISetInterruptHandler(NAPIRuntime runtime, NAPIInterruptHandler /*handler*/, void * /*data*/)
+{
+    CHECK_ARG(runtime, Error)
+
+    // Hermes 只提供 asyncTriggerTimeout，没有周期性的回调
+    return NAPIErrorGenericFailure;
+}
+
+NAPIErrorStatus NAPIStartTracing(NAPIEnv env, uint32_t capacity)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(!env->trace, NAPIErrorGenericFailure)
+
+    Trace *trace = traceCreate(capacity);
+    RETURN_STATUS_IF_FALSE(trace, NAPIErrorMemoryError)
+    std::lock_guard<std::mutex> lock(env->gcMutex);
+    env->trace = trace;
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIStopTracing(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    std::lock_guard<std::mutex> lock(env->gcMutex);
+    traceFree(env->trace);
+    env->trace = nullptr;
+    env->gcTraceBeginTime = 0;
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIFlushTrace(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+    RETURN_STATUS_IF_FALSE(env->trace, NAPIErrorInvalidArg)
+
+    // trace 只在 env 线程释放，这里不需要持有 gcMutex
+    RETURN_STATUS_IF_FALSE(traceWrite(env->trace, fd), NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIBeginTraceSpan(NAPIEnv env, const char *name)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(name, Common)
+
+    traceBeginSpan(env->trace, name);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIEndTraceSpan(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    traceEndSpan(env->trace);
+
+    return NAPICommonOK;
+}
+
 NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
 {
     CHECK_ARG(env, Error)
@@ -1560,17 +2434,480 @@ NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
     return NAPICommonOK;
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv, const char *, const char *, const uint8_t **, size_t *)
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+{
+    return NAPICompileToByteBufferWithOptions(env, script, sourceUrl, nullptr, byteBuffer, bufferSize);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBufferWithOptions(NAPIEnv env, const char *script,
+                                                                   const char *sourceUrl,
+                                                                   const NAPICompileOptions *options,
+                                                                   const uint8_t **byteBuffer, size_t *bufferSize)
 {
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
+    CHECK_ARG(bufferSize, Exception)
+    RETURN_STATUS_IF_FALSE(!options || (options->version && options->version <= NAPI_COMPILE_OPTIONS_VERSION),
+                           NAPIExceptionInvalidArg)
+
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    // 序列化要求全部函数完成编译，不能 lazy；parser 要求 buffer 结尾为 \0，Buffer 不持有 script，只在编译期间使用
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.format = hermes::EmitBundle;
+    size_t scriptLength = std::strlen(script);
+    auto bcProviderAndError = hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(
+        std::make_unique<hermes::Buffer>(reinterpret_cast<const uint8_t *>(script), scriptLength), sourceUrl,
+        compileFlags);
+    if (!bcProviderAndError.first)
+    {
+        (void)env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(bcProviderAndError.second.c_str()));
+
+        return NAPIExceptionPendingException;
+    }
+    std::string bytecode =
+        serializeBytecode(*bcProviderAndError.first, script, scriptLength, options && options->stripDebugInfo);
+    auto buffer = static_cast<uint8_t *>(malloc(bytecode.size()));
+    RETURN_STATUS_IF_FALSE(buffer, NAPIExceptionMemoryError)
+    std::memcpy(buffer, bytecode.data(), bytecode.size());
+    *byteBuffer = buffer;
+    *bufferSize = bytecode.size();
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "NAPICompileToByteBuffer", sourceUrl, traceBeginTime);
+
     return NAPIExceptionOK;
 }
 
-NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv, const uint8_t *)
+NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
 {
+    CHECK_ARG(env, Common)
+
+    free(const_cast<uint8_t *>(byteBuffer));
+
     return NAPICommonOK;
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv, const uint8_t *byteBuffer, size_t, NAPIValue *)
+// buffer 交给 BCProvider 持有，和 RuntimeModule 生命周期一致
+static NAPIExceptionStatus runByteBuffer(NAPIEnv env, std::unique_ptr<const hermes::Buffer> buffer, NAPIValue *result)
 {
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    size_t bufferSize = buffer->size();
+    // 校验 magic/版本/长度，失败时 buffer 随 unique_ptr 释放
+    auto bcProviderAndError = hermes::hbc::BCProviderFromBuffer::createBCProviderFromBuffer(std::move(buffer));
+    if (!bcProviderAndError.first)
+    {
+        (void)env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(bcProviderAndError.second.c_str()));
+
+        return NAPIExceptionPendingException;
+    }
+    hermes::vm::RuntimeModuleFlags runtimeModuleFlags;
+    runtimeModuleFlags.persistent = true;
+    NAPI_USDT_PROBE2(bytecode_start, env, bufferSize);
+    auto callResult = env->getRuntime()->runBytecode(std::move(bcProviderAndError.first), runtimeModuleFlags, "",
+                                                     hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+    NAPI_USDT_PROBE1(bytecode_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunByteBuffer", nullptr, traceBeginTime);
+    CHECK_HERMES(callResult)
+    if (result)
+    {
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    }
+
     return NAPIExceptionOK;
 }
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                                  NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
+    // malloc(0) 可能返回 NULL，不能当作内存不足
+    CHECK_ARG(bufferSize, Exception)
+
+    // 调用方可以在返回后释放 byteBuffer，需要复制一份，malloc 满足字节码的对齐要求
+    auto data = static_cast<uint8_t *>(malloc(bufferSize));
+    RETURN_STATUS_IF_FALSE(data, NAPIExceptionMemoryError)
+    std::memcpy(data, byteBuffer, bufferSize);
+
+    return runByteBuffer(env, std::make_unique<MallocBuffer>(data, bufferSize), result);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFromFile(NAPIEnv env, const char *path, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(path, Exception)
+
+    MappedFile mappedFile;
+    RETURN_STATUS_IF_FALSE(mappedFileOpen(path, false, &mappedFile), NAPIExceptionGenericFailure)
+
+    // mmap 按页对齐，满足字节码的对齐要求
+    return runByteBuffer(env, std::make_unique<MappedFileBuffer>(mappedFile), result);
+}
+
+// HBC 文件头同样会校验版本，这里用于磁盘缓存和归档整体失效
+static std::string getBytecodeEngineVersion()
+{
+    return "Hermes " + std::to_string(hermes::hbc::BYTECODE_VERSION);
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIRuntime runtime, const char *directory, size_t maxSize)
+{
+    CHECK_ARG(runtime, Error)
+
+    CodeCache *codeCache = nullptr;
+    if (directory)
+    {
+        codeCache = codeCacheCreate(directory, getBytecodeEngineVersion().c_str(), maxSize);
+        RETURN_STATUS_IF_FALSE(codeCache, NAPIErrorGenericFailure)
+    }
+    codeCacheFree(runtime->codeCache);
+    runtime->codeCache = codeCache;
+
+    return NAPIErrorOK;
+}
+
+struct OpaqueNAPIScript final
+{
+    // 全量编译，多个 RuntimeModule 共享，执行时不会重复编译
+    std::shared_ptr<hermes::hbc::BCProvider> bcProvider;
+
+    NAPIEnv env;
+
+    std::string sourceUrl;
+};
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, size_t length, const char *sourceUrl,
+                                                  NAPIScript *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    // parser 要求 buffer 结尾为 \0，指定长度时需要复制
+    std::string copiedScript;
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        length = std::strlen(script);
+    }
+    else
+    {
+        copiedScript.assign(script, length);
+        script = copiedScript.c_str();
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.debug = true;
+    auto bcProviderAndError = hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(
+        std::make_unique<hermes::Buffer>(reinterpret_cast<const uint8_t *>(script), length), sourceUrl, compileFlags);
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "NAPICompileScript", sourceUrl, traceBeginTime);
+    if (!bcProviderAndError.first)
+    {
+        (void)env->getRuntime()->raiseSyntaxError(hermes::vm::TwineChar16(bcProviderAndError.second.c_str()));
+
+        return NAPIExceptionPendingException;
+    }
+    auto compiledScript = new (std::nothrow) OpaqueNAPIScript();
+    RETURN_STATUS_IF_FALSE(compiledScript, NAPIExceptionMemoryError)
+    compiledScript->bcProvider = std::move(bcProviderAndError.first);
+    compiledScript->env = env;
+    compiledScript->sourceUrl = sourceUrl;
+    *result = compiledScript;
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPIExceptionInvalidArg)
+
+    hermes::vm::RuntimeModuleFlags runtimeModuleFlags;
+    runtimeModuleFlags.persistent = true;
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, script->sourceUrl.c_str());
+    // 每次执行创建新的 RuntimeModule 和 Domain，不再引用后随 GC 回收
+    auto callResult = env->getRuntime()->runBytecode(std::shared_ptr<hermes::hbc::BCProvider>(script->bcProvider),
+                                                     runtimeModuleFlags, script->sourceUrl,
+                                                     hermes::vm::Runtime::makeNullHandle<hermes::vm::Environment>());
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunCompiledScript", script->sourceUrl.c_str(),
+                  traceBeginTime);
+    CHECK_HERMES(callResult)
+    if (result)
+    {
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPICommonInvalidArg)
+
+    delete script;
+
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                         const NAPIRunScriptOptions *options, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    RETURN_STATUS_IF_FALSE(!options || (options->version && options->version <= NAPI_RUN_SCRIPT_OPTIONS_VERSION),
+                           NAPIExceptionInvalidArg)
+
+    // Runtime::run 传入 NULL 会崩溃，和 QuickJS 一样视为空字符串
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    // 字段为 0 时和 NAPIRunScript 相同
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.lazy = !options || !options->eager;
+    compileFlags.debug = !options || !options->stripDebugInfo;
+    if (options)
+    {
+        compileFlags.optimize = options->optimize;
+        compileFlags.strict = options->strict;
+        if (options->staticBuiltins)
+        {
+            compileFlags.staticBuiltins = true;
+        }
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    auto callResult = env->napiRuntime && env->napiRuntime->codeCache
+                          ? runWithCodeCache(env, script, std::strlen(script), sourceUrl, options)
+                          : env->getRuntime()->run(script, sourceUrl, compileFlags);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScriptWithOptions", sourceUrl, traceBeginTime);
+    CHECK_HERMES(callResult)
+    if (result)
+    {
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+struct CompileTask final
+{
+    std::string script;
+    std::string sourceUrl;
+    NAPICompileCallback callback = nullptr;
+    void *data = nullptr;
+};
+
+// 线程池线程执行，HBC 生成和序列化不访问 Runtime
+static void compileTask(void *data)
+{
+    std::unique_ptr<CompileTask> task(static_cast<CompileTask *>(data));
+    // 和 NAPICompileToByteBuffer 相同，std::string 保证结尾为 \0
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.format = hermes::EmitBundle;
+    auto bcProviderAndError = hermes::hbc::BCProviderFromSrc::createBCProviderFromSrc(
+        std::make_unique<hermes::Buffer>(reinterpret_cast<const uint8_t *>(task->script.c_str()), task->script.size()),
+        task->sourceUrl, compileFlags);
+    if (!bcProviderAndError.first)
+    {
+        task->callback(nullptr, 0, bcProviderAndError.second.c_str(), task->data);
+
+        return;
+    }
+    std::string bytecode =
+        serializeBytecode(*bcProviderAndError.first, task->script.c_str(), task->script.size(), false);
+    auto buffer = static_cast<uint8_t *>(malloc(bytecode.size()));
+    if (buffer)
+    {
+        std::memcpy(buffer, bytecode.data(), bytecode.size());
+    }
+    task->callback(buffer, buffer ? bytecode.size() : 0, nullptr, task->data);
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPICompileScriptAsync(NAPIRuntime runtime, const char *script, size_t length,
+                                                   const char *sourceUrl, NAPICompileCallback callback, void *data)
+{
+    CHECK_ARG(runtime, Error)
+    CHECK_ARG(script, Error)
+    CHECK_ARG(callback, Error)
+
+    auto task = new (std::nothrow) CompileTask();
+    RETURN_STATUS_IF_FALSE(task, NAPIErrorMemoryError)
+    task->script.assign(script, length == NAPI_AUTO_LENGTH ? std::strlen(script) : length);
+    task->sourceUrl = sourceUrl ? sourceUrl : "";
+    task->callback = callback;
+    task->data = data;
+    if (!threadPoolSubmit(compileTask, task))
+    {
+        delete task;
+
+        return NAPIErrorGenericFailure;
+    }
+
+    return NAPIErrorOK;
+}
+
+// script 为 scriptSourceJoin 的结果，交给 MallocBuffer 持有，lazy 编译时 Runtime 直接保留，不再复制
+static NAPIExceptionStatus runScriptSource(NAPIEnv env, char *script, size_t length, const char *sourceUrl,
+                                           const char *traceName, NAPIValue *result)
+{
+    auto buffer = std::make_unique<MallocBuffer>(reinterpret_cast<const uint8_t *>(script), length);
+    hermes::hbc::CompileFlags compileFlags = {};
+    compileFlags.lazy = true;
+    compileFlags.debug = true;
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    auto callResult = env->napiRuntime && env->napiRuntime->codeCache
+                          ? runWithCodeCache(env, script, length, sourceUrl, nullptr)
+                          : env->getRuntime()->run(std::move(buffer), sourceUrl, compileFlags);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, traceName, sourceUrl, traceBeginTime);
+    CHECK_HERMES(callResult)
+    if (result)
+    {
+        *result = (NAPIValue)env->getRuntime()->makeHandle(callResult.getValue()).unsafeGetPinnedHermesValue();
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithLength(NAPIEnv env, const char *script, size_t length,
+                                                        const char *sourceUrl, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+
+    // parser 要求结尾为 \0，副本交给 Runtime 持有，不需要再复制
+    char *copiedScript = scriptSourceJoin(&script, &length, 1, &length);
+    RETURN_STATUS_IF_FALSE(copiedScript, NAPIExceptionMemoryError)
+
+    return runScriptSource(env, copiedScript, length, sourceUrl ? sourceUrl : "", "NAPIRunScriptWithLength", result);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptChunks(NAPIEnv env, const char *const *chunks, const size_t *lengths,
+                                                    size_t chunkCount, const char *sourceUrl, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    RETURN_STATUS_IF_FALSE(chunks || !chunkCount, NAPIExceptionInvalidArg)
+
+    size_t length;
+    char *script = scriptSourceJoin(chunks, lengths, chunkCount, &length);
+    RETURN_STATUS_IF_FALSE(script, NAPIExceptionMemoryError)
+
+    return runScriptSource(env, script, length, sourceUrl ? sourceUrl : "", "NAPIRunScriptChunks", result);
+}
+
+// Hermes 没有 ES 模块支持
+NAPI_EXPORT NAPIErrorStatus NAPISetModuleLoader(NAPIEnv /*env*/, NAPIModuleResolveCallback /*resolveCallback*/,
+                                                NAPIModuleLoadCallback /*loadCallback*/, void * /*data*/)
+{
+    return NAPIErrorGenericFailure;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunModule(NAPIEnv /*env*/, const char * /*script*/, const char * /*moduleName*/,
+                                              NAPIValue * /*result*/)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+const char *bytecodeArchiveGetEngineVersion()
+{
+    // 返回的指针需要一直有效
+    static const std::string engineVersion = getBytecodeEngineVersion();
+
+    return engineVersion.c_str();
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunArchiveModule(NAPIEnv env, NAPIArchive archive, const char *moduleName,
+                                                     NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(archive, Exception)
+    CHECK_ARG(moduleName, Exception)
+
+    auto bytecodeArchive = (BytecodeArchive *)archive;
+    uint32_t moduleIndex;
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveFindModule(bytecodeArchive, moduleName, &moduleIndex),
+                           NAPIExceptionGenericFailure)
+    if (!env->archiveResultCache)
+    {
+        env->archiveResultCache = bytecodeArchiveResultCacheCreate();
+        RETURN_STATUS_IF_FALSE(env->archiveResultCache, NAPIExceptionMemoryError)
+    }
+    auto reference = (NAPIRef)bytecodeArchiveResultCacheGet(env->archiveResultCache, bytecodeArchive, moduleIndex);
+    if (reference)
+    {
+        return result ? napi_get_reference_value(env, reference, result) : NAPIExceptionOK;
+    }
+    const uint8_t *byteBuffer;
+    size_t bufferSize;
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveLoadModule(bytecodeArchive, moduleIndex, &byteBuffer, &bufferSize),
+                           NAPIExceptionGenericFailure)
+
+    // 归档内字节码 8 字节对齐，不复制；抛出异常时不缓存，下次调用重新执行
+    NAPIValue returnValue;
+    CHECK_NAPI(runByteBuffer(env, std::make_unique<ArchiveBuffer>(bytecodeArchive, byteBuffer, bufferSize),
+                             &returnValue),
+               Exception, Exception)
+    CHECK_NAPI(napi_create_reference(env, returnValue, 1, &reference), Exception, Exception)
+    if (!bytecodeArchiveResultCacheSet(env->archiveResultCache, bytecodeArchive, moduleIndex, reference))
+    {
+        napi_delete_reference(env, reference);
+
+        return NAPIExceptionMemoryError;
+    }
+    if (result)
+    {
+        *result = returnValue;
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIGetBytecodeStats(const uint8_t *byteBuffer, size_t bufferSize,
+                                                 NAPIBytecodeStats *result)
+{
+    CHECK_ARG(byteBuffer, Error)
+    CHECK_ARG(result, Error)
+
+    // 校验 magic/版本/长度，Buffer 不持有 byteBuffer
+    auto bcProviderAndError = hermes::hbc::BCProviderFromBuffer::createBCProviderFromBuffer(
+        std::make_unique<hermes::Buffer>(byteBuffer, bufferSize));
+    RETURN_STATUS_IF_FALSE(bcProviderAndError.first, NAPIErrorGenericFailure)
+    const auto &bcProvider = *bcProviderAndError.first;
+    result->totalSize = bufferSize;
+    result->functionCount = bcProvider.getFunctionCount();
+    result->codeSize = 0;
+    for (uint32_t i = 0; i < bcProvider.getFunctionCount(); ++i)
+    {
+        result->codeSize += bcProvider.getFunctionHeader(i).bytecodeSizeInBytes();
+    }
+    result->constantSize = bcProvider.getArrayBuffer().size() + bcProvider.getObjectKeyBuffer().size() +
+                           bcProvider.getObjectValueBuffer().size();
+    result->atomSize = bcProvider.getStringStorage().size();
+    // debug info 段之后只有 footer
+    auto header = reinterpret_cast<const hermes::hbc::BytecodeFileHeader *>(byteBuffer);
+    size_t debugInfoEnd = header->fileLength - sizeof(hermes::hbc::BytecodeFileFooter);
+    result->debugInfoSize = header->debugInfoOffset < debugInfoEnd ? debugInfoEnd - header->debugInfoOffset : 0;
+
+    return NAPIErrorOK;
+}
@@ -34,19 +34,34 @@
 #include <napi/js_native_api_types.h>
 #include <stdio.h>
 #include <stdlib.h>
-
-struct OpaqueNAPIRef
-{
-    LIST_ENTRY(OpaqueNAPIRef) node; // size_t
-    JSValueRef value;               // size_t
-    uint8_t count;                  // 8
-    struct ReferenceInfo *weakRefInfo;    // 8
+#include <string.h>
+
+// JSBasePrivate.h，iOS/macOS 系统库均导出
+JS_EXPORT void JSReportExtraMemoryCost(JSContextRef ctx, size_t size);
+
+// private header
+#include "js_native_api_bytecode_archive.h"
+#include "js_native_api_external_memory.h"
+#include "js_native_api_finalizer_queue.h"
+#include "js_native_api_reference_table.h"
+#include "js_native_api_script_source.h"
+#include "trace/js_native_api_trace.h"
+#include "trace/js_native_api_usdt.h"
+
+// NAPIRef 为 env->referenceTable 中 slot 的句柄
+struct Reference
+{
+    LIST_ENTRY(Reference) node; // size_t * 2
+    JSValueRef value;           // size_t
+    // 弱引用并且 weakRefInfo 非空时 node 位于 weakRefInfo->referenceList
+    struct ReferenceInfo *weakRefInfo; // size_t
+    uint32_t count;                    // uint32_t
 };
 
 struct ReferenceInfo
 {
     LIST_ENTRY(ReferenceInfo) node;
-    LIST_HEAD(, OpaqueNAPIRef) referenceList;
+    LIST_HEAD(, Reference) referenceList;
     bool isEnvFreed;
 };
 
@@ -57,9 +72,18 @@ struct OpaqueNAPIEnv
     JSGlobalContextRef context; // size_t
     JSValueRef lastException;   // size_t
     JSObjectRef weakMap;
+    // NAPIDefineClass 实例的父类，private 用于 napi_wrap
+    JSClassRef instanceClassRef;
+    // 所有 External 共享，避免每次创建 JSClass 和 Structure
+    JSClassRef externalClassRef;
     LIST_HEAD(, ReferenceInfo) referenceList;
-    LIST_HEAD(, OpaqueNAPIRef) strongRefList;
-    LIST_HEAD(, OpaqueNAPIRef) valueList;
+    struct ReferenceTable referenceTable;
+    struct FinalizerQueue *finalizerQueue;
+    struct ExternalMemory *externalMemory;
+    // NAPIStartTracing 开启，否则为 NULL
+    struct Trace *trace;
+    // JavaScriptCore 不需要 handle scope，只记录深度用于判断最外层
+    uint32_t handleScopeDepth;
 };
 
 // NAPIMemoryError
@@ -169,6 +193,11 @@ typedef struct
                                    //    BaseInfo baseInfo;
     NAPIFinalize finalizeCallback; // size_t
     void *finalizeHint;            // size_t
+    // 设置 finalizeCallback 时持有
+    struct FinalizerQueue *finalizerQueue; // size_t
+    // externalMemorySize 非 0 时持有
+    struct ExternalMemory *externalMemory; // size_t
+    size_t externalMemorySize;             // size_t
 } ExternalInfo;
 
 typedef struct
@@ -228,7 +257,9 @@ static JSValueRef callAsFunction(JSContextRef ctx, JSObjectRef function, JSObjec
     callbackInfo.argv = arguments;
     callbackInfo.data = functionInfo->baseInfo.data;
 
+    NAPI_USDT_PROBE2(callback_entry, functionInfo->baseInfo.env, functionInfo->callback);
     JSValueRef returnValue = (JSValueRef)functionInfo->callback(functionInfo->baseInfo.env, &callbackInfo);
+    NAPI_USDT_PROBE2(callback_return, functionInfo->baseInfo.env, functionInfo->callback);
     if (functionInfo->baseInfo.env->lastException)
     {
         *exception = functionInfo->baseInfo.env->lastException;
@@ -343,7 +374,7 @@ NAPICommonStatus napi_typeof(NAPIEnv env, NAPIValue value, NAPIValueType *result
         }
         else
         {
-            if (JSObjectGetPrivate(object))
+            if (JSValueIsObjectOfClass(env->context, object, env->externalClassRef))
             {
                 *result = NAPIExternal;
             }
@@ -776,9 +807,14 @@ static void constructorFinalize(JSObjectRef object)
 static void externalFinalize(JSObjectRef object)
 {
     ExternalInfo *info = JSObjectGetPrivate(object);
+    if (info && info->externalMemory)
+    {
+        externalMemoryAdjust(info->externalMemory, -(int64_t)info->externalMemorySize);
+        externalMemoryRelease(info->externalMemory);
+    }
     if (info && info->finalizeCallback)
     {
-        info->finalizeCallback(info->data, info->finalizeHint);
+        finalizerQueueFinalize(info->finalizerQueue, info->finalizeCallback, info->data, info->finalizeHint);
     }
     free(info);
 }
@@ -838,8 +874,12 @@ static JSObjectRef callAsConstructor(JSContextRef ctx, JSObjectRef constructor,
     callbackInfo.argv = arguments;
     callbackInfo.data = constructorInfo->functionInfo.baseInfo.data;
 
+    NAPI_USDT_PROBE2(constructor_entry, constructorInfo->functionInfo.baseInfo.env,
+                     constructorInfo->functionInfo.callback);
     JSValueRef returnValue =
         (JSValueRef)constructorInfo->functionInfo.callback(constructorInfo->functionInfo.baseInfo.env, &callbackInfo);
+    NAPI_USDT_PROBE2(constructor_return, constructorInfo->functionInfo.baseInfo.env,
+                     constructorInfo->functionInfo.callback);
     if (constructorInfo->functionInfo.baseInfo.env->lastException)
     {
         *exception = constructorInfo->functionInfo.baseInfo.env->lastException;
@@ -885,6 +925,8 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
     // 不能使用 kJSClassAttributeNoAutomaticPrototype，因为所有 instance
     // 应当共享 Constructor.prototype
     classDefinition.className = utf8name;
+    // 父类提供 finalize，子类 finalize 后会依次调用父类 finalize
+    classDefinition.parentClass = env->instanceClassRef;
     constructorInfo->classRef = JSClassCreate(&classDefinition);
     if (!constructorInfo->classRef)
     {
@@ -930,6 +972,12 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
 
 NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
                                          NAPIValue *result)
+{
+    return NAPICreateExternalWithSize(env, data, finalizeCB, finalizeHint, 0, result);
+}
+
+NAPIExceptionStatus NAPICreateExternalWithSize(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
+                                               size_t externalMemorySize, NAPIValue *result)
 {
     CHECK_ARG(env, Exception)
     CHECK_ARG(result, Exception)
@@ -939,24 +987,25 @@ NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize f
     externalInfo->data = data;
     externalInfo->finalizeCallback = finalizeCB;
     externalInfo->finalizeHint = finalizeHint;
-    JSClassDefinition classDefinition = kJSClassDefinitionEmpty;
-    classDefinition.className = "External";
-    classDefinition.attributes = kJSClassAttributeNoAutomaticPrototype;
-    classDefinition.finalize = externalFinalize;
-    JSClassRef classRef = JSClassCreate(&classDefinition);
-    if (!classRef)
+    externalInfo->finalizerQueue = NULL;
+    externalInfo->externalMemory = NULL;
+    externalInfo->externalMemorySize = 0;
+    JSObjectRef objectRef = JSObjectMake(env->context, env->externalClassRef, externalInfo);
+    if (!objectRef)
     {
         free(externalInfo);
 
         return NAPIExceptionMemoryError;
     }
-    JSObjectRef objectRef = JSObjectMake(env->context, classRef, externalInfo);
-    JSClassRelease(classRef);
-    if (!objectRef)
+    if (finalizeCB)
     {
-        free(externalInfo);
-
-        return NAPIExceptionMemoryError;
+        externalInfo->finalizerQueue = finalizerQueueRetain(env->finalizerQueue);
+    }
+    if (externalMemorySize)
+    {
+        externalInfo->externalMemory = externalMemoryRetain(env->externalMemory);
+        externalInfo->externalMemorySize = externalMemorySize;
+        napi_adjust_external_memory(env, (int64_t)externalMemorySize, NULL);
     }
     *result = (NAPIValue)objectRef;
 
@@ -980,6 +1029,111 @@ NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **res
     return NAPIErrorOK;
 }
 
+NAPICommonStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
+{
+    CHECK_ARG(env, Common)
+
+    int64_t totalSize = externalMemoryAdjust(env->externalMemory, changeInBytes);
+    if (changeInBytes > 0)
+    {
+        // 交给 JavaScriptCore 自身的 extra memory 启发式决定何时 GC，下一次 GC 周期开始时清零
+        JSReportExtraMemoryCost(env->context, (size_t)changeInBytes);
+    }
+    if (adjustedValue)
+    {
+        *adjustedValue = totalSize;
+    }
+
+    return NAPICommonOK;
+}
+
+static JSObjectRef getInstanceObject(NAPIEnv env, NAPIValue value)
+{
+    if (!JSValueIsObjectOfClass(env->context, (JSValueRef)value, env->instanceClassRef))
+    {
+        return NULL;
+    }
+    JSValueRef exception = NULL;
+    JSObjectRef objectRef = JSValueToObject(env->context, (JSValueRef)value, &exception);
+
+    return exception ? NULL : objectRef;
+}
+
+// NAPIObjectExpected/NAPIInvalidArg/NAPIMemoryError + napi_create_reference
+NAPIExceptionStatus napi_wrap(NAPIEnv env, NAPIValue jsObject, void *nativeObject, NAPIFinalize finalizeCB,
+                              void *finalizeHint, NAPIRef *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(jsObject, Exception)
+
+    JSObjectRef objectRef = getInstanceObject(env, jsObject);
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIExceptionObjectExpected)
+    RETURN_STATUS_IF_FALSE(!JSObjectGetPrivate(objectRef), NAPIExceptionInvalidArg)
+    ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
+    externalInfo->data = nativeObject;
+    externalInfo->finalizeHint = finalizeHint;
+    externalInfo->finalizeCallback = NULL;
+    externalInfo->finalizerQueue = NULL;
+    externalInfo->externalMemory = NULL;
+    externalInfo->externalMemorySize = 0;
+    JSObjectSetPrivate(objectRef, externalInfo);
+    if (result)
+    {
+        NAPIExceptionStatus status = napi_create_reference(env, jsObject, 0, result);
+        if (status != NAPIExceptionOK)
+        {
+            JSObjectSetPrivate(objectRef, NULL);
+            free(externalInfo);
+
+            return status;
+        }
+    }
+    // 成功后才设置回调
+    externalInfo->finalizeCallback = finalizeCB;
+    if (finalizeCB)
+    {
+        externalInfo->finalizerQueue = finalizerQueueRetain(env->finalizerQueue);
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_unwrap(NAPIEnv env, NAPIValue jsObject, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+    CHECK_ARG(result, Error)
+
+    JSObjectRef objectRef = getInstanceObject(env, jsObject);
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIErrorObjectExpected)
+    ExternalInfo *externalInfo = JSObjectGetPrivate(objectRef);
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIErrorInvalidArg)
+    *result = externalInfo->data;
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_remove_wrap(NAPIEnv env, NAPIValue jsObject, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+
+    JSObjectRef objectRef = getInstanceObject(env, jsObject);
+    RETURN_STATUS_IF_FALSE(objectRef, NAPIErrorObjectExpected)
+    ExternalInfo *externalInfo = JSObjectGetPrivate(objectRef);
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIErrorInvalidArg)
+    if (result)
+    {
+        *result = externalInfo->data;
+    }
+    JSObjectSetPrivate(objectRef, NULL);
+    finalizerQueueRelease(externalInfo->finalizerQueue);
+    free(externalInfo);
+
+    return NAPIErrorOK;
+}
+
 static const char *const REFERENCE_STRING_WEAKMAP_SET = "set";
 static const char *const REFERENCE_STRING_WEAKMAP_GET = "get";
 static const char *const REFERENCE_STRING_WEAKMAP_DELETE = "delete";
@@ -995,13 +1149,13 @@ static void referenceFinalize(void *finalizeData, void *finalizeHint)
     struct ReferenceInfo *referenceInfo = finalizeData;
     if (!referenceInfo->isEnvFreed)
     {
-        NAPIRef reference, temp;
+        struct Reference *reference, *temp;
         LIST_FOREACH_SAFE(reference, &referenceInfo->referenceList, node, temp)
         {
             assert(!reference->count);
             reference->value = JSValueMakeUndefined(((NAPIEnv)finalizeHint)->context);
+            reference->weakRefInfo = NULL;
             LIST_REMOVE(reference, node);
-            LIST_INSERT_HEAD(&((NAPIEnv)finalizeHint)->valueList, reference, node);
         }
         LIST_REMOVE(referenceInfo, node);
     }
@@ -1082,12 +1236,12 @@ static NAPIExceptionStatus weakMapDelete(NAPIEnv env, NAPIValue key){
     return NAPIExceptionOK;
 }
 
-// create_reference | unref ,调用时 JSValue 必定有效，因此无需判断 ref->weakRefInfo != external.referenceInfo 的情况
-static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
+// create_reference | unref ,调用时 JSValue 必定有效，因此无需判断 reference->weakRefInfo != external.referenceInfo 的情况
+static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, struct Reference *reference)
 {
     CHECK_ARG(env, Exception)
     CHECK_ARG(value, Exception)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(reference, Exception)
 
     NAPIValue referenceValue;
     CHECK_NAPI(weakMapGet(env, value, &referenceValue), Exception, Exception)
@@ -1098,8 +1252,8 @@ static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
     if (valueType == NAPIUndefined)
     {
         referenceInfo = malloc(sizeof(struct ReferenceInfo));
-        referenceInfo->isEnvFreed = false;
         RETURN_STATUS_IF_FALSE(referenceInfo, NAPIExceptionMemoryError)
+        referenceInfo->isEnvFreed = false;
         LIST_INIT(&referenceInfo->referenceList);
         {
             NAPIExceptionStatus status =
@@ -1120,15 +1274,15 @@ static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
     {
         CHECK_NAPI(napi_get_value_external(env, referenceValue, (void **)&referenceInfo), Error, Exception)
         //强->弱，才有效。
-        if (!referenceInfo || ref->weakRefInfo != NULL)
+        if (!referenceInfo || reference->weakRefInfo != NULL)
         {
             assert(false);
 
             return NAPIExceptionGenericFailure;
         }
     }
-    LIST_INSERT_HEAD(&referenceInfo->referenceList, ref, node);
-    ref->weakRefInfo = referenceInfo;
+    LIST_INSERT_HEAD(&referenceInfo->referenceList, reference, node);
+    reference->weakRefInfo = referenceInfo;
     return NAPIExceptionOK;
 }
 
@@ -1138,33 +1292,31 @@ NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t
     CHECK_ARG(value, Exception)
     CHECK_ARG(result, Exception)
 
-    *result = malloc(sizeof(struct OpaqueNAPIRef));
-    (*result)->weakRefInfo = NULL;
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    struct Reference *reference = referenceTableAlloc(&env->referenceTable, result);
+    RETURN_STATUS_IF_FALSE(reference, NAPIExceptionMemoryError)
+    reference->weakRefInfo = NULL;
     // 标量 && 弱引用
     if (!JSValueIsObject(env->context, (JSValueRef)value) && !initialRefCount)
     {
-        (*result)->count = 0;
-        (*result)->value = JSValueMakeUndefined(env->context);
-        LIST_INSERT_HEAD(&env->valueList, *result, node);
+        reference->count = 0;
+        reference->value = JSValueMakeUndefined(env->context);
         return NAPIExceptionOK;
     }
     // 对象 || 强引用
-    (*result)->value = (JSValueRef)value;
-    (*result)->count = initialRefCount;
+    reference->value = (JSValueRef)value;
+    reference->count = initialRefCount;
     // 强引用
     if (initialRefCount)
     {
         JSValueProtect(env->context, (JSValueRef)value);
-        LIST_INSERT_HEAD(&env->strongRefList, *result, node);
         return NAPIExceptionOK;
     }
     // 对象 && 弱引用
     // setWeak
-    NAPIExceptionStatus status = setWeak(env, value, *result);
+    NAPIExceptionStatus status = setWeak(env, value, reference);
     if (status != NAPIExceptionOK)
     {
-        free(*result);
+        referenceTableFree(&env->referenceTable, *result);
 
         return status;
     }
@@ -1172,25 +1324,28 @@ NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t
 }
 
 // delete_reference | ref ,调用时 JSValue 未必有效。
-static NAPIExceptionStatus clearWeak(NAPIEnv env, NAPIRef ref)
+static NAPIExceptionStatus clearWeak(NAPIEnv env, struct Reference *reference)
 {
     CHECK_ARG(env, Exception)
-    CHECK_ARG(ref, Exception)
+    CHECK_ARG(reference, Exception)
 
     NAPIValue externalValue;
-    CHECK_NAPI(weakMapGet(env, (NAPIValue)ref->value, &externalValue), Exception, Exception)
+    CHECK_NAPI(weakMapGet(env, (NAPIValue)reference->value, &externalValue), Exception, Exception)
     struct ReferenceInfo *referenceInfo;
     CHECK_NAPI(napi_get_value_external(env, externalValue, (void **)&referenceInfo), Error, Exception)
-    // JSValue 不一定和 ref->value 是同一JS对象，因此需要判断 referenceInfo == NULL || ref->weakRefInfo != referenceInfo 
-    if(referenceInfo && ref->weakRefInfo == referenceInfo){
-        if (!LIST_EMPTY(&referenceInfo->referenceList) && LIST_FIRST(&referenceInfo->referenceList) == ref &&
-            !LIST_NEXT(ref, node))
+    // JSValue 不一定和 reference->value 是同一JS对象，因此需要判断 referenceInfo == NULL || reference->weakRefInfo != referenceInfo 
+    if(referenceInfo && reference->weakRefInfo == referenceInfo){
+        if (!LIST_EMPTY(&referenceInfo->referenceList) && LIST_FIRST(&referenceInfo->referenceList) == reference &&
+            !LIST_NEXT(reference, node))
         {        
-            CHECK_NAPI(weakMapDelete(env, (NAPIValue)ref->value), Exception, Exception)
+            CHECK_NAPI(weakMapDelete(env, (NAPIValue)reference->value), Exception, Exception)
         }
     }
-    LIST_REMOVE(ref, node);
-    ref->weakRefInfo = NULL;
+    if (reference->weakRefInfo)
+    {
+        LIST_REMOVE(reference, node);
+        reference->weakRefInfo = NULL;
+    }
     return NAPIExceptionOK;
 }
 
@@ -1199,24 +1354,25 @@ NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
     CHECK_ARG(env, Exception)
     CHECK_ARG(ref, Exception)
 
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
     // 标量 && 弱引用（被 GC 也会这样）
-    if (!JSValueIsObject(env->context, ref->value) && !ref->count)
+    if (!JSValueIsObject(env->context, reference->value) && !reference->count)
     {
-        LIST_REMOVE(ref, node);
-        free(ref);
+        referenceTableFree(&env->referenceTable, ref);
         return NAPIExceptionOK;
     }
     // 对象 || 强引用
-    if (ref->count)
+    if (reference->count)
     {
-        LIST_REMOVE(ref, node);
-        JSValueUnprotect(env->context, ref->value);
-        free(ref);
+        JSValueUnprotect(env->context, reference->value);
+        referenceTableFree(&env->referenceTable, ref);
         return NAPIExceptionOK;
     }
     // 对象 && 弱引用
-    CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
-    free(ref);
+    CHECK_NAPI(clearWeak(env, reference), Exception, Exception)
+    referenceTableFree(&env->referenceTable, ref);
     return NAPIExceptionOK;
 }
 
@@ -1225,20 +1381,20 @@ NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *resul
     CHECK_ARG(env, Exception)
     CHECK_ARG(ref, Exception)
 
-    if (!ref->count)
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
+    RETURN_STATUS_IF_FALSE(reference->count != UINT32_MAX, NAPIExceptionGenericFailure)
+    if (!reference->count)
     {
-        if (JSValueIsObject(env->context, ref->value))
+        // 标量弱引用不在任何链表中
+        if (JSValueIsObject(env->context, reference->value))
         {
-            CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
+            CHECK_NAPI(clearWeak(env, reference), Exception, Exception)
         }
-        else
-        {
-            LIST_REMOVE(ref, node);
-        }
-        LIST_INSERT_HEAD(&env->strongRefList, ref, node);
-        JSValueProtect(env->context, ref->value);
+        JSValueProtect(env->context, reference->value);
     }
-    uint8_t count = ++ref->count;
+    uint32_t count = ++reference->count;
     if (result)
     {
         *result = count;
@@ -1252,24 +1408,25 @@ NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *res
     CHECK_ARG(env, Exception)
     CHECK_ARG(ref, Exception)
 
-    RETURN_STATUS_IF_FALSE(ref->count, NAPIExceptionGenericFailure)
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
 
-    if (ref->count == 1)
+    RETURN_STATUS_IF_FALSE(reference->count, NAPIExceptionGenericFailure)
+
+    if (reference->count == 1)
     {
-        LIST_REMOVE(ref, node);
-        if (JSValueIsObject(env->context, ref->value))
+        if (JSValueIsObject(env->context, reference->value))
         {
-            CHECK_NAPI(setWeak(env, (NAPIValue)ref->value, ref), Exception, Exception)
-            JSValueUnprotect(env->context, ref->value);
+            CHECK_NAPI(setWeak(env, (NAPIValue)reference->value, reference), Exception, Exception)
+            JSValueUnprotect(env->context, reference->value);
         }
         else
         {
-            LIST_INSERT_HEAD(&env->valueList, ref, node);
-            JSValueUnprotect(env->context, ref->value);
-            ref->value = JSValueMakeUndefined(env->context);
+            JSValueUnprotect(env->context, reference->value);
+            reference->value = JSValueMakeUndefined(env->context);
         }
     }
-    uint8_t count = --ref->count;
+    uint32_t count = --reference->count;
     if (result)
     {
         *result = count;
@@ -1284,12 +1441,15 @@ NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue
     CHECK_ARG(ref, Exception)
     CHECK_ARG(result, Exception)
 
-    if(!ref->count){
-        if(JSValueIsUndefined(env->context, ref->value)){
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
+    if(!reference->count){
+        if(JSValueIsUndefined(env->context, reference->value)){
             *result = NULL;
         }else{
             NAPIValue externalValue = NULL;
-            CHECK_NAPI(weakMapGet(env, (NAPIValue)ref->value, &externalValue), Exception, Exception);
+            CHECK_NAPI(weakMapGet(env, (NAPIValue)reference->value, &externalValue), Exception, Exception);
             if(JSValueIsUndefined(env->context, (JSValueRef)externalValue)){
                 // 引用对应的 JS对象已经释放，但external 由于被分配器打断，可能未来的及销毁
                 // 返回 undefine，等待 referenceFinalize 处理
@@ -1297,17 +1457,17 @@ NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue
             }else{
                 struct ReferenceInfo *referenceInfo;
                 CHECK_NAPI(napi_get_value_external(env, externalValue, (void **)&referenceInfo), Error, Exception);
-                if(referenceInfo && referenceInfo == ref->weakRefInfo){
-                    *result = (NAPIValue)ref->value;
+                if(referenceInfo && referenceInfo == reference->weakRefInfo){
+                    *result = (NAPIValue)reference->value;
                 }else{
-                    // 引用对应的 JS对象已经释放，并且内存被新的 JS 对象分配，weakMap 保存新的对象，因此对比 referenceInfo == ref->weakRefInfo
+                    // 引用对应的 JS对象已经释放，并且内存被新的 JS 对象分配，weakMap 保存新的对象，因此对比 referenceInfo == reference->weakRefInfo
                     // 返回 undefine，等待 referenceFinalize 处理
                     *result = NULL;
                 }
             }           
         }
     }else{
-        *result = (NAPIValue)ref->value;
+        *result = (NAPIValue)reference->value;
     }
     return NAPIExceptionOK;
 }
@@ -1318,13 +1478,29 @@ NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
     CHECK_ARG(result, Error)
 
     *result = (NAPIHandleScope)1;
+    ++env->handleScopeDepth;
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus napi_close_handle_scope(__attribute__((unused)) NAPIEnv env,
-                                         __attribute__((unused)) NAPIHandleScope scope)
+// 最外层 handle scope 关闭，没有 native 代码在栈上，可以执行延迟的 finalizer
+static void closeHandleScope(NAPIEnv env)
 {
+    assert(env->handleScopeDepth && "napi_close_handle_scope() is called more than napi_open_handle_scope().");
+    if (env->handleScopeDepth && !--env->handleScopeDepth)
+    {
+        finalizerQueueDrainAtSafePoint(env->finalizerQueue);
+    }
+}
+
+NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
+{
+    CHECK_ARG(env, Common)
+
+    NAPI_USDT_PROBE2(handle_scope_close, env, scope);
+    closeHandleScope(env);
+
     return NAPICommonOK;
 }
 
@@ -1341,15 +1517,20 @@ NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandl
     *result = malloc(sizeof(struct OpaqueNAPIEscapableHandleScope));
     RETURN_STATUS_IF_FALSE(*result, NAPIErrorMemoryError)
     (*result)->escapeCalled = false;
+    ++env->handleScopeDepth;
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
 
-NAPICommonStatus napi_close_escapable_handle_scope(__attribute__((unused)) NAPIEnv env, NAPIEscapableHandleScope scope)
+NAPICommonStatus napi_close_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandleScope scope)
 {
+    CHECK_ARG(env, Common)
     CHECK_ARG(scope, Common)
 
+    NAPI_USDT_PROBE2(handle_scope_close, env, scope);
     free(scope);
+    closeHandleScope(env);
 
     return NAPICommonOK;
 }
@@ -1416,7 +1597,11 @@ NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *utf8Script, const cha
         sourceUrl = JSStringCreateWithUTF8CString(utf8SourceUrl);
     }
     // JSEvaluateScript 要求 scriptStringRef 必定存在
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, utf8SourceUrl);
     JSValueRef valueRef = JSEvaluateScript(env->context, scriptStringRef, NULL, sourceUrl, 1, &env->lastException);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScript", utf8SourceUrl, traceBeginTime);
     JSStringRelease(scriptStringRef);
     if (utf8SourceUrl)
     {
@@ -1471,8 +1656,16 @@ NAPICommonStatus NAPISetMessageQueueThread(__attribute__((unused)) NAPIEnv env,
 }
 
 NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
+{
+    return NAPICreateRuntimeWithConfig(runtime, NULL);
+}
+
+// JavaScriptCore 公开 API 不支持设置堆和栈参数，这里只校验 version
+NAPIErrorStatus NAPICreateRuntimeWithConfig(NAPIRuntime *runtime, const NAPIRuntimeConfig *config)
 {
     CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(!config || (config->version && config->version <= NAPI_RUNTIME_CONFIG_VERSION),
+                           NAPIErrorInvalidArg)
 
     *runtime = (NAPIRuntime)JSContextGroupCreate();
     RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError);
@@ -1490,8 +1683,15 @@ NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
 }
 
 NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+{
+    return NAPICreateEnvWithConfig(env, runtime, NULL);
+}
+
+NAPIErrorStatus NAPICreateEnvWithConfig(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeConfig *config)
 {
     CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(!config || (config->version && config->version <= NAPI_RUNTIME_CONFIG_VERSION),
+                           NAPIErrorInvalidArg)
 
     *env = malloc(sizeof(struct OpaqueNAPIEnv));
     RETURN_STATUS_IF_FALSE(*env, NAPIErrorMemoryError)
@@ -1505,9 +1705,44 @@ NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
         return NAPIErrorMemoryError;
     }
     (*env)->lastException = NULL;
-    LIST_INIT(&(*env)->strongRefList);
-    LIST_INIT(&(*env)->valueList);
+    JSClassDefinition classDefinition = kJSClassDefinitionEmpty;
+    classDefinition.attributes = kJSClassAttributeNoAutomaticPrototype;
+    classDefinition.finalize = externalFinalize;
+    (*env)->instanceClassRef = JSClassCreate(&classDefinition);
+    if (!(*env)->instanceClassRef)
+    {
+        JSGlobalContextRelease((*env)->context);
+        free(*env);
+
+        return NAPIErrorMemoryError;
+    }
+    classDefinition.className = "External";
+    (*env)->externalClassRef = JSClassCreate(&classDefinition);
+    if (!(*env)->externalClassRef)
+    {
+        JSClassRelease((*env)->instanceClassRef);
+        JSGlobalContextRelease((*env)->context);
+        free(*env);
+
+        return NAPIErrorMemoryError;
+    }
+    (*env)->finalizerQueue = finalizerQueueCreate();
+    (*env)->externalMemory = externalMemoryCreate(0);
+    if (!(*env)->finalizerQueue || !(*env)->externalMemory)
+    {
+        finalizerQueueRelease((*env)->finalizerQueue);
+        externalMemoryRelease((*env)->externalMemory);
+        JSClassRelease((*env)->externalClassRef);
+        JSClassRelease((*env)->instanceClassRef);
+        JSGlobalContextRelease((*env)->context);
+        free(*env);
+
+        return NAPIErrorMemoryError;
+    }
+    (*env)->trace = NULL;
+    (*env)->handleScopeDepth = 0;
     LIST_INIT(&(*env)->referenceList);
+    referenceTableInit(&(*env)->referenceTable, sizeof(struct Reference));
 
     JSStringRef scriptStringRef = JSStringCreateWithUTF8CString("(() => {\
                                                                     return new WeakMap();\
@@ -1535,36 +1770,191 @@ NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
 {
     CHECK_ARG(env, Common)
 
-    NAPIRef ref, temp;
-    LIST_FOREACH_SAFE(ref, &env->strongRefList, node, temp)
+    for (uint32_t i = 0; i < env->referenceTable.slotCount; ++i)
     {
-        LIST_REMOVE(ref, node);
-        JSValueUnprotect(env->context, ref->value);
-        free(ref);
+        struct Reference *reference = referenceTableGetSlot(&env->referenceTable, i);
+        if (reference && reference->count)
+        {
+            JSValueUnprotect(env->context, reference->value);
+        }
     }
     struct ReferenceInfo *referenceInfo, *tempReferenceInfo;
     LIST_FOREACH_SAFE(referenceInfo, &env->referenceList, node, tempReferenceInfo)
     {
-        LIST_FOREACH_SAFE(ref, &referenceInfo->referenceList, node, temp)
-        {
-            LIST_REMOVE(ref, node);
-            free(ref);
-        }
         LIST_REMOVE(referenceInfo, node);
         referenceInfo->isEnvFreed = true;
     }
-    LIST_FOREACH_SAFE(ref, &env->valueList, node, temp)
-    {
-        LIST_REMOVE(ref, node);
-        free(ref);
-    }
+    referenceTableFinalize(&env->referenceTable);
     JSValueUnprotect(env->context, env->weakMap);
     JSGlobalContextRelease(env->context);
+    // 实例持有子类，子类持有父类，这里只释放 env 的引用
+    JSClassRelease(env->instanceClassRef);
+    JSClassRelease(env->externalClassRef);
+    // 之后存活对象的 finalizer 同步调用
+    finalizerQueueClose(env->finalizerQueue);
+    externalMemoryRelease(env->externalMemory);
+    traceFree(env->trace);
     free(env);
 
     return NAPICommonOK;
 }
 
+NAPICommonStatus NAPISetFinalizerMode(NAPIEnv env, NAPIFinalizerMode mode)
+{
+    CHECK_ARG(env, Common)
+
+    finalizerQueueSetMode(env->finalizerQueue, mode);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIRunPendingFinalizers(NAPIEnv env, size_t budget, size_t *remaining)
+{
+    CHECK_ARG(env, Common)
+
+    size_t count = finalizerQueueDrain(env->finalizerQueue, budget);
+    if (remaining)
+    {
+        *remaining = count;
+    }
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIGetFinalizerStats(NAPIEnv env, NAPIFinalizerStats *stats)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
+
+    finalizerQueueGetStats(env->finalizerQueue, stats);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIRunGC(NAPIEnv env, NAPIGCKind kind)
+{
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(kind == NAPIGCKindFull || kind == NAPIGCKindYoung, NAPICommonInvalidArg)
+
+    // 公开 API 只有 JSGarbageCollect，不区分分代，并且只是提示
+    JSGarbageCollect(env->context);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level)
+{
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(level == NAPIMemoryPressureLevelModerate || level == NAPIMemoryPressureLevelCritical,
+                           NAPICommonInvalidArg)
+
+    JSGarbageCollect(env->context);
+    if (level == NAPIMemoryPressureLevelCritical)
+    {
+        finalizerQueueDrain(env->finalizerQueue, 0);
+    }
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStats *stats)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
+
+    // JavaScriptCore 公开 API 没有堆统计
+    memset(stats, 0, sizeof(NAPIHeapStats));
+    stats->externalMemorySize = externalMemoryAdjust(env->externalMemory, 0);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+
+    // JavaScriptCore 的 HeapSnapshotBuilder 没有 C API
+    return NAPIErrorGenericFailure;
+}
+
+NAPIErrorStatus NAPIStartProfiling(NAPIEnv env, __attribute__((unused)) uint32_t sampleIntervalUs)
+{
+    CHECK_ARG(env, Error)
+
+    // JavaScriptCore 的 SamplingProfiler 只能通过 Web Inspector 使用，没有 C API
+    return NAPIErrorGenericFailure;
+}
+
+NAPIErrorStatus NAPIStopProfiling(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+
+    // NAPIStartProfiling 不会成功
+    return NAPIErrorInvalidArg;
+}
+
+NAPIErrorStatus NAPISetInterruptHandler(NAPIRuntime runtime, __attribute__((unused)) NAPIInterruptHandler handler,
+                                        __attribute__((unused)) void *data)
+{
+    CHECK_ARG(runtime, Error)
+
+    // JSContextGroupSetExecutionTimeLimit 只能按时间中断，无法实现通用回调
+    return NAPIErrorGenericFailure;
+}
+
+NAPIErrorStatus NAPIStartTracing(NAPIEnv env, uint32_t capacity)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(!env->trace, NAPIErrorGenericFailure)
+
+    env->trace = traceCreate(capacity);
+    RETURN_STATUS_IF_FALSE(env->trace, NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIStopTracing(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    traceFree(env->trace);
+    env->trace = NULL;
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIFlushTrace(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+    RETURN_STATUS_IF_FALSE(env->trace, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(traceWrite(env->trace, fd), NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIBeginTraceSpan(NAPIEnv env, const char *name)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(name, Common)
+
+    traceBeginSpan(env->trace, name);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIEndTraceSpan(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    traceEndSpan(env->trace);
+
+    return NAPICommonOK;
+}
+
 NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
 {
     CHECK_ARG(env, Error)
@@ -1606,7 +1996,8 @@ NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(__attribute__((unused))
                                                         __attribute__((unused)) const uint8_t **byteBuffer,
                                                         __attribute__((unused)) size_t *bufferSize)
 {
-    return NAPIExceptionOK;
+    // JavaScriptCore 没有公开字节码序列化 API
+    return NAPIExceptionGenericFailure;
 }
 
 NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(__attribute__((unused)) NAPIEnv env,
@@ -1620,5 +2011,223 @@ NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(__attribute__((unused)) NAPIEn
                                                   __attribute__((unused)) size_t bufferSize,
                                                   __attribute__((unused)) NAPIValue *result)
 {
+    return NAPIExceptionGenericFailure;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFromFile(__attribute__((unused)) NAPIEnv env,
+                                                          __attribute__((unused)) const char *path,
+                                                          __attribute__((unused)) NAPIValue *result)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPISetCodeCacheDirectory(__attribute__((unused)) NAPIRuntime runtime,
+                                                      __attribute__((unused)) const char *directory,
+                                                      __attribute__((unused)) size_t maxSize)
+{
+    return NAPIErrorGenericFailure;
+}
+
+struct OpaqueNAPIScript
+{
+    JSStringRef script;    // size_t
+    JSStringRef sourceUrl; // size_t
+    NAPIEnv env;           // size_t
+};
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, size_t length, const char *sourceUrl,
+                                                  NAPIScript *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(script, Exception)
+    CHECK_ARG(result, Exception)
+
+    struct OpaqueNAPIScript *compiledScript = malloc(sizeof(struct OpaqueNAPIScript));
+    RETURN_STATUS_IF_FALSE(compiledScript, NAPIExceptionMemoryError)
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        compiledScript->script = JSStringCreateWithUTF8CString(script);
+    }
+    else
+    {
+        // JSStringCreateWithUTF8CString 只接受 \0 结尾的字符串
+        char *copiedScript = malloc(length + 1);
+        if (!copiedScript)
+        {
+            free(compiledScript);
+
+            return NAPIExceptionMemoryError;
+        }
+        memcpy(copiedScript, script, length);
+        copiedScript[length] = '\0';
+        compiledScript->script = JSStringCreateWithUTF8CString(copiedScript);
+        free(copiedScript);
+    }
+    compiledScript->sourceUrl = sourceUrl ? JSStringCreateWithUTF8CString(sourceUrl) : NULL;
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    bool isValid = JSCheckScriptSyntax(env->context, compiledScript->script, compiledScript->sourceUrl, 1,
+                                       &env->lastException);
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "NAPICompileScript", sourceUrl, traceBeginTime);
+    if (!isValid)
+    {
+        NAPIFreeScript(env, compiledScript);
+        // 语法错误时 lastException 一定存在
+        CHECK_JSC(env)
+
+        return NAPIExceptionGenericFailure;
+    }
+    compiledScript->env = env;
+    *result = compiledScript;
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(script, Exception)
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPIExceptionInvalidArg)
+
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, NULL);
+    JSValueRef valueRef =
+        JSEvaluateScript(env->context, script->script, NULL, script->sourceUrl, 1, &env->lastException);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunCompiledScript", NULL, traceBeginTime);
+    CHECK_JSC(env)
+    if (result)
+    {
+        *result = (NAPIValue)valueRef;
+    }
+
     return NAPIExceptionOK;
 }
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPICommonInvalidArg)
+
+    JSStringRelease(script->script);
+    if (script->sourceUrl)
+    {
+        JSStringRelease(script->sourceUrl);
+    }
+    free(script);
+
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                         const NAPIRunScriptOptions *options, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(!options || (options->version && options->version <= NAPI_RUN_SCRIPT_OPTIONS_VERSION),
+                           NAPIExceptionInvalidArg)
+
+    if (!options || !options->strict || !script)
+    {
+        return NAPIRunScript(env, script, sourceUrl, result);
+    }
+    // 公开 API 没有编译选项，在同一行插入指令序言，不影响行号
+    static const char strictDirective[] = "'use strict';";
+    size_t scriptLength = strlen(script);
+    char *strictScript = malloc(sizeof(strictDirective) + scriptLength);
+    RETURN_STATUS_IF_FALSE(strictScript, NAPIExceptionMemoryError)
+    memcpy(strictScript, strictDirective, sizeof(strictDirective) - 1);
+    memcpy(strictScript + sizeof(strictDirective) - 1, script, scriptLength + 1);
+    NAPIExceptionStatus status = NAPIRunScript(env, strictScript, sourceUrl, result);
+    free(strictScript);
+
+    return status;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPICompileScriptAsync(__attribute__((unused)) NAPIRuntime runtime,
+                                                   __attribute__((unused)) const char *script,
+                                                   __attribute__((unused)) size_t length,
+                                                   __attribute__((unused)) const char *sourceUrl,
+                                                   __attribute__((unused)) NAPICompileCallback callback,
+                                                   __attribute__((unused)) void *data)
+{
+    return NAPIErrorGenericFailure;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithLength(NAPIEnv env, const char *script, size_t length,
+                                                        const char *sourceUrl, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    CHECK_ARG(script, Exception)
+
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        return NAPIRunScript(env, script, sourceUrl, result);
+    }
+    // JSStringCreateWithUTF8CString 只接受 \0 结尾的字符串
+    char *copiedScript = scriptSourceJoin(&script, &length, 1, &length);
+    RETURN_STATUS_IF_FALSE(copiedScript, NAPIExceptionMemoryError)
+    NAPIExceptionStatus status = NAPIRunScript(env, copiedScript, sourceUrl, result);
+    free(copiedScript);
+
+    return status;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptChunks(NAPIEnv env, const char *const *chunks, const size_t *lengths,
+                                                    size_t chunkCount, const char *sourceUrl, NAPIValue *result)
+{
+    CHECK_JSC(env)
+    RETURN_STATUS_IF_FALSE(chunks || !chunkCount, NAPIExceptionInvalidArg)
+
+    size_t length;
+    char *script = scriptSourceJoin(chunks, lengths, chunkCount, &length);
+    RETURN_STATUS_IF_FALSE(script, NAPIExceptionMemoryError)
+    NAPIExceptionStatus status = NAPIRunScript(env, script, sourceUrl, result);
+    free(script);
+
+    return status;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPISetModuleLoader(__attribute__((unused)) NAPIEnv env,
+                                                __attribute__((unused)) NAPIModuleResolveCallback resolveCallback,
+                                                __attribute__((unused)) NAPIModuleLoadCallback loadCallback,
+                                                __attribute__((unused)) void *data)
+{
+    return NAPIErrorGenericFailure;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunModule(__attribute__((unused)) NAPIEnv env,
+                                              __attribute__((unused)) const char *script,
+                                              __attribute__((unused)) const char *moduleName,
+                                              __attribute__((unused)) NAPIValue *result)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+// JavaScriptCore 没有公开的字节码接口，归档 API 全部返回 NAPIErrorGenericFailure
+const char *bytecodeArchiveGetEngineVersion(void)
+{
+    return NULL;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunArchiveModule(__attribute__((unused)) NAPIEnv env,
+                                                     __attribute__((unused)) NAPIArchive archive,
+                                                     __attribute__((unused)) const char *moduleName,
+                                                     __attribute__((unused)) NAPIValue *result)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBufferWithOptions(
+    __attribute__((unused)) NAPIEnv env, __attribute__((unused)) const char *script,
+    __attribute__((unused)) const char *sourceUrl, __attribute__((unused)) const NAPICompileOptions *options,
+    __attribute__((unused)) const uint8_t **byteBuffer, __attribute__((unused)) size_t *bufferSize)
+{
+    return NAPIExceptionGenericFailure;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIGetBytecodeStats(__attribute__((unused)) const uint8_t *byteBuffer,
+                                                 __attribute__((unused)) size_t bufferSize,
+                                                 __attribute__((unused)) NAPIBytecodeStats *result)
+{
+    return NAPIErrorGenericFailure;
+}
@@ -0,0 +1,125 @@
+#include "js_native_api_mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool mappedFileOpen(const char *path, bool isRandomAccess, struct MappedFile *mappedFile)
+{
+    mappedFile->data = NULL;
+    mappedFile->size = 0;
+    int fd;
+    do
+    {
+        fd = open(path, O_RDONLY | O_CLOEXEC);
+    } while (fd < 0 && errno == EINTR);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat fileStat;
+    // 空文件不能映射
+    if (fstat(fd, &fileStat) || fileStat.st_size <= 0)
+    {
+        close(fd);
+
+        return false;
+    }
+    size_t size = (size_t)fileStat.st_size;
+    void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // 映射持有文件引用，可以直接关闭 fd
+    close(fd);
+    if (data == MAP_FAILED)
+    {
+        return false;
+    }
+    // 只是提示，失败不影响结果
+    madvise(data, size, isRandomAccess ? MADV_RANDOM : MADV_WILLNEED);
+    mappedFile->data = data;
+    mappedFile->size = size;
+
+    return true;
+}
+
+void mappedFileWillNeed(const struct MappedFile *mappedFile, size_t offset, size_t size)
+{
+    if (!size || offset >= mappedFile->size)
+    {
+        return;
+    }
+    if (size > mappedFile->size - offset)
+    {
+        size = mappedFile->size - offset;
+    }
+    // mmap 返回的地址按页对齐
+    uintptr_t pageSize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t begin = ((uintptr_t)mappedFile->data + offset) & ~(pageSize - 1);
+    uintptr_t end = (uintptr_t)mappedFile->data + offset + size;
+    madvise((void *)begin, end - begin, MADV_WILLNEED);
+}
+
+void mappedFileClose(struct MappedFile *mappedFile)
+{
+    if (!mappedFile->data)
+    {
+        return;
+    }
+    munmap((void *)mappedFile->data, mappedFile->size);
+    mappedFile->data = NULL;
+    mappedFile->size = 0;
+}
+
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const uint8_t *cursor = data;
+    while (size)
+    {
+        ssize_t length = write(fd, cursor, size);
+        if (length < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return false;
+        }
+        cursor += length;
+        size -= (size_t)length;
+    }
+
+    return true;
+}
+
+bool mappedFileWrite(const char *path, const void *header, size_t headerSize, const void *data, size_t size,
+                     bool isSync)
+{
+    char temporaryPath[PATH_MAX];
+    int length = snprintf(temporaryPath, sizeof(temporaryPath), "%s.tmp.XXXXXX", path);
+    if (length <= 0 || (size_t)length >= sizeof(temporaryPath))
+    {
+        return false;
+    }
+    int fd = mkstemp(temporaryPath);
+    if (fd < 0)
+    {
+        return false;
+    }
+    bool isSuccess = (!headerSize || writeAll(fd, header, headerSize)) && writeAll(fd, data, size) &&
+                     (!isSync || !fsync(fd));
+    isSuccess = !close(fd) && isSuccess;
+    if (!isSuccess || rename(temporaryPath, path))
+    {
+        unlink(temporaryPath);
+
+        return false;
+    }
+
+    return true;
+}
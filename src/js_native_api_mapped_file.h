@@ -0,0 +1,38 @@
+#ifndef SRC_JS_NATIVE_API_MAPPED_FILE_H_
+#define SRC_JS_NATIVE_API_MAPPED_FILE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，只读映射字节码文件
+// MAP_PRIVATE + PROT_READ，页面属于 page cache，多个进程映射同一文件时共享，内存紧张时可以直接丢弃后重新读取
+// 映射期间文件被截断时访问会触发 SIGBUS，调用方需要保证文件不被修改
+struct MappedFile
+{
+    const uint8_t *data; // size_t
+    size_t size;         // size_t
+};
+
+// 成功后通过 madvise 提示内核预读整个文件，返回 false 代表打开/映射失败或者文件为空
+// isRandomAccess 时不预读并且关闭顺序预读，只访问一部分的文件（比如字节码归档）使用 mappedFileWillNeed 按需预读
+bool mappedFileOpen(const char *path, bool isRandomAccess, struct MappedFile *mappedFile);
+
+// 预读 [offset, offset + size)，按页对齐，只是提示
+void mappedFileWillNeed(const struct MappedFile *mappedFile, size_t offset, size_t size);
+
+// mappedFile->data 为 NULL 时什么也不做
+void mappedFileClose(struct MappedFile *mappedFile);
+
+// 先写入同目录临时文件再 rename，映射方不会看到写了一半的文件，header 可空，写入内容为 header + data
+// isSync 时 rename 前 fsync，保证掉电后不会出现内容不完整的文件；否则调用方需要自行校验内容
+bool mappedFileWrite(const char *path, const void *header, size_t headerSize, const void *data, size_t size,
+                     bool isSync);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_MAPPED_FILE_H_
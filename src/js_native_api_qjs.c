@@ -8,11 +8,29 @@
 #include <quickjs.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
+#include <time.h>
+#include <unistd.h>
 
 #include <limits.h>
 
+// private header
+#include "js_native_api_bytecode_archive.h"
+#include "js_native_api_code_cache.h"
+#include "js_native_api_cpu_profile.h"
+#include "js_native_api_external_memory.h"
+#include "js_native_api_finalizer_queue.h"
+#include "js_native_api_mapped_file.h"
+#include "js_native_api_qjs_internal.h"
+#include "js_native_api_reference_table.h"
+#include "js_native_api_script_source.h"
+#include "js_native_api_thread_pool.h"
+#include "trace/js_native_api_output.h"
+#include "trace/js_native_api_trace.h"
+#include "trace/js_native_api_usdt.h"
+
 #ifndef SLIST_FOREACH_SAFE
 #define SLIST_FOREACH_SAFE(var, head, field, tvar)                                                                     \
     for ((var) = SLIST_FIRST((head)); (var) && ((tvar) = SLIST_NEXT((var), field), 1); (var) = (tvar))
@@ -75,36 +93,52 @@ struct OpaqueNAPIHandleScope
     SLIST_HEAD(, Handle) handleList;        // size_t
 };
 
-struct OpaqueNAPIRef
+// NAPIRef 为 env->referenceTable 中 slot 的句柄
+struct Reference
 {
-    JSValue value;                  // size_t * 2
-    LIST_ENTRY(OpaqueNAPIRef) node; // size_t * 2
-    uint8_t referenceCount;         // 8
+    JSValue value;              // size_t * 2
+    LIST_ENTRY(Reference) node; // size_t * 2
+    // 对象第一次成为弱引用后记录，之后 ref/unref 只需要链表操作，对象被回收时置空
+    // 弱引用并且 weakReference 非空时 node 位于 weakReference->weakRefList
+    struct WeakReference *weakReference; // size_t
+    uint32_t referenceCount;             // uint32_t
 };
 
 struct WeakReference
 {
     LIST_ENTRY(WeakReference) node; // size_t * 2
     // 目前还有效的弱引用
-    LIST_HEAD(, OpaqueNAPIRef) weakRefList; // size_t
-    // NAPIFreeEnv 会 free 所有 NAPIRef，referenceFinalize() 就只需要 free 自身结构体
+    LIST_HEAD(, Reference) weakRefList; // size_t
+    NAPIEnv env;                        // size_t
+    // NAPIFreeEnv 会释放所有 NAPIRef，weakReferenceFinalizer() 就只需要 free 自身结构体
     bool isEnvFreed;
 };
 
 // 1. external -> 不透明指针 + finalizer + 调用一个回调
 // 2. Function -> JSValue data 数组 + finalizer
 // 3. Constructor -> .[[prototype]] = new External()
-// 4. Reference -> 引用计数 + setWeak/clearWeak -> referenceSymbolValue
+// 4. Reference -> 引用计数 + setWeak -> WeakMap(object => WeakReference)，不修改对象本身
 
 struct OpaqueNAPIEnv
 {
-    JSValue referenceSymbolValue;                       // size_t * 2
+    // 创建 env 时缓存，避免业务方修改 WeakMap.prototype
+    JSValue weakMapValue;                               // size_t * 2
+    JSValue weakMapGetValue;                            // size_t * 2
+    JSValue weakMapSetValue;                            // size_t * 2
     NAPIRuntime runtime;                                // size_t
     JSContext *context;                                 // size_t
     LIST_HEAD(, OpaqueNAPIHandleScope) handleScopeList; // size_t
     LIST_HEAD(, WeakReference) weakReferenceList;       // size_t
-    LIST_HEAD(, OpaqueNAPIRef) strongRefList;           // size_t
-    LIST_HEAD(, OpaqueNAPIRef) valueList;               // size_t
+    struct ReferenceTable referenceTable;               // size_t * 2 + uint32_t * 3
+    struct FinalizerQueue *finalizerQueue;              // size_t
+    // NAPIStartTracing 开启，否则为 NULL
+    struct Trace *trace; // size_t
+    // NAPISetModuleLoader 设置
+    NAPIModuleResolveCallback moduleResolveCallback; // size_t
+    NAPIModuleLoadCallback moduleLoadCallback;       // size_t
+    void *moduleLoaderData;                          // size_t
+    // 第一次调用 NAPIRunArchiveModule 时创建，value 为强引用的 NAPIRef
+    struct BytecodeArchiveResultCache *archiveResultCache; // size_t
     bool isThrowNull;
 };
 
@@ -114,8 +148,54 @@ struct OpaqueNAPIRuntime
     JSClassID constructorClassId; // uint32_t
     JSClassID functionClassId;    // uint32_t
     JSClassID externalClassId;    // uint32_t
+    JSClassID instanceClassId;    // uint32_t
+    // 没有 finalizeCB 的 External 直接将 data 存储在 opaque 中，不需要 ExternalInfo
+    JSClassID inlineExternalClassId; // uint32_t
+    JSClassID weakReferenceClassId;  // uint32_t
+    // QuickJS 没有 GC 回调，只统计 runGC()
+    uint64_t gcCount;       // uint64_t
+    uint64_t gcNanoseconds; // uint64_t
+    // interrupt handler 属于 JSRuntime，同一时间只有一个 env 可以采样
+    NAPIEnv profilingEnv;          // size_t
+    struct CPUProfile *cpuProfile; // size_t
+    // 采样期间缓存函数名和 url
+    struct ProfileAtomTable *profileAtomTable; // size_t
+    // NAPISetInterruptHandler 设置，和采样共用 JSRuntime 的 interrupt handler
+    NAPIInterruptHandler interruptHandler; // size_t
+    void *interruptData;                   // size_t
+    // NAPISetCodeCacheDirectory 开启，否则为 NULL
+    struct CodeCache *codeCache; // size_t
+    // 多个 env 共享 JSRuntime 的 GC 阈值，外部内存按 runtime 统计
+    struct ExternalMemory *externalMemory; // size_t
+    // 捕获调用栈时禁止重入
+    bool isSampling;
+};
+
+struct OpaqueNAPIScript
+{
+    // JS_EVAL_FLAG_COMPILE_ONLY 编译的函数字节码，JS_EvalFunction 会获取所有权，每次执行时 dup
+    JSValue functionValue; // size_t * 2
+    NAPIEnv env;           // size_t
+    char *sourceUrl;       // size_t
 };
 
+static void runGC(NAPIEnv env)
+{
+    NAPIRuntime runtime = env->runtime;
+    struct timespec begin, end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE0(gc_start);
+    JS_RunGC(runtime->runtime);
+    NAPI_USDT_PROBE0(gc_done);
+    traceAddEvent(env->trace, TRACE_CATEGORY_GC, "JS_RunGC", NULL, traceBeginTime);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    ++runtime->gcCount;
+    // 32 位平台 time_t 可能溢出，先转换再相乘
+    runtime->gcNanoseconds += (uint64_t)(end.tv_sec - begin.tv_sec) * 1000000000 + (uint64_t)end.tv_nsec -
+                              (uint64_t)begin.tv_nsec;
+}
+
 // 这个函数不会修改引用计数和所有权
 // NAPIHandleScopeEmpty/NAPIMemoryError
 static NAPIErrorStatus addValueToHandleScope(NAPIEnv env, JSValue value, struct Handle **result)
@@ -165,6 +245,8 @@ static char *const JS_GET_GLOBAL_OBJECT_EXCEPTION = "JS_GetGlobalObject() -> JS_
 static char *const FUNCTION_CLASS_ID_ZERO = "functionClassId must not be 0.";
 
 static char *const CONSTRUCTOR_CLASS_ID_ZERO = "constructorClassId must not be 0.";
+
+static char *const INSTANCE_CLASS_ID_ZERO = "instanceClassId must not be 0.";
 static char *const NAPI_CLOSE_HANDLE_SCOPE_ERROR = "napi_close_handle_scope() return error.";
 #endif
 
@@ -327,7 +409,9 @@ static JSValue callAsFunction(JSContext *ctx, JSValueConst thisVal, int argc, JS
         (void)status;
     }
     // callback 调用后，返回值应当属于当前 handleScope 管理，否则业务方后果自负
+    NAPI_USDT_PROBE2(callback_entry, functionInfo->baseInfo.env, functionInfo->callback);
     NAPIValue retVal = functionInfo->callback(functionInfo->baseInfo.env, &callbackInfo);
+    NAPI_USDT_PROBE2(callback_return, functionInfo->baseInfo.env, functionInfo->callback);
     if (useGlobalValue)
     {
         // 释放 thisVal = JS_GetGlobalObject(ctx); 的情况
@@ -451,6 +535,9 @@ NAPIExceptionStatus napi_create_function(NAPIEnv env, const char *utf8name, NAPI
 
 // static JSClassID externalClassId = 0;
 
+// opaque 为 NULL 无法和非 External 对象区分，data 为 NULL 时 opaque 指向该哨兵
+static char nullExternalData;
+
 NAPICommonStatus napi_typeof(NAPIEnv env, NAPIValue value, NAPIValueType *result)
 {
 
@@ -487,7 +574,8 @@ NAPICommonStatus napi_typeof(NAPIEnv env, NAPIValue value, NAPIValueType *result
     {
         *result = NAPIFunction;
     }
-    else if (JS_GetOpaque(jsValue, env->runtime->externalClassId))
+    else if (JS_GetOpaque(jsValue, env->runtime->inlineExternalClassId) ||
+             JS_GetOpaque(jsValue, env->runtime->externalClassId))
     {
         // JS_GetOpaque 会检查 classId
         *result = NAPIExternal;
@@ -722,11 +810,14 @@ static void processPendingTask(NAPIEnv env)
         return;
     }
 
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    bool isExecuted = false;
     int error = 1;
     do
     {
         JSContext *context;
         error = JS_ExecutePendingJob(JS_GetRuntime(env->context), &context);
+        isExecuted = isExecuted || error;
         if (error == -1)
         {
             // 正常情况下 JS_ExecutePendingJob 返回 -1
@@ -736,6 +827,11 @@ static void processPendingTask(NAPIEnv env)
             JS_FreeValue(context, inlineExceptionValue);
         }
     } while (error != 0);
+    // 大部分调用没有待执行任务，不记录空事件
+    if (isExecuted)
+    {
+        traceAddEvent(env->trace, TRACE_CATEGORY_MICROTASK, "processPendingTask", NULL, traceBeginTime);
+    }
 }
 
 // NAPIMemoryError/NAPIPendingException + addValueToHandleScope
@@ -938,21 +1034,64 @@ typedef struct
     void *data;                    // size_t
     void *finalizeHint;            // size_t
     NAPIFinalize finalizeCallback; // size_t
+    // 设置 finalizeCallback 时持有，对象可能比 env 存活更久
+    struct FinalizerQueue *finalizerQueue; // size_t
+    // externalMemorySize 非 0 时持有
+    struct ExternalMemory *externalMemory; // size_t
+    size_t externalMemorySize;             // size_t
 } ExternalInfo;
 
+// NAPIDefineClass 创建的实例 opaque 默认指向该哨兵，用于区分未 wrap 的实例和其他对象
+static ExternalInfo emptyInstanceInfo = {NULL, NULL, NULL, NULL, NULL, 0};
+
 // NAPIMemoryError/NAPIPendingException + addValueToHandleScope
 NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
                                          NAPIValue *result)
 {
+    return NAPICreateExternalWithSize(env, data, finalizeCB, finalizeHint, 0, result);
+}
 
+// NAPIMemoryError/NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus NAPICreateExternalWithSize(NAPIEnv env, void *data, NAPIFinalize finalizeCB, void *finalizeHint,
+                                               size_t externalMemorySize, NAPIValue *result)
+{
     NAPI_PREAMBLE(env)
     CHECK_ARG(result, Exception)
 
+    struct Handle *handle;
+    if (!finalizeCB && !externalMemorySize)
+    {
+        if (__builtin_expect(!env->runtime->inlineExternalClassId, false))
+        {
+            assert(false && "inlineExternalClassId must not be 0.");
+
+            return NAPIExceptionGenericFailure;
+        }
+        JSValue object = JS_NewObjectClass(env->context, (int)env->runtime->inlineExternalClassId);
+        if (__builtin_expect(JS_IsException(object), false))
+        {
+            return NAPIExceptionPendingException;
+        }
+        JS_SetOpaque(object, data ?: &nullExternalData);
+        NAPIErrorStatus status = addValueToHandleScope(env, object, &handle);
+        if (__builtin_expect(status != NAPIErrorOK, false))
+        {
+            JS_FreeValue(env->context, object);
+
+            return (NAPIExceptionStatus)status;
+        }
+        *result = (NAPIValue)&handle->value;
+
+        return NAPIExceptionOK;
+    }
     ExternalInfo *externalInfo = malloc(sizeof(ExternalInfo));
     RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
     externalInfo->data = data;
     externalInfo->finalizeHint = finalizeHint;
     externalInfo->finalizeCallback = NULL;
+    externalInfo->finalizerQueue = NULL;
+    externalInfo->externalMemory = NULL;
+    externalInfo->externalMemorySize = 0;
     if (__builtin_expect(!env->runtime->externalClassId, false))
     {
         assert(false && "externalClassId must not be 0.");
@@ -968,7 +1107,6 @@ NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize f
         return NAPIExceptionPendingException;
     }
     JS_SetOpaque(object, externalInfo);
-    struct Handle *handle;
     NAPIErrorStatus status = addValueToHandleScope(env, object, &handle);
     if (__builtin_expect(status != NAPIErrorOK, false))
     {
@@ -978,7 +1116,17 @@ NAPIExceptionStatus napi_create_external(NAPIEnv env, void *data, NAPIFinalize f
     }
     *result = (NAPIValue)&handle->value;
     // 不能先设置回调，万一出错，业务方也会收到回调
-    externalInfo->finalizeCallback = finalizeCB;
+    if (finalizeCB)
+    {
+        externalInfo->finalizeCallback = finalizeCB;
+        externalInfo->finalizerQueue = finalizerQueueRetain(env->finalizerQueue);
+    }
+    if (externalMemorySize)
+    {
+        externalInfo->externalMemory = externalMemoryRetain(env->runtime->externalMemory);
+        externalInfo->externalMemorySize = externalMemorySize;
+        napi_adjust_external_memory(env, (int64_t)externalMemorySize, NULL);
+    }
 
     return NAPIExceptionOK;
 }
@@ -990,105 +1138,225 @@ NAPIErrorStatus napi_get_value_external(NAPIEnv env, NAPIValue value, void **res
     CHECK_ARG(value, Error)
     CHECK_ARG(result, Error)
 
-    if (__builtin_expect(!env->runtime->externalClassId, false))
+    if (__builtin_expect(!env->runtime->externalClassId || !env->runtime->inlineExternalClassId, false))
     {
         assert(false && "externalClassId must not be 0.");
 
         return NAPIErrorGenericFailure;
     }
+    void *data = JS_GetOpaque(*((JSValue *)value), env->runtime->inlineExternalClassId);
+    if (data)
+    {
+        *result = data == &nullExternalData ? NULL : data;
+
+        return NAPIErrorOK;
+    }
     ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)value), env->runtime->externalClassId);
     *result = externalInfo ? externalInfo->data : NULL;
 
     return NAPIErrorOK;
 }
 
+NAPICommonStatus napi_adjust_external_memory(NAPIEnv env, int64_t changeInBytes, int64_t *adjustedValue)
+{
+    CHECK_ARG(env, Common)
+
+    int64_t totalSize = externalMemoryAdjust(env->runtime->externalMemory, changeInBytes);
+    // 引用计数已经释放了不可达的非循环对象，只剩循环引用需要 GC
+    // 阈值置 0 后下一次分配 GC 对象时触发回收，QuickJS 回收后根据当前 malloc 大小重新计算阈值
+    if (changeInBytes > 0 && externalMemoryCheckPressure(env->runtime->externalMemory))
+    {
+        JS_SetGCThreshold(env->runtime->runtime, 0);
+    }
+    if (adjustedValue)
+    {
+        *adjustedValue = totalSize;
+    }
+
+    return NAPICommonOK;
+}
+
+// NAPIObjectExpected/NAPIInvalidArg/NAPIMemoryError + napi_create_reference
+NAPIExceptionStatus napi_wrap(NAPIEnv env, NAPIValue jsObject, void *nativeObject, NAPIFinalize finalizeCB,
+                              void *finalizeHint, NAPIRef *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(jsObject, Exception)
+
+    if (__builtin_expect(!env->runtime->instanceClassId, false))
+    {
+        assert(false && INSTANCE_CLASS_ID_ZERO);
+
+        return NAPIExceptionGenericFailure;
+    }
+    // JS_GetOpaque 会校验 classId，非实例对象返回 NULL
+    ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)jsObject), env->runtime->instanceClassId);
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionObjectExpected)
+    RETURN_STATUS_IF_FALSE(externalInfo == &emptyInstanceInfo, NAPIExceptionInvalidArg)
+    externalInfo = malloc(sizeof(ExternalInfo));
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIExceptionMemoryError)
+    externalInfo->data = nativeObject;
+    externalInfo->finalizeHint = finalizeHint;
+    externalInfo->finalizeCallback = NULL;
+    externalInfo->finalizerQueue = NULL;
+    externalInfo->externalMemory = NULL;
+    externalInfo->externalMemorySize = 0;
+    JS_SetOpaque(*((JSValue *)jsObject), externalInfo);
+    if (result)
+    {
+        NAPIExceptionStatus status = napi_create_reference(env, jsObject, 0, result);
+        if (__builtin_expect(status != NAPIExceptionOK, false))
+        {
+            JS_SetOpaque(*((JSValue *)jsObject), &emptyInstanceInfo);
+            free(externalInfo);
+
+            return status;
+        }
+    }
+    // 同 napi_create_external，成功后才设置回调
+    externalInfo->finalizeCallback = finalizeCB;
+    if (finalizeCB)
+    {
+        externalInfo->finalizerQueue = finalizerQueueRetain(env->finalizerQueue);
+    }
+
+    return NAPIExceptionOK;
+}
+
+NAPIErrorStatus napi_unwrap(NAPIEnv env, NAPIValue jsObject, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+    CHECK_ARG(result, Error)
+
+    if (__builtin_expect(!env->runtime->instanceClassId, false))
+    {
+        assert(false && INSTANCE_CLASS_ID_ZERO);
+
+        return NAPIErrorGenericFailure;
+    }
+    ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)jsObject), env->runtime->instanceClassId);
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIErrorObjectExpected)
+    RETURN_STATUS_IF_FALSE(externalInfo != &emptyInstanceInfo, NAPIErrorInvalidArg)
+    *result = externalInfo->data;
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus napi_remove_wrap(NAPIEnv env, NAPIValue jsObject, void **result)
+{
+    CHECK_ARG(env, Error)
+    CHECK_ARG(jsObject, Error)
+
+    if (__builtin_expect(!env->runtime->instanceClassId, false))
+    {
+        assert(false && INSTANCE_CLASS_ID_ZERO);
+
+        return NAPIErrorGenericFailure;
+    }
+    ExternalInfo *externalInfo = JS_GetOpaque(*((JSValue *)jsObject), env->runtime->instanceClassId);
+    RETURN_STATUS_IF_FALSE(externalInfo, NAPIErrorObjectExpected)
+    RETURN_STATUS_IF_FALSE(externalInfo != &emptyInstanceInfo, NAPIErrorInvalidArg)
+    if (result)
+    {
+        *result = externalInfo->data;
+    }
+    JS_SetOpaque(*((JSValue *)jsObject), &emptyInstanceInfo);
+    finalizerQueueRelease(externalInfo->finalizerQueue);
+    free(externalInfo);
+
+    return NAPIErrorOK;
+}
+
 // static uint8_t contextCount = 0;
 
-static void referenceFinalize(void *finalizeData, void *finalizeHint)
+static void weakReferenceFinalizer(JSRuntime *rt, JSValue val)
 {
-    // finalizeHint => env 不可靠
-    if (!finalizeData)
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    if (__builtin_expect(!runtime->weakReferenceClassId, false))
+    {
+        assert(false && "weakReferenceClassId must not be 0.");
+
+        return;
+    }
+    struct WeakReference *weakReference = JS_GetOpaque(val, runtime->weakReferenceClassId);
+    if (!weakReference)
     {
         assert(false);
 
         return;
     }
-    struct WeakReference *referenceInfo = finalizeData;
     // isEnvFreed 需要存在，因为有三种情况
     // 1. env 被析构
-    // 2. env 还在，也有 referenceInfo，但是没有 weakRef
-    // 3. env 还在，也有 referenceInfo，也有 weakRef
-    if (!referenceInfo->isEnvFreed)
+    // 2. env 还在，也有 weakReference，但是没有 weakRef
+    // 3. env 还在，也有 weakReference，也有 weakRef
+    if (!weakReference->isEnvFreed)
     {
-        NAPIRef reference, temp;
-        LIST_FOREACH_SAFE(reference, &referenceInfo->weakRefList, node, temp)
+        struct Reference *reference, *temp;
+        LIST_FOREACH_SAFE(reference, &weakReference->weakRefList, node, temp)
         {
             // 如果进入循环，说明 env 是有效的
             assert(!reference->referenceCount);
             reference->value = undefinedValue;
+            reference->weakReference = NULL;
             LIST_REMOVE(reference, node);
-            // 所以这里 finalizeHint 还是有效的 env
-            LIST_INSERT_HEAD(&((NAPIEnv)finalizeHint)->valueList, reference, node);
         }
         // 当前不是 last GC
         // LIST_REMOVE 会影响 env 结构体
-        LIST_REMOVE(referenceInfo, node);
+        LIST_REMOVE(weakReference, node);
     }
 
-    free(referenceInfo);
+    free(weakReference);
 }
 
-// NAPINameExpected/NAPIMemoryError/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_typeof +
-// napi_create_external
-// + napi_get_value_external + napi_set_property
-static NAPIExceptionStatus setWeak(NAPIEnv env, NAPIValue value, NAPIRef ref)
+// 对象 -> WeakReference 存储在 env->weakMapValue 中，对象被回收时 WeakMap 释放 value，触发 weakReferenceFinalizer
+// 同一个对象只会在第一次 setWeak 时查询 WeakMap，之后 reference->weakReference 一直有效直到对象被回收
+// NAPIMemoryError/NAPIPendingException
+static NAPIExceptionStatus setWeak(NAPIEnv env, struct Reference *reference)
 {
     NAPI_PREAMBLE(env)
-    CHECK_ARG(value, Exception)
-    CHECK_ARG(ref, Exception)
-
-    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
-
-    // TODO(ChasonTang): napi_open_handle_scope()
+    CHECK_ARG(reference, Exception)
 
-    NAPIValue referenceValue;
-    CHECK_NAPI(napi_get_property(env, value, (NAPIValue)&env->referenceSymbolValue, &referenceValue), Exception,
-               Exception)
-    NAPIValueType valueType;
-    CHECK_NAPI(napi_typeof(env, referenceValue, &valueType), Common, Exception)
-    RETURN_STATUS_IF_FALSE(valueType == NAPIUndefined || valueType == NAPIExternal, NAPIExceptionGenericFailure)
-    struct WeakReference *referenceInfo;
-    if (valueType == NAPIUndefined)
-    {
-        referenceInfo = malloc(sizeof(struct WeakReference));
-        RETURN_STATUS_IF_FALSE(referenceInfo, NAPIExceptionMemoryError)
-        referenceInfo->isEnvFreed = false;
-        LIST_INIT(&referenceInfo->weakRefList);
+    if (!reference->weakReference)
+    {
+        if (__builtin_expect(!env->runtime->weakReferenceClassId, false))
         {
-            NAPIExceptionStatus status =
-                napi_create_external(env, referenceInfo, referenceFinalize, env, &referenceValue);
-            if (__builtin_expect(status != NAPIExceptionOK, false))
-            {
-                free(referenceInfo);
+            assert(false && "weakReferenceClassId must not be 0.");
 
-                return status;
-            }
+            return NAPIExceptionGenericFailure;
         }
-        CHECK_NAPI(napi_set_property(env, value, (NAPIValue)&env->referenceSymbolValue, referenceValue), Exception,
-                   Exception)
-        LIST_INSERT_HEAD(&env->weakReferenceList, referenceInfo, node);
-    }
-    else
-    {
-        CHECK_NAPI(napi_get_value_external(env, referenceValue, (void **)&referenceInfo), Error, Exception)
-        if (__builtin_expect(!referenceInfo, false))
+        JSValue holderValue = JS_Call(env->context, env->weakMapGetValue, env->weakMapValue, 1, &reference->value);
+        RETURN_STATUS_IF_FALSE(!JS_IsException(holderValue), NAPIExceptionPendingException)
+        // JS_GetOpaque 会检查 classId，undefined 返回 NULL
+        struct WeakReference *weakReference = JS_GetOpaque(holderValue, env->runtime->weakReferenceClassId);
+        JS_FreeValue(env->context, holderValue);
+        if (!weakReference)
         {
-            assert(false);
+            weakReference = malloc(sizeof(struct WeakReference));
+            RETURN_STATUS_IF_FALSE(weakReference, NAPIExceptionMemoryError)
+            weakReference->env = env;
+            weakReference->isEnvFreed = false;
+            LIST_INIT(&weakReference->weakRefList);
+            holderValue = JS_NewObjectClass(env->context, (int)env->runtime->weakReferenceClassId);
+            if (__builtin_expect(JS_IsException(holderValue), false))
+            {
+                free(weakReference);
 
-            return NAPIExceptionGenericFailure;
+                return NAPIExceptionPendingException;
+            }
+            // 先插入链表，之后出错由 weakReferenceFinalizer 负责移除和释放
+            LIST_INSERT_HEAD(&env->weakReferenceList, weakReference, node);
+            JS_SetOpaque(holderValue, weakReference);
+            JSValue argv[] = {reference->value, holderValue};
+            JSValue returnValue = JS_Call(env->context, env->weakMapSetValue, env->weakMapValue, 2, argv);
+            // WeakMap 持有 holderValue
+            JS_FreeValue(env->context, holderValue);
+            RETURN_STATUS_IF_FALSE(!JS_IsException(returnValue), NAPIExceptionPendingException)
+            JS_FreeValue(env->context, returnValue);
         }
+        reference->weakReference = weakReference;
     }
-    LIST_INSERT_HEAD(&referenceInfo->weakRefList, ref, node);
+    LIST_INSERT_HEAD(&reference->weakReference->weakRefList, reference, node);
 
     return NAPIExceptionOK;
 }
@@ -1101,34 +1369,33 @@ NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t
     CHECK_ARG(value, Exception)
     CHECK_ARG(result, Exception)
 
-    *result = malloc(sizeof(struct OpaqueNAPIRef));
-    RETURN_STATUS_IF_FALSE(*result, NAPIExceptionMemoryError)
+    struct Reference *reference = referenceTableAlloc(&env->referenceTable, result);
+    RETURN_STATUS_IF_FALSE(reference, NAPIExceptionMemoryError)
+    reference->weakReference = NULL;
     // 标量 && 弱引用
     if (!JS_IsObject(*((JSValue *)value)) && !initialRefCount)
     {
-        (*result)->referenceCount = 0;
-        (*result)->value = undefinedValue;
-        LIST_INSERT_HEAD(&env->valueList, *result, node);
+        reference->referenceCount = 0;
+        reference->value = undefinedValue;
 
         return NAPIExceptionOK;
     }
     // 对象 || 强引用
-    (*result)->value = *((JSValue *)value);
-    (*result)->referenceCount = initialRefCount;
+    reference->value = *((JSValue *)value);
+    reference->referenceCount = initialRefCount;
     // 强引用
     if (initialRefCount)
     {
-        (*result)->value = JS_DupValue(env->context, (*result)->value);
-        LIST_INSERT_HEAD(&env->strongRefList, *result, node);
+        reference->value = JS_DupValue(env->context, reference->value);
 
         return NAPIExceptionOK;
     }
     // 对象 && 弱引用
     // setWeak
-    NAPIExceptionStatus status = setWeak(env, value, *result);
+    NAPIExceptionStatus status = setWeak(env, reference);
     if (__builtin_expect(status != NAPIExceptionOK, false))
     {
-        free(*result);
+        referenceTableFree(&env->referenceTable, *result);
 
         return status;
     }
@@ -1136,97 +1403,56 @@ NAPIExceptionStatus napi_create_reference(NAPIEnv env, NAPIValue value, uint32_t
     return NAPIExceptionOK;
 }
 
-// NAPINameExpected/NAPIGenericFailure + napi_create_string_utf8 + napi_get_property + napi_get_value_external +
-// napi_delete_property
-static NAPIExceptionStatus clearWeak(NAPIEnv env, NAPIRef ref)
-{
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(ref, Exception)
-
-    RETURN_STATUS_IF_FALSE(JS_IsSymbol(env->referenceSymbolValue), NAPIExceptionNameExpected)
-
-    // TODO(ChasonTang): napi_open_handle_scope()
-
-    NAPIValue externalValue;
-    CHECK_NAPI(napi_get_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &externalValue),
-               Exception, Exception)
-    struct WeakReference *referenceInfo;
-    CHECK_NAPI(napi_get_value_external(env, externalValue, (void **)&referenceInfo), Error, Exception)
-    if (__builtin_expect(!referenceInfo, false))
-    {
-        assert(false);
-
-        return NAPIExceptionGenericFailure;
-    }
-    bool needDelete = LIST_FIRST(&referenceInfo->weakRefList) == ref && !LIST_NEXT(ref, node);
-    LIST_REMOVE(ref, node);
-    if (needDelete)
-    {
-        bool deleteResult;
-        // 一定不会在这里触发 GC
-        CHECK_NAPI(
-            napi_delete_property(env, (NAPIValue)&ref->value, (NAPIValue)&env->referenceSymbolValue, &deleteResult),
-            Exception, Exception)
-        RETURN_STATUS_IF_FALSE(deleteResult, NAPIExceptionGenericFailure)
-    }
-
-    return NAPIExceptionOK;
-}
-
-// NAPIGenericFailure + clearWeak
 NAPIExceptionStatus napi_delete_reference(NAPIEnv env, NAPIRef ref)
 {
 
     NAPI_PREAMBLE(env)
     CHECK_ARG(ref, Exception)
 
-    // 标量 && 弱引用（被 GC 也会这样）
-    if (!JS_IsObject(ref->value) && !ref->referenceCount)
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
+    // 强引用
+    if (reference->referenceCount)
     {
-        LIST_REMOVE(ref, node);
-        free(ref);
+        JSValue value = reference->value;
+        referenceTableFree(&env->referenceTable, ref);
+        // 可能触发 finalizer，先释放 slot
+        JS_FreeValue(env->context, value);
 
         return NAPIExceptionOK;
     }
-    // 对象 || 强引用
-    if (ref->referenceCount)
+    // 弱引用位于 weakReference->weakRefList，WeakMap 中的记录等到对象被回收时删除
+    if (reference->weakReference)
     {
-        LIST_REMOVE(ref, node);
-        JS_FreeValue(env->context, ref->value);
-        free(ref);
-
-        return NAPIExceptionOK;
+        LIST_REMOVE(reference, node);
     }
-    // 对象 && 弱引用
-    CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
-    free(ref);
+    referenceTableFree(&env->referenceTable, ref);
 
     return NAPIExceptionOK;
 }
 
-// NAPIGenericFailure + clearWeak
+// NAPIGenericFailure
 NAPIExceptionStatus napi_reference_ref(NAPIEnv env, NAPIRef ref, uint32_t *result)
 {
 
     NAPI_PREAMBLE(env)
     CHECK_ARG(ref, Exception)
 
-    if (!ref->referenceCount)
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
+    RETURN_STATUS_IF_FALSE(reference->referenceCount != UINT32_MAX, NAPIExceptionGenericFailure)
+    if (!reference->referenceCount)
     {
-        // 弱引用
-        JSValue value = JS_DupValue(env->context, ref->value);
-        if (JS_IsObject(ref->value))
-        {
-            CHECK_NAPI(clearWeak(env, ref), Exception, Exception)
-        }
-        else
+        // 弱引用，保留 reference->weakReference
+        if (reference->weakReference)
         {
-            LIST_REMOVE(ref, node);
+            LIST_REMOVE(reference, node);
         }
-        LIST_INSERT_HEAD(&env->strongRefList, ref, node);
-        ref->value = value;
+        reference->value = JS_DupValue(env->context, reference->value);
     }
-    uint8_t count = ++ref->referenceCount;
+    uint32_t count = ++reference->referenceCount;
     if (result)
     {
         *result = count;
@@ -1242,24 +1468,34 @@ NAPIExceptionStatus napi_reference_unref(NAPIEnv env, NAPIRef ref, uint32_t *res
     NAPI_PREAMBLE(env)
     CHECK_ARG(ref, Exception)
 
-    RETURN_STATUS_IF_FALSE(ref->referenceCount, NAPIExceptionGenericFailure)
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
 
-    if (ref->referenceCount == 1)
+    RETURN_STATUS_IF_FALSE(reference->referenceCount, NAPIExceptionGenericFailure)
+
+    if (reference->referenceCount == 1)
     {
-        LIST_REMOVE(ref, node);
-        if (JS_IsObject(ref->value))
+        if (JS_IsObject(reference->value))
         {
-            CHECK_NAPI(setWeak(env, (NAPIValue)&ref->value, ref), Exception, Exception)
-            JS_FreeValue(env->context, ref->value);
+            CHECK_NAPI(setWeak(env, reference), Exception, Exception)
+            // 可能触发 weakReferenceFinalizer，value 会被置为 undefined
+            reference->referenceCount = 0;
+            JS_FreeValue(env->context, reference->value);
         }
         else
         {
-            LIST_INSERT_HEAD(&env->valueList, ref, node);
-            JS_FreeValue(env->context, ref->value);
-            ref->value = undefinedValue;
+            JS_FreeValue(env->context, reference->value);
+            reference->value = undefinedValue;
+            reference->referenceCount = 0;
+        }
+        if (result)
+        {
+            *result = 0;
         }
+
+        return NAPIExceptionOK;
     }
-    uint8_t count = --ref->referenceCount;
+    uint32_t count = --reference->referenceCount;
     if (result)
     {
         *result = count;
@@ -1275,13 +1511,16 @@ NAPIExceptionStatus napi_get_reference_value(NAPIEnv env, NAPIRef ref, NAPIValue
     CHECK_ARG(ref, Exception)
     CHECK_ARG(result, Exception)
 
-    if (!ref->referenceCount && JS_IsUndefined(ref->value))
+    struct Reference *reference = referenceTableGet(&env->referenceTable, ref);
+    CHECK_ARG(reference, Exception)
+
+    if (!reference->referenceCount && JS_IsUndefined(reference->value))
     {
         *result = NULL;
     }
     else
     {
-        JSValue strongValue = JS_DupValue(env->context, ref->value);
+        JSValue strongValue = JS_DupValue(env->context, reference->value);
         struct Handle *handleScope;
         NAPIErrorStatus errorStatus = addValueToHandleScope(env, strongValue, &handleScope);
         if (__builtin_expect(errorStatus != NAPIErrorOK, false))
@@ -1308,6 +1547,7 @@ NAPIErrorStatus napi_open_handle_scope(NAPIEnv env, NAPIHandleScope *result)
     *result = handleScope;
     SLIST_INIT(&(*result)->handleList);
     LIST_INSERT_HEAD(&env->handleScopeList, *result, node);
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
@@ -1318,6 +1558,7 @@ NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
     CHECK_ARG(env, Common)
     CHECK_ARG(scope, Common)
 
+    NAPI_USDT_PROBE2(handle_scope_close, env, scope);
     // 先入后出 stack 规则
     assert(LIST_FIRST(&env->handleScopeList) == scope &&
            "napi_close_handle_scope() or napi_close_escapable_handle_scope() should follow FILO rule.");
@@ -1330,6 +1571,11 @@ NAPICommonStatus napi_close_handle_scope(NAPIEnv env, NAPIHandleScope scope)
     // 这里和前面的 assert 要求 env->handleScopeList 必须是 LIST 双向链表
     LIST_REMOVE(scope, node);
     free(scope);
+    // 最外层 handle scope 关闭，没有 native 代码在栈上，可以执行延迟的 finalizer
+    if (LIST_EMPTY(&env->handleScopeList))
+    {
+        finalizerQueueDrainAtSafePoint(env->finalizerQueue);
+    }
 
     return NAPICommonOK;
 }
@@ -1355,6 +1601,7 @@ NAPIErrorStatus napi_open_escapable_handle_scope(NAPIEnv env, NAPIEscapableHandl
     (*result)->escapeCalled = false;
     SLIST_INIT(&(*result)->handleScope.handleList);
     LIST_INSERT_HEAD(&env->handleScopeList, &(*result)->handleScope, node);
+    NAPI_USDT_PROBE2(handle_scope_open, env, *result);
 
     return NAPIErrorOK;
 }
@@ -1454,23 +1701,9 @@ NAPICommonStatus NAPIClearLastException(NAPIEnv env)
     return NAPICommonOK;
 }
 
-// NAPIPendingException + addValueToHandleScope
-NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+// 处理 JS_Eval/JS_EvalFunction 返回值并执行微任务，获取 returnValue 所有权
+static NAPIExceptionStatus setEvalResult(NAPIEnv env, JSValue returnValue, NAPIValue *result)
 {
-
-    NAPI_PREAMBLE(env)
-
-    // script 传入 NULL 会崩
-    if (!script)
-    {
-        script = "";
-    }
-    // utf8SourceUrl 传入 NULL 会导致崩溃，JS_NewAtom 调用 strlen，因此不能传入 NULL
-    if (!sourceUrl)
-    {
-        sourceUrl = "";
-    }
-    JSValue returnValue = JS_Eval(env->context, script, strlen(script), sourceUrl, JS_EVAL_TYPE_GLOBAL);
     if (JS_IsException(returnValue))
     {
         JSValue exceptionValue = JS_GetException(env->context);
@@ -1507,6 +1740,92 @@ NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *s
     return NAPIExceptionOK;
 }
 
+// 返回值和 JS_Eval JS_EVAL_FLAG_COMPILE_ONLY 一致，缓存读取或者写入失败时退化为直接编译
+// script[scriptLength] 需要为 \0，evalType 为 JS_EVAL_TYPE_GLOBAL 或者 JS_EVAL_TYPE_MODULE，两者不共用条目
+// evalType 可以附加 JS_EVAL_FLAG_STRICT，作为 key 的一部分，和非严格模式不共用条目
+static JSValue compileWithCodeCache(NAPIEnv env, const char *script, size_t scriptLength, const char *sourceUrl,
+                                    int evalType)
+{
+    struct CodeCache *codeCache = env->runtime->codeCache;
+    struct CodeCacheKey key;
+    codeCacheGetKey(codeCache, script, scriptLength, sourceUrl, (uint32_t)evalType, &key);
+    struct MappedFile mappedFile;
+    size_t offset;
+    if (codeCacheOpen(codeCache, &key, &mappedFile, &offset))
+    {
+        // JS_ReadObject 会复制全部内容，读取后即可解除映射
+        JSValue functionValue = JS_ReadObject(env->context, mappedFile.data + offset, mappedFile.size - offset,
+                                              JS_READ_OBJ_BYTECODE);
+        mappedFileClose(&mappedFile);
+        if (!JS_IsException(functionValue))
+        {
+            return functionValue;
+        }
+        JS_FreeValue(env->context, JS_GetException(env->context));
+        codeCacheRemove(codeCache, &key);
+    }
+    JSValue functionValue =
+        JS_Eval(env->context, script, scriptLength, sourceUrl, JS_EVAL_FLAG_COMPILE_ONLY | evalType);
+    if (JS_IsException(functionValue))
+    {
+        return functionValue;
+    }
+    size_t bufferSize;
+    uint8_t *byteBuffer = JS_WriteObject(env->context, &bufferSize, functionValue, JS_WRITE_OBJ_BYTECODE);
+    if (byteBuffer)
+    {
+        codeCacheWrite(codeCache, &key, byteBuffer, bufferSize);
+        js_free(env->context, byteBuffer);
+    }
+    else
+    {
+        JS_FreeValue(env->context, JS_GetException(env->context));
+    }
+
+    return functionValue;
+}
+
+// evalFlags 为 JS_EVAL_TYPE_GLOBAL，可以附加 JS_EVAL_FLAG_STRICT
+static JSValue evalScript(NAPIEnv env, const char *script, size_t scriptLength, const char *sourceUrl, int evalFlags)
+{
+    if (!env->runtime->codeCache)
+    {
+        return JS_Eval(env->context, script, scriptLength, sourceUrl, evalFlags);
+    }
+    JSValue functionValue = compileWithCodeCache(env, script, scriptLength, sourceUrl, evalFlags);
+    if (JS_IsException(functionValue))
+    {
+        return functionValue;
+    }
+
+    return JS_EvalFunction(env->context, functionValue);
+}
+
+// NAPIPendingException + addValueToHandleScope
+NAPIExceptionStatus NAPIRunScript(NAPIEnv env, const char *script, const char *sourceUrl, NAPIValue *result)
+{
+
+    NAPI_PREAMBLE(env)
+
+    // script 传入 NULL 会崩
+    if (!script)
+    {
+        script = "";
+    }
+    // utf8SourceUrl 传入 NULL 会导致崩溃，JS_NewAtom 调用 strlen，因此不能传入 NULL
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    JSValue returnValue = evalScript(env, script, strlen(script), sourceUrl, JS_EVAL_TYPE_GLOBAL);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScript", sourceUrl, traceBeginTime);
+
+    return setEvalResult(env, returnValue, result);
+}
+
 static void functionFinalizer(JSRuntime *rt, JSValue val)
 {
     NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
@@ -1530,9 +1849,37 @@ static void externalFinalizer(JSRuntime *rt, JSValue val)
         return;
     }
     ExternalInfo *externalInfo = JS_GetOpaque(val, runtime->externalClassId);
+    if (externalInfo && externalInfo->externalMemory)
+    {
+        externalMemoryAdjust(externalInfo->externalMemory, -(int64_t)externalInfo->externalMemorySize);
+        externalMemoryRelease(externalInfo->externalMemory);
+    }
     if (externalInfo && externalInfo->finalizeCallback)
     {
-        externalInfo->finalizeCallback(externalInfo->data, externalInfo->finalizeHint);
+        finalizerQueueFinalize(externalInfo->finalizerQueue, externalInfo->finalizeCallback, externalInfo->data,
+                               externalInfo->finalizeHint);
+    }
+    free(externalInfo);
+}
+
+static void instanceFinalizer(JSRuntime *rt, JSValue val)
+{
+    NAPIRuntime runtime = JS_GetRuntimeOpaque(rt);
+    if (__builtin_expect(!runtime->instanceClassId, false))
+    {
+        assert(false && INSTANCE_CLASS_ID_ZERO);
+
+        return;
+    }
+    ExternalInfo *externalInfo = JS_GetOpaque(val, runtime->instanceClassId);
+    if (!externalInfo || externalInfo == &emptyInstanceInfo)
+    {
+        return;
+    }
+    if (externalInfo->finalizeCallback)
+    {
+        finalizerQueueFinalize(externalInfo->finalizerQueue, externalInfo->finalizeCallback, externalInfo->data,
+                               externalInfo->finalizeHint);
     }
     free(externalInfo);
 }
@@ -1542,7 +1889,6 @@ static void externalFinalizer(JSRuntime *rt, JSValue val)
 typedef struct
 {
     FunctionInfo functionInfo;
-    JSClassID classId; // uint32_t
 } ConstructorInfo;
 
 // static JSClassID constructorClassId = 0;
@@ -1577,21 +1923,31 @@ static JSValue callAsConstructor(JSContext *ctx, JSValueConst newTarget, int arg
 
         return undefinedValue;
     }
+    if (__builtin_expect(!runtime->instanceClassId, false))
+    {
+        JS_FreeValue(ctx, prototypeValue);
+        assert(false && INSTANCE_CLASS_ID_ZERO);
+
+        return undefinedValue;
+    }
     ConstructorInfo *constructorInfo = JS_GetOpaque(prototypeValue, runtime->constructorClassId);
-    JS_FreeValue(ctx, prototypeValue);
     if (__builtin_expect(!constructorInfo || !constructorInfo->functionInfo.baseInfo.env ||
-                             !constructorInfo->functionInfo.callback || !constructorInfo->classId,
+                             !constructorInfo->functionInfo.callback,
                          false))
     {
+        JS_FreeValue(ctx, prototypeValue);
         assert(false);
 
         return undefinedValue;
     }
-    JSValue thisValue = JS_NewObjectClass(ctx, (int)constructorInfo->classId);
+    // 所有类共享 instanceClassId，实例 opaque 用于 napi_wrap
+    JSValue thisValue = JS_NewObjectProtoClass(ctx, prototypeValue, runtime->instanceClassId);
+    JS_FreeValue(ctx, prototypeValue);
     if (__builtin_expect(JS_IsException(thisValue), false))
     {
         return thisValue;
     }
+    JS_SetOpaque(thisValue, &emptyInstanceInfo);
     struct OpaqueNAPICallbackInfo callbackInfo = {newTarget, thisValue, argv,
                                                   constructorInfo->functionInfo.baseInfo.data, argc};
     NAPIHandleScope handleScope = NULL;
@@ -1600,8 +1956,12 @@ static JSValue callAsConstructor(JSContext *ctx, JSValueConst newTarget, int arg
         assert(status == NAPIErrorOK);
         (void)status;
     }
+    NAPI_USDT_PROBE2(constructor_entry, constructorInfo->functionInfo.baseInfo.env,
+                     constructorInfo->functionInfo.callback);
     NAPIValue retVal =
         constructorInfo->functionInfo.callback(constructorInfo->functionInfo.baseInfo.env, &callbackInfo);
+    NAPI_USDT_PROBE2(constructor_return, constructorInfo->functionInfo.baseInfo.env,
+                     constructorInfo->functionInfo.callback);
     if (retVal && JS_IsObject(*((JSValue *)retVal)))
     {
         JSValue returnValue = JS_DupValue(ctx, *((JSValue *)retVal));
@@ -1654,18 +2014,9 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
     constructorInfo->functionInfo.baseInfo.env = env;
     constructorInfo->functionInfo.baseInfo.data = data;
     constructorInfo->functionInfo.callback = constructor;
-    constructorInfo->classId = 0;
-    JS_NewClassID(&constructorInfo->classId);
-    JSClassDef classDef = {utf8name ?: "", NULL, NULL, NULL, NULL};
-    int status = JS_NewClass(env->runtime->runtime, constructorInfo->classId, &classDef);
-    if (__builtin_expect(status == -1, false))
-    {
-        free(constructorInfo);
-
-        return NAPIExceptionPendingException;
-    }
     if (__builtin_expect(!env->runtime->constructorClassId, false))
     {
+        free(constructorInfo);
         assert(false && CONSTRUCTOR_CLASS_ID_ZERO);
 
         return NAPIExceptionGenericFailure;
@@ -1694,22 +2045,28 @@ NAPIExceptionStatus NAPIDefineClass(NAPIEnv env, const char *utf8name, NAPICallb
         JS_FreeValue(env->context, constructorValue);
         JS_FreeValue(env->context, prototype);
 
-        return status;
+        return (NAPIExceptionStatus)addStatus;
     }
     *result = (NAPIValue)&handle->value;
     // .prototype .constructor
     // 会自动引用计数 +1
     JS_SetConstructor(env->context, constructorValue, prototype);
-    // context -> class_proto
-    // 转移所有权
-    JS_SetClassProto(env->context, constructorInfo->classId, prototype);
+    // 实例由 callAsConstructor 通过 new.target.prototype 创建，不再需要 class_proto
+    JS_FreeValue(env->context, prototype);
 
     return NAPIExceptionOK;
 }
 
 NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
 {
-    CHECK_ARG(runtime, Error)
+    return NAPICreateRuntimeWithConfig(runtime, NULL);
+}
+
+NAPIErrorStatus NAPICreateRuntimeWithConfig(NAPIRuntime *runtime, const NAPIRuntimeConfig *config)
+{
+    CHECK_ARG(runtime, Error)
+    RETURN_STATUS_IF_FALSE(!config || (config->version && config->version <= NAPI_RUNTIME_CONFIG_VERSION),
+                           NAPIErrorInvalidArg)
 
     *runtime = malloc(sizeof(struct OpaqueNAPIRuntime));
     RETURN_STATUS_IF_FALSE(*runtime, NAPIErrorMemoryError)
@@ -1719,6 +2076,19 @@ NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
     (*runtime)->constructorClassId = 0;
     (*runtime)->functionClassId = 0;
     (*runtime)->externalClassId = 0;
+    (*runtime)->instanceClassId = 0;
+    (*runtime)->inlineExternalClassId = 0;
+    (*runtime)->weakReferenceClassId = 0;
+    (*runtime)->gcCount = 0;
+    (*runtime)->gcNanoseconds = 0;
+    (*runtime)->profilingEnv = NULL;
+    (*runtime)->cpuProfile = NULL;
+    (*runtime)->profileAtomTable = NULL;
+    (*runtime)->interruptHandler = NULL;
+    (*runtime)->interruptData = NULL;
+    (*runtime)->codeCache = NULL;
+    (*runtime)->externalMemory = NULL;
+    (*runtime)->isSampling = false;
     if (!(*runtime)->runtime)
     {
         free(*runtime);
@@ -1726,11 +2096,25 @@ NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
         return NAPIErrorMemoryError;
     }
     JS_SetRuntimeOpaque((*runtime)->runtime, *runtime);
-    JS_SetMaxStackSize((*runtime)->runtime, 4 * JS_DEFAULT_STACK_SIZE);
+    size_t stackSize = config && config->stackSize ? config->stackSize : 4 * JS_DEFAULT_STACK_SIZE;
+    JS_SetMaxStackSize((*runtime)->runtime, stackSize);
+    // QuickJS 没有独立的 GC 堆，堆上限即 malloc 上限
+    size_t memoryLimit = config ? (config->memoryLimit ?: config->maxHeapSize) : 0;
+    if (memoryLimit)
+    {
+        JS_SetMemoryLimit((*runtime)->runtime, memoryLimit);
+    }
+    if (config && config->gcThreshold)
+    {
+        JS_SetGCThreshold((*runtime)->runtime, config->gcThreshold);
+    }
     // 一定成功
     JS_NewClassID(&(*runtime)->constructorClassId);
     JS_NewClassID(&(*runtime)->functionClassId);
     JS_NewClassID(&(*runtime)->externalClassId);
+    JS_NewClassID(&(*runtime)->instanceClassId);
+    JS_NewClassID(&(*runtime)->inlineExternalClassId);
+    JS_NewClassID(&(*runtime)->weakReferenceClassId);
     JSClassDef classDef = {"External", externalFinalizer, NULL, NULL, NULL};
     // JS_NewClass -> JS_NewClass1 返回值只有 -1 和 0
     int status = JS_NewClass((*runtime)->runtime, (*runtime)->externalClassId, &classDef);
@@ -1764,14 +2148,68 @@ NAPIErrorStatus NAPICreateRuntime(NAPIRuntime *runtime)
         return NAPIErrorGenericFailure;
     }
 
+    classDef.class_name = "Instance";
+    classDef.finalizer = instanceFinalizer;
+    status = JS_NewClass((*runtime)->runtime, (*runtime)->instanceClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    // opaque 即 data，不需要 finalizer
+    classDef.class_name = "External";
+    classDef.finalizer = NULL;
+    status = JS_NewClass((*runtime)->runtime, (*runtime)->inlineExternalClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    classDef.class_name = "WeakReference";
+    classDef.finalizer = weakReferenceFinalizer;
+    status = JS_NewClass((*runtime)->runtime, (*runtime)->weakReferenceClassId, &classDef);
+    if (__builtin_expect(status == -1, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    // externalMemoryLimit 为 version 2 新增字段
+    (*runtime)->externalMemory =
+        externalMemoryCreate(config && config->version >= 2 ? config->externalMemoryLimit : 0);
+    if (__builtin_expect(!(*runtime)->externalMemory, false))
+    {
+        JS_FreeRuntime((*runtime)->runtime);
+        free(*runtime);
+
+        return NAPIErrorMemoryError;
+    }
+
     return NAPIErrorOK;
 }
 
 // NAPIGenericFailure/NAPIMemoryError
 NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
+{
+    return NAPICreateEnvWithConfig(env, runtime, NULL);
+}
+
+// NAPIInvalidArg + NAPICreateEnv
+NAPIErrorStatus NAPICreateEnvWithConfig(NAPIEnv *env, NAPIRuntime runtime, const NAPIRuntimeConfig *config)
 {
     CHECK_ARG(env, Error)
     CHECK_ARG(runtime, Error)
+    // JSContext 共享 JSRuntime 的堆和栈配置，这里只校验 version
+    RETURN_STATUS_IF_FALSE(!config || (config->version && config->version <= NAPI_RUNTIME_CONFIG_VERSION),
+                           NAPIErrorInvalidArg)
 
     // Resource - NAPIEnv
     *env = malloc(sizeof(struct OpaqueNAPIEnv));
@@ -1795,7 +2233,9 @@ NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
 
         return NAPIErrorGenericFailure;
     }
-    JS_SetClassProto(context, runtime->externalClassId, prototype);
+    // 两种 External 共享同一个原型
+    JS_SetClassProto(context, runtime->externalClassId, JS_DupValue(context, prototype));
+    JS_SetClassProto(context, runtime->inlineExternalClassId, prototype);
     prototype = JS_NewObject(context);
     if (__builtin_expect(JS_IsException(prototype), false))
     {
@@ -1805,30 +2245,309 @@ NAPIErrorStatus NAPICreateEnv(NAPIEnv *env, NAPIRuntime runtime)
         return NAPIErrorGenericFailure;
     }
     JS_SetClassProto(context, runtime->constructorClassId, prototype);
-    const char *string = "(function () { return Symbol(\"reference\") })();";
-    (*env)->referenceSymbolValue =
-        JS_Eval(context, string, strlen(string), "https://n-api.com/qjs_reference_symbol.js", JS_EVAL_TYPE_GLOBAL);
-    if (__builtin_expect(JS_IsException((*env)->referenceSymbolValue), false))
+    const char *string = "new WeakMap();";
+    (*env)->weakMapValue =
+        JS_Eval(context, string, strlen(string), "https://n-api.com/qjs_reference_weak_map.js", JS_EVAL_TYPE_GLOBAL);
+    if (__builtin_expect(JS_IsException((*env)->weakMapValue), false))
+    {
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorGenericFailure;
+    }
+    (*env)->weakMapGetValue = JS_GetPropertyStr(context, (*env)->weakMapValue, "get");
+    (*env)->weakMapSetValue = JS_GetPropertyStr(context, (*env)->weakMapValue, "set");
+    if (__builtin_expect(!JS_IsFunction(context, (*env)->weakMapGetValue) ||
+                             !JS_IsFunction(context, (*env)->weakMapSetValue),
+                         false))
     {
+        // JS_FreeValue 可以传入 JS_EXCEPTION
+        JS_FreeValue(context, (*env)->weakMapGetValue);
+        JS_FreeValue(context, (*env)->weakMapSetValue);
+        JS_FreeValue(context, (*env)->weakMapValue);
         JS_FreeContext(context);
         free(*env);
 
         return NAPIErrorGenericFailure;
     }
+    (*env)->finalizerQueue = finalizerQueueCreate();
+    if (__builtin_expect(!(*env)->finalizerQueue, false))
+    {
+        JS_FreeValue(context, (*env)->weakMapGetValue);
+        JS_FreeValue(context, (*env)->weakMapSetValue);
+        JS_FreeValue(context, (*env)->weakMapValue);
+        JS_FreeContext(context);
+        free(*env);
+
+        return NAPIErrorMemoryError;
+    }
     (*env)->context = context;
+    (*env)->trace = NULL;
+    (*env)->moduleResolveCallback = NULL;
+    (*env)->moduleLoadCallback = NULL;
+    (*env)->moduleLoaderData = NULL;
+    (*env)->archiveResultCache = NULL;
     (*env)->isThrowNull = false;
+    // 模块加载函数属于 JSRuntime，通过 context opaque 找到 env
+    JS_SetContextOpaque(context, *env);
     LIST_INIT(&(*env)->handleScopeList);
     LIST_INIT(&(*env)->weakReferenceList);
-    LIST_INIT(&(*env)->valueList);
-    LIST_INIT(&(*env)->strongRefList);
+    referenceTableInit(&(*env)->referenceTable, sizeof(struct Reference));
 
     return NAPIErrorOK;
 }
 
+#define INDEX_MAP_INITIAL_CAPACITY 64
+
+// 保证 32 位平台上字节数不会溢出 size_t
+#define INDEX_MAP_MAX_CAPACITY (1U << 27)
+
+#define INDEX_MAP_NOT_FOUND UINT32_MAX
+
+// key -> 下标，开放寻址，key 为对象指针或者 atom，0 代表空位
+struct IndexMap
+{
+    uintptr_t *keyList;  // size_t
+    uint32_t *valueList; // size_t
+    // 2 的幂
+    uint32_t capacity; // uint32_t
+    uint32_t count;    // uint32_t
+};
+
+// 指针低位对齐为 0，混合高位
+static uint32_t indexMapHash(const struct IndexMap *map, uintptr_t key)
+{
+    return (uint32_t)((key ^ (key >> 16)) * 2654435761U) & (map->capacity - 1);
+}
+
+static uint32_t indexMapGet(const struct IndexMap *map, uintptr_t key)
+{
+    if (!map->capacity)
+    {
+        return INDEX_MAP_NOT_FOUND;
+    }
+    for (uint32_t index = indexMapHash(map, key); map->keyList[index]; index = (index + 1) & (map->capacity - 1))
+    {
+        if (map->keyList[index] == key)
+        {
+            return map->valueList[index];
+        }
+    }
+
+    return INDEX_MAP_NOT_FOUND;
+}
+
+static void indexMapInsert(struct IndexMap *map, uintptr_t key, uint32_t value)
+{
+    uint32_t index = indexMapHash(map, key);
+    while (map->keyList[index])
+    {
+        index = (index + 1) & (map->capacity - 1);
+    }
+    map->keyList[index] = key;
+    map->valueList[index] = value;
+    ++map->count;
+}
+
+// key 不能已经存在，负载因子不超过 1/2，返回 false 代表内存不足
+static bool indexMapSet(struct IndexMap *map, uintptr_t key, uint32_t value)
+{
+    if ((size_t)(map->count + 1) * 2 > map->capacity)
+    {
+        uint32_t capacity = map->capacity ? map->capacity * 2 : INDEX_MAP_INITIAL_CAPACITY;
+        if (capacity > INDEX_MAP_MAX_CAPACITY)
+        {
+            return false;
+        }
+        struct IndexMap newMap = {calloc(capacity, sizeof(uintptr_t)), malloc(sizeof(uint32_t) * capacity),
+                                         capacity, 0};
+        if (!newMap.keyList || !newMap.valueList)
+        {
+            free(newMap.keyList);
+            free(newMap.valueList);
+
+            return false;
+        }
+        for (uint32_t i = 0; i < map->capacity; ++i)
+        {
+            if (map->keyList[i])
+            {
+                indexMapInsert(&newMap, map->keyList[i], map->valueList[i]);
+            }
+        }
+        free(map->keyList);
+        free(map->valueList);
+        *map = newMap;
+    }
+    indexMapInsert(map, key, value);
+
+    return true;
+}
+
+// 采样使用的 atom -> 字符串，持有 atom 引用，避免 atom 释放后被复用导致名称错误
+struct ProfileAtomTable
+{
+    JSAtom *atomList;    // size_t
+    char **stringList;   // size_t
+    struct IndexMap map; // size_t * 2 + uint32_t * 2
+    uint32_t count;      // uint32_t
+    uint32_t capacity;   // uint32_t
+};
+
+// table 可空
+static void profileAtomTableFree(JSRuntime *runtime, struct ProfileAtomTable *table)
+{
+    if (!table)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < table->count; ++i)
+    {
+        JS_FreeAtomRT(runtime, table->atomList[i]);
+        free(table->stringList[i]);
+    }
+    free(table->atomList);
+    free(table->stringList);
+    free(table->map.keyList);
+    free(table->map.valueList);
+    free(table);
+}
+
+// 每个 atom 只转换一次，JS_ATOM_NULL 为空字符串，返回 NULL 代表内存不足
+static const char *profileAtomTableGet(JSContext *context, struct ProfileAtomTable *table, JSAtom atom)
+{
+    if (atom == JS_ATOM_NULL)
+    {
+        return "";
+    }
+    uint32_t index = indexMapGet(&table->map, atom);
+    if (index != INDEX_MAP_NOT_FOUND)
+    {
+        return table->stringList[index];
+    }
+    if (table->count == table->capacity)
+    {
+        uint32_t capacity = table->capacity ? table->capacity * 2 : INDEX_MAP_INITIAL_CAPACITY;
+        JSAtom *atomList = realloc(table->atomList, sizeof(JSAtom) * capacity);
+        if (!atomList)
+        {
+            return NULL;
+        }
+        table->atomList = atomList;
+        char **stringList = realloc(table->stringList, sizeof(char *) * capacity);
+        if (!stringList)
+        {
+            return NULL;
+        }
+        table->stringList = stringList;
+        table->capacity = capacity;
+    }
+    const char *cString = JS_AtomToCString(context, atom);
+    if (!cString)
+    {
+        return NULL;
+    }
+    char *string = strdup(cString);
+    JS_FreeCString(context, cString);
+    if (!string || !indexMapSet(&table->map, atom, table->count))
+    {
+        free(string);
+
+        return NULL;
+    }
+    table->atomList[table->count] = JS_DupAtom(context, atom);
+    table->stringList[table->count] = string;
+
+    return table->stringList[table->count++];
+}
+
+// 直接读取栈帧，不构造 Error，也不解析调用栈字符串
+static void sampleStack(NAPIEnv env)
+{
+    JSContext *context = env->context;
+    // 转换 atom 内存不足时会抛出异常，不能覆盖已有的异常
+    JSValue exceptionValue = JS_GetException(context);
+    if (!JS_IsNull(exceptionValue))
+    {
+        JS_Throw(context, exceptionValue);
+
+        return;
+    }
+    struct StackWalkFrame walkFrameList[CPU_PROFILE_MAX_FRAME_COUNT];
+    size_t frameCount = stackWalk(context, walkFrameList, CPU_PROFILE_MAX_FRAME_COUNT);
+    struct CPUProfileFrame frameList[CPU_PROFILE_MAX_FRAME_COUNT];
+    for (size_t i = 0; i < frameCount; ++i)
+    {
+        frameList[i].functionName =
+            profileAtomTableGet(context, env->runtime->profileAtomTable, walkFrameList[i].functionName);
+        frameList[i].url = profileAtomTableGet(context, env->runtime->profileAtomTable, walkFrameList[i].url);
+        if (!frameList[i].functionName || !frameList[i].url)
+        {
+            // 内存不足时丢弃本次采样
+            JS_FreeValue(context, JS_GetException(context));
+
+            return;
+        }
+        // QuickJS 行号从 1 开始，.cpuprofile 从 0 开始，没有列号
+        frameList[i].lineNumber = walkFrameList[i].lineNumber - 1;
+        frameList[i].columnNumber = -1;
+    }
+    // 内存不足时丢弃本次采样
+    cpuProfileAddSample(env->runtime->cpuProfile, frameList, frameCount);
+}
+
+// 解释器大约每执行 10000 条指令调用一次
+static int runtimeInterruptHandler(__attribute__((unused)) JSRuntime *rt, void *opaque)
+{
+    NAPIRuntime runtime = opaque;
+    if (runtime->profilingEnv && !runtime->isSampling && cpuProfileIsSampleDue(runtime->cpuProfile))
+    {
+        runtime->isSampling = true;
+        sampleStack(runtime->profilingEnv);
+        runtime->isSampling = false;
+    }
+
+    // 返回非 0 代表中断执行，抛出不可捕获的 InternalError
+    return runtime->interruptHandler && runtime->interruptHandler(runtime->interruptData);
+}
+
+// 采样和 NAPISetInterruptHandler 都没有开启时移除，互相不会覆盖
+static void updateInterruptHandler(NAPIRuntime runtime)
+{
+    if (runtime->profilingEnv || runtime->interruptHandler)
+    {
+        JS_SetInterruptHandler(runtime->runtime, runtimeInterruptHandler, runtime);
+    }
+    else
+    {
+        JS_SetInterruptHandler(runtime->runtime, NULL, NULL);
+    }
+}
+
+// 返回采样结果，所有权转移给调用方，env 没有在采样时返回 NULL
+static struct CPUProfile *stopProfiling(NAPIEnv env)
+{
+    if (env->runtime->profilingEnv != env)
+    {
+        return NULL;
+    }
+    struct CPUProfile *profile = env->runtime->cpuProfile;
+    profileAtomTableFree(env->runtime->runtime, env->runtime->profileAtomTable);
+    env->runtime->profilingEnv = NULL;
+    env->runtime->cpuProfile = NULL;
+    env->runtime->profileAtomTable = NULL;
+    updateInterruptHandler(env->runtime);
+
+    return profile;
+}
+
 NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
 {
     CHECK_ARG(env, Common)
 
+    // 未调用 NAPIStopProfiling 直接丢弃采样结果
+    cpuProfileFree(stopProfiling(env));
+    traceFree(env->trace);
     NAPIHandleScope handleScope, tempHandleScope;
     LIST_FOREACH_SAFE(handleScope, &env->handleScopeList, node, tempHandleScope)
     {
@@ -1842,173 +2561,705 @@ NAPICommonStatus NAPIFreeEnv(NAPIEnv env)
         LIST_REMOVE(handleScope, node);
         free(handleScope);
     }
-    NAPIRef ref, temp;
-    LIST_FOREACH_SAFE(ref, &env->strongRefList, node, temp)
+    // 强引用释放可能触发 weakReferenceFinalizer 修改其他 slot，slot 内存在 referenceTableFinalize 之前一直有效
+    for (uint32_t i = 0; i < env->referenceTable.slotCount; ++i)
     {
-        LIST_REMOVE(ref, node);
-        JS_FreeValue(env->context, ref->value);
-        free(ref);
+        struct Reference *reference = referenceTableGetSlot(&env->referenceTable, i);
+        if (reference && reference->referenceCount)
+        {
+            JS_FreeValue(env->context, reference->value);
+        }
     }
     struct WeakReference *referenceInfo, *tempReferenceInfo;
     LIST_FOREACH_SAFE(referenceInfo, &env->weakReferenceList, node, tempReferenceInfo)
     {
-        LIST_FOREACH_SAFE(ref, &referenceInfo->weakRefList, node, temp)
-        {
-            LIST_REMOVE(ref, node);
-            free(ref);
-        }
         LIST_REMOVE(referenceInfo, node);
         referenceInfo->isEnvFreed = true;
         // referenceInfo 本身不销毁，等到 GC 阶段销毁
     }
-    // 到这一步，所有弱引用已经全部释放完成
-    LIST_FOREACH_SAFE(ref, &env->valueList, node, temp)
-    {
-        LIST_REMOVE(ref, node);
-        free(ref);
-    }
-    JS_FreeValue(env->context, env->referenceSymbolValue);
+    // 到这一步，所有引用已经全部释放完成
+    referenceTableFinalize(&env->referenceTable);
+    // 缓存的 NAPIRef 已经随引用表释放
+    bytecodeArchiveResultCacheFree(env->archiveResultCache);
+    // 所有 WeakReference 已经标记 isEnvFreed，WeakMap 释放时 weakReferenceFinalizer 只需要 free 自身
+    JS_FreeValue(env->context, env->weakMapGetValue);
+    JS_FreeValue(env->context, env->weakMapSetValue);
+    JS_FreeValue(env->context, env->weakMapValue);
     JS_FreeContext(env->context);
+    // JS_FreeContext 触发的 finalizer 也在这里执行，之后存活对象的 finalizer 同步调用
+    finalizerQueueClose(env->finalizerQueue);
     free(env);
 
     return NAPICommonOK;
 }
 
-NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
+NAPICommonStatus NAPISetFinalizerMode(NAPIEnv env, NAPIFinalizerMode mode)
 {
-    CHECK_ARG(runtime, Common)
+    CHECK_ARG(env, Common)
 
-    JS_FreeRuntime(runtime->runtime);
+    finalizerQueueSetMode(env->finalizerQueue, mode);
 
     return NAPICommonOK;
 }
 
-NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
+NAPICommonStatus NAPIRunPendingFinalizers(NAPIEnv env, size_t budget, size_t *remaining)
 {
+    CHECK_ARG(env, Common)
 
-    CHECK_ARG(env, Error)
-    CHECK_ARG(value, Error)
-    CHECK_ARG(result, Error)
-
-    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected);
-
-    *result = JS_ToCString(env->context, *((JSValue *)value));
+    size_t count = finalizerQueueDrain(env->finalizerQueue, budget);
+    if (remaining)
+    {
+        *remaining = count;
+    }
 
-    return NAPIErrorOK;
+    return NAPICommonOK;
 }
 
-NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
+NAPICommonStatus NAPIGetFinalizerStats(NAPIEnv env, NAPIFinalizerStats *stats)
 {
-
     CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
 
-    JS_FreeCString(env->context, cString);
+    finalizerQueueGetStats(env->finalizerQueue, stats);
 
     return NAPICommonOK;
 }
 
-NAPICommonStatus NAPIEnableDebugger(__attribute__((unused)) NAPIEnv env,
-                                    __attribute__((unused)) const char *debuggerTitle,
-                                    __attribute__((unused)) bool waitForDebugger)
+NAPICommonStatus NAPIRunGC(NAPIEnv env, NAPIGCKind kind)
 {
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(kind == NAPIGCKindFull || kind == NAPIGCKindYoung, NAPICommonInvalidArg)
+
+    // QuickJS 没有分代，引用计数已经释放非循环对象，JS_RunGC 只回收循环引用
+    runGC(env);
+
     return NAPICommonOK;
 }
 
-NAPICommonStatus NAPIDisableDebugger(__attribute__((unused)) NAPIEnv env)
+NAPICommonStatus NAPINotifyMemoryPressure(NAPIEnv env, NAPIMemoryPressureLevel level)
 {
+    CHECK_ARG(env, Common)
+    RETURN_STATUS_IF_FALSE(level == NAPIMemoryPressureLevelModerate || level == NAPIMemoryPressureLevelCritical,
+                           NAPICommonInvalidArg)
+
+    runGC(env);
+    if (level == NAPIMemoryPressureLevelCritical)
+    {
+        finalizerQueueDrain(env->finalizerQueue, 0);
+    }
+
     return NAPICommonOK;
 }
-NAPICommonStatus NAPISetMessageQueueThread(__attribute__((unused)) NAPIEnv env,
-                                           __attribute__((unused)) MessageQueueThreadWrapper jsQueueWrapper)
+
+NAPICommonStatus NAPIGetHeapStatistics(NAPIEnv env, NAPIHeapStats *stats)
 {
+    CHECK_ARG(env, Common)
+    CHECK_ARG(stats, Common)
+
+    JSMemoryUsage memoryUsage;
+    JS_ComputeMemoryUsage(env->runtime->runtime, &memoryUsage);
+    stats->usedHeapSize = (size_t)memoryUsage.memory_used_size;
+    stats->totalHeapSize = (size_t)memoryUsage.malloc_size;
+    stats->objectCount = (size_t)memoryUsage.obj_count;
+    stats->stringCount = (size_t)memoryUsage.str_count;
+    stats->functionCount = (size_t)(memoryUsage.js_func_count + memoryUsage.c_func_count);
+    stats->externalMemorySize = externalMemoryAdjust(env->runtime->externalMemory, 0);
+    stats->gcCount = env->runtime->gcCount;
+    stats->gcNanoseconds = env->runtime->gcNanoseconds;
+    stats->gcExternalMemorySize = 0;
+
     return NAPICommonOK;
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
-                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+// 使用 heapWalk 遍历整个 runtime 的 GC 对象链表，不执行 getter 和 Proxy trap，多个 env 共享 runtime 时快照包含所有 env
+// 节点大小为 malloc_usable_size 统计的自身分配大小，字符串等原始值不是 GC 对象，不会成为节点
+// 遍历期间只保存节点和边，atom 在遍历结束后转换为字符串
+#define HEAP_SNAPSHOT_NODE_HIDDEN 0
+#define HEAP_SNAPSHOT_NODE_ARRAY 1
+#define HEAP_SNAPSHOT_NODE_OBJECT 3
+#define HEAP_SNAPSHOT_NODE_CODE 4
+#define HEAP_SNAPSHOT_NODE_CLOSURE 5
+#define HEAP_SNAPSHOT_NODE_SYNTHETIC 9
+
+#define HEAP_SNAPSHOT_EDGE_ELEMENT 1
+#define HEAP_SNAPSHOT_EDGE_PROPERTY 2
+#define HEAP_SNAPSHOT_EDGE_INTERNAL 3
+#define HEAP_SNAPSHOT_EDGE_HIDDEN 4
+
+// 字符串表开头的固定字符串，之后为 atomList
+#define HEAP_SNAPSHOT_STRING_EMPTY 0
+#define HEAP_SNAPSHOT_STRING_ROOT 1
+#define HEAP_SNAPSHOT_STRING_GLOBAL 2
+#define HEAP_SNAPSHOT_STRING_ANONYMOUS 3
+#define HEAP_SNAPSHOT_STRING_SHAPE 4
+#define HEAP_SNAPSHOT_STRING_VAR_REF 5
+#define HEAP_SNAPSHOT_STRING_ASYNC_FUNCTION 6
+#define HEAP_SNAPSHOT_STRING_CONTEXT 7
+#define HEAP_SNAPSHOT_STRING_COUNT 8
+
+#define HEAP_SNAPSHOT_INITIAL_CAPACITY 1024
+
+// 各个表的最大元素数量，保证 32 位平台上字节数不会溢出 size_t
+#define HEAP_SNAPSHOT_MAX_CAPACITY (1U << 27)
+
+#define HEAP_SNAPSHOT_NOT_FOUND INDEX_MAP_NOT_FOUND
+
+static const char *const heapSnapshotStringList[HEAP_SNAPSHOT_STRING_COUNT] = {
+    "", "(GC roots)", "global", "(anonymous)", "(shape)", "(closure variable)", "(async function)", "(context)"};
+
+struct HeapSnapshotNode
+{
+    size_t selfSize;    // size_t
+    uint32_t type;      // uint32_t
+    uint32_t name;      // uint32_t
+    uint32_t edgeCount; // uint32_t
+};
+
+struct HeapSnapshotEdge
 {
-    NAPI_PREAMBLE(env)
-    CHECK_ARG(byteBuffer, Exception)
+    // 写入时查找节点下标
+    const void *to;       // size_t
+    uint32_t type;        // uint32_t
+    uint32_t nameOrIndex; // uint32_t
+};
 
-    if (!script)
-    {
-        script = "";
-    }
-    if (!sourceUrl)
+struct HeapSnapshot
+{
+    JSContext *context; // size_t
+    FILE *file;         // size_t
+    // 0 号节点为 (GC roots)，边在写入时生成
+    struct HeapSnapshotNode *nodeList; // size_t
+    // 按所属节点顺序保存
+    struct HeapSnapshotEdge *edgeList; // size_t
+    // 字符串下标为 HEAP_SNAPSHOT_STRING_COUNT + atomList 下标，持有引用
+    JSAtom *atomList;               // size_t
+    struct IndexMap nodeMap; // size_t * 2 + uint32_t * 2
+    struct IndexMap atomMap; // size_t * 2 + uint32_t * 2
+    uint32_t nodeCount;             // uint32_t
+    uint32_t nodeCapacity;          // uint32_t
+    uint32_t edgeCount;             // uint32_t
+    uint32_t edgeCapacity;          // uint32_t
+    uint32_t atomCount;             // uint32_t
+    uint32_t atomCapacity;          // uint32_t
+};
+
+// 保证 list 还能容纳一个元素，返回 false 代表内存不足
+static bool heapSnapshotReserve(void **list, uint32_t *capacity, uint32_t count, size_t elementSize)
+{
+    if (count < *capacity)
     {
-        sourceUrl = "";
+        return true;
     }
-    JSValue returnValue =
-        JS_Eval(env->context, script, strlen(script), sourceUrl, JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL);
-    if (JS_IsException(returnValue))
+    uint32_t newCapacity = *capacity ? *capacity * 2 : HEAP_SNAPSHOT_INITIAL_CAPACITY;
+    if (newCapacity > HEAP_SNAPSHOT_MAX_CAPACITY)
     {
-        goto exceptionHandler;
+        return false;
     }
-    *byteBuffer = JS_WriteObject(env->context, bufferSize, returnValue, JS_WRITE_OBJ_BYTECODE);
-    JS_FreeValue(env->context, returnValue);
-    if (!*byteBuffer)
+    void *newList = realloc(*list, elementSize * newCapacity);
+    if (!newList)
     {
-        goto exceptionHandler;
+        return false;
     }
+    *list = newList;
+    *capacity = newCapacity;
 
-    return NAPIExceptionOK;
+    return true;
+}
 
-exceptionHandler : {
-    JSValue exceptionValue = JS_GetException(env->context);
-    if (JS_IsNull(exceptionValue))
+// 返回字符串下标，JS_ATOM_NULL 为空字符串，HEAP_SNAPSHOT_NOT_FOUND 代表内存不足
+static uint32_t heapSnapshotGetAtomString(struct HeapSnapshot *snapshot, JSAtom atom)
+{
+    if (atom == JS_ATOM_NULL)
     {
-        env->isThrowNull = true;
+        return HEAP_SNAPSHOT_STRING_EMPTY;
     }
-    else
+    uint32_t index = indexMapGet(&snapshot->atomMap, atom);
+    if (index != HEAP_SNAPSHOT_NOT_FOUND)
     {
-        JS_Throw(env->context, exceptionValue);
+        return HEAP_SNAPSHOT_STRING_COUNT + index;
     }
-}
+    if (!heapSnapshotReserve((void **)&snapshot->atomList, &snapshot->atomCapacity, snapshot->atomCount,
+                             sizeof(JSAtom)) ||
+        !indexMapSet(&snapshot->atomMap, atom, snapshot->atomCount))
+    {
+        return HEAP_SNAPSHOT_NOT_FOUND;
+    }
+    // 只增加引用计数，不分配 GC 对象
+    snapshot->atomList[snapshot->atomCount] = JS_DupAtom(snapshot->context, atom);
 
-    return NAPIExceptionPendingException;
+    return HEAP_SNAPSHOT_STRING_COUNT + snapshot->atomCount++;
 }
 
-NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
+static bool heapSnapshotAddNode(void *data, const struct HeapWalkNode *walkNode)
 {
-    CHECK_ARG(env, Common)
-
-    js_free(env->context, (void *)byteBuffer);
+    struct HeapSnapshot *snapshot = data;
+    if (!heapSnapshotReserve((void **)&snapshot->nodeList, &snapshot->nodeCapacity, snapshot->nodeCount,
+                             sizeof(struct HeapSnapshotNode)) ||
+        !indexMapSet(&snapshot->nodeMap, (uintptr_t)walkNode->id, snapshot->nodeCount))
+    {
+        return false;
+    }
+    uint32_t type = HEAP_SNAPSHOT_NODE_HIDDEN;
+    uint32_t defaultName = HEAP_SNAPSHOT_STRING_ANONYMOUS;
+    switch (walkNode->kind)
+    {
+    case HEAP_WALK_NODE_OBJECT:
+        type = HEAP_SNAPSHOT_NODE_OBJECT;
+        break;
+    case HEAP_WALK_NODE_FUNCTION:
+        type = HEAP_SNAPSHOT_NODE_CLOSURE;
+        break;
+    case HEAP_WALK_NODE_ARRAY:
+        type = HEAP_SNAPSHOT_NODE_ARRAY;
+        break;
+    case HEAP_WALK_NODE_BYTECODE:
+        type = HEAP_SNAPSHOT_NODE_CODE;
+        break;
+    case HEAP_WALK_NODE_SHAPE:
+        defaultName = HEAP_SNAPSHOT_STRING_SHAPE;
+        break;
+    case HEAP_WALK_NODE_VAR_REF:
+        defaultName = HEAP_SNAPSHOT_STRING_VAR_REF;
+        break;
+    case HEAP_WALK_NODE_ASYNC_FUNCTION:
+        defaultName = HEAP_SNAPSHOT_STRING_ASYNC_FUNCTION;
+        break;
+    case HEAP_WALK_NODE_CONTEXT:
+        // 写入时从 (GC roots) 连接到所有 synthetic 节点
+        type = HEAP_SNAPSHOT_NODE_SYNTHETIC;
+        defaultName = HEAP_SNAPSHOT_STRING_CONTEXT;
+        break;
+    }
+    uint32_t name = walkNode->name == JS_ATOM_NULL ? defaultName : heapSnapshotGetAtomString(snapshot, walkNode->name);
+    if (name == HEAP_SNAPSHOT_NOT_FOUND)
+    {
+        return false;
+    }
+    struct HeapSnapshotNode *node = &snapshot->nodeList[snapshot->nodeCount++];
+    node->selfSize = walkNode->selfSize;
+    node->type = type;
+    node->name = name;
+    node->edgeCount = 0;
 
-    return NAPICommonOK;
+    return true;
 }
 
-NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
-                                                  NAPIValue *result)
+// 属于最后添加的节点
+static bool heapSnapshotAddEdge(void *data, enum HeapWalkEdgeKind kind, JSAtom name, uint32_t index, const void *to)
 {
-    NAPI_PREAMBLE(env)
-
-    JSValue functionValue = JS_ReadObject(env->context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE);
-    if (JS_IsException(functionValue))
+    struct HeapSnapshot *snapshot = data;
+    if (!heapSnapshotReserve((void **)&snapshot->edgeList, &snapshot->edgeCapacity, snapshot->edgeCount,
+                             sizeof(struct HeapSnapshotEdge)))
     {
-        goto exceptionHandler;
+        return false;
     }
-
-    JSValue returnValue = JS_EvalFunction(env->context, functionValue);
-    if (JS_IsException(returnValue))
+    uint32_t type = HEAP_SNAPSHOT_EDGE_ELEMENT;
+    uint32_t nameOrIndex = index;
+    if (kind != HEAP_WALK_EDGE_ELEMENT)
     {
-        goto exceptionHandlerWithProcess;
+        type = kind == HEAP_WALK_EDGE_PROPERTY ? HEAP_SNAPSHOT_EDGE_PROPERTY : HEAP_SNAPSHOT_EDGE_INTERNAL;
+        nameOrIndex = heapSnapshotGetAtomString(snapshot, name);
+        if (nameOrIndex == HEAP_SNAPSHOT_NOT_FOUND)
+        {
+            return false;
+        }
     }
-    processPendingTask(env);
-    if (result)
+    struct HeapSnapshotEdge *edge = &snapshot->edgeList[snapshot->edgeCount++];
+    edge->to = to;
+    edge->type = type;
+    edge->nameOrIndex = nameOrIndex;
+    ++snapshot->nodeList[snapshot->nodeCount - 1].edgeCount;
+
+    return true;
+}
+
+// 返回 false 代表内存不足
+static bool heapSnapshotCollect(struct HeapSnapshot *snapshot)
+{
+    // (GC roots) 没有对应的 GC 对象，不放入 nodeMap
+    if (!heapSnapshotReserve((void **)&snapshot->nodeList, &snapshot->nodeCapacity, 0,
+                             sizeof(struct HeapSnapshotNode)))
     {
-        struct Handle *returnHandle;
-        NAPIErrorStatus status = addValueToHandleScope(env, returnValue, &returnHandle);
-        if (__builtin_expect(status != NAPIErrorOK, false))
+        return false;
+    }
+    snapshot->nodeList[0].selfSize = 0;
+    snapshot->nodeList[0].type = HEAP_SNAPSHOT_NODE_SYNTHETIC;
+    snapshot->nodeList[0].name = HEAP_SNAPSHOT_STRING_ROOT;
+    snapshot->nodeList[0].edgeCount = 0;
+    snapshot->nodeCount = 1;
+
+    return heapWalk(JS_GetRuntime(snapshot->context), heapSnapshotAddNode, heapSnapshotAddEdge, snapshot);
+}
+
+// to_node 为节点在 nodes 数组中的偏移，每个节点 6 个字段，to 不在快照中时为指向 (GC roots) 的 hidden 边
+static void heapSnapshotWriteEdge(const struct HeapSnapshot *snapshot, bool isFirst, uint32_t type,
+                                  uint32_t nameOrIndex, const void *to)
+{
+    uint32_t nodeIndex = indexMapGet(&snapshot->nodeMap, (uintptr_t)to);
+    if (nodeIndex == HEAP_SNAPSHOT_NOT_FOUND)
+    {
+        type = HEAP_SNAPSHOT_EDGE_HIDDEN;
+        nameOrIndex = 0;
+        nodeIndex = 0;
+    }
+    fprintf(snapshot->file, "%s%u,%u,%llu", isFirst ? "" : ",", type, nameOrIndex,
+            (unsigned long long)nodeIndex * 6);
+}
+
+// (GC roots) 连接全局对象、所有 JSContext 和 NAPIRef 强引用
+static void heapSnapshotWriteRootEdges(const struct HeapSnapshot *snapshot, NAPIEnv env, bool isWrite,
+                                       uint32_t *edgeCount)
+{
+    uint32_t count = 1;
+    if (isWrite)
+    {
+        // 全局对象由 JSContext 持有，这里只使用地址
+        JSValue globalValue = JS_GetGlobalObject(snapshot->context);
+        heapSnapshotWriteEdge(snapshot, true, HEAP_SNAPSHOT_EDGE_PROPERTY, HEAP_SNAPSHOT_STRING_GLOBAL,
+                              JS_VALUE_GET_PTR(globalValue));
+        JS_FreeValue(snapshot->context, globalValue);
+    }
+    for (uint32_t i = 1; i < snapshot->nodeCount; ++i)
+    {
+        if (snapshot->nodeList[i].type == HEAP_SNAPSHOT_NODE_SYNTHETIC)
         {
-            JS_FreeValue(env->context, returnValue);
+            if (isWrite)
+            {
+                fprintf(snapshot->file, ",%u,%u,%llu", HEAP_SNAPSHOT_EDGE_ELEMENT, count,
+                        (unsigned long long)i * 6);
+            }
+            ++count;
+        }
+    }
+    for (uint32_t i = 0; i < env->referenceTable.slotCount; ++i)
+    {
+        struct Reference *reference = referenceTableGetSlot(&env->referenceTable, i);
+        if (reference && reference->referenceCount && JS_IsObject(reference->value))
+        {
+            if (isWrite)
+            {
+                heapSnapshotWriteEdge(snapshot, false, HEAP_SNAPSHOT_EDGE_ELEMENT, count,
+                                      JS_VALUE_GET_PTR(reference->value));
+            }
+            ++count;
+        }
+    }
+    if (edgeCount)
+    {
+        *edgeCount = count;
+    }
+}
 
-            return (NAPIExceptionStatus)status;
+static void heapSnapshotWrite(struct HeapSnapshot *snapshot, NAPIEnv env)
+{
+    FILE *file = snapshot->file;
+    uint32_t rootEdgeCount;
+    heapSnapshotWriteRootEdges(snapshot, env, false, &rootEdgeCount);
+    snapshot->nodeList[0].edgeCount = rootEdgeCount;
+    fprintf(file,
+            "{\"snapshot\":{\"meta\":{\"node_fields\":[\"type\",\"name\",\"id\",\"self_size\",\"edge_count\","
+            "\"trace_node_id\"],\"node_types\":[[\"hidden\",\"array\",\"string\",\"object\",\"code\",\"closure\","
+            "\"regexp\",\"number\",\"native\",\"synthetic\",\"concatenated string\",\"sliced string\",\"symbol\","
+            "\"bigint\"],\"string\",\"number\",\"number\",\"number\",\"number\"],\"edge_fields\":[\"type\","
+            "\"name_or_index\",\"to_node\"],\"edge_types\":[[\"context\",\"element\",\"property\",\"internal\","
+            "\"hidden\",\"shortcut\",\"weak\"],\"string_or_number\",\"node\"],\"trace_function_info_fields\":[],"
+            "\"trace_node_fields\":[],\"sample_fields\":[],\"location_fields\":[]},\"node_count\":%u,"
+            "\"edge_count\":%llu,\"trace_function_count\":0},\"nodes\":[",
+            snapshot->nodeCount, (unsigned long long)snapshot->edgeCount + rootEdgeCount);
+    for (uint32_t i = 0; i < snapshot->nodeCount; ++i)
+    {
+        const struct HeapSnapshotNode *node = &snapshot->nodeList[i];
+        // 对象 id 为奇数，和 V8 一致
+        fprintf(file, "%s%u,%u,%llu,%zu,%u,0", i ? "," : "", node->type, node->name, (unsigned long long)i * 2 + 1,
+                node->selfSize, node->edgeCount);
+    }
+    fputs("],\"edges\":[", file);
+    heapSnapshotWriteRootEdges(snapshot, env, true, NULL);
+    for (uint32_t i = 0; i < snapshot->edgeCount; ++i)
+    {
+        const struct HeapSnapshotEdge *edge = &snapshot->edgeList[i];
+        heapSnapshotWriteEdge(snapshot, false, edge->type, edge->nameOrIndex, edge->to);
+    }
+    fputs("],\"trace_function_infos\":[],\"trace_tree\":[],\"samples\":[],\"locations\":[],\"strings\":[", file);
+    for (uint32_t i = 0; i < HEAP_SNAPSHOT_STRING_COUNT; ++i)
+    {
+        if (i)
+        {
+            fputc(',', file);
         }
-        *result = (NAPIValue)&returnHandle->value;
+        outputWriteString(file, heapSnapshotStringList[i]);
+    }
+    for (uint32_t i = 0; i < snapshot->atomCount; ++i)
+    {
+        const char *string = JS_AtomToCString(snapshot->context, snapshot->atomList[i]);
+        fputc(',', file);
+        outputWriteString(file, string ? string : "");
+        JS_FreeCString(snapshot->context, string);
+    }
+    JS_FreeValue(snapshot->context, JS_GetException(snapshot->context));
+    fputs("]}", file);
+}
+
+static void heapSnapshotFinalize(struct HeapSnapshot *snapshot)
+{
+    for (uint32_t i = 0; i < snapshot->atomCount; ++i)
+    {
+        JS_FreeAtom(snapshot->context, snapshot->atomList[i]);
+    }
+    free(snapshot->nodeList);
+    free(snapshot->edgeList);
+    free(snapshot->atomList);
+    free(snapshot->nodeMap.keyList);
+    free(snapshot->nodeMap.valueList);
+    free(snapshot->atomMap.keyList);
+    free(snapshot->atomMap.valueList);
+}
+
+NAPIErrorStatus NAPIWriteHeapSnapshot(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+
+    struct HeapSnapshot snapshot;
+    memset(&snapshot, 0, sizeof(struct HeapSnapshot));
+    snapshot.context = env->context;
+    if (!heapSnapshotCollect(&snapshot))
+    {
+        heapSnapshotFinalize(&snapshot);
+
+        return NAPIErrorMemoryError;
+    }
+    snapshot.file = outputOpenFile(fd);
+    if (!snapshot.file)
+    {
+        heapSnapshotFinalize(&snapshot);
+
+        return NAPIErrorGenericFailure;
+    }
+    heapSnapshotWrite(&snapshot, env);
+    heapSnapshotFinalize(&snapshot);
+    RETURN_STATUS_IF_FALSE(outputCloseFile(snapshot.file), NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIStartProfiling(NAPIEnv env, uint32_t sampleIntervalUs)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(!env->runtime->profilingEnv, NAPIErrorGenericFailure)
+
+    env->runtime->profileAtomTable = calloc(1, sizeof(struct ProfileAtomTable));
+    RETURN_STATUS_IF_FALSE(env->runtime->profileAtomTable, NAPIErrorMemoryError)
+    env->runtime->cpuProfile = cpuProfileCreate(sampleIntervalUs);
+    if (!env->runtime->cpuProfile)
+    {
+        free(env->runtime->profileAtomTable);
+        env->runtime->profileAtomTable = NULL;
+
+        return NAPIErrorMemoryError;
+    }
+    env->runtime->profilingEnv = env;
+    updateInterruptHandler(env->runtime);
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIStopProfiling(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+    RETURN_STATUS_IF_FALSE(env->runtime->profilingEnv == env, NAPIErrorInvalidArg)
+
+    struct CPUProfile *profile = stopProfiling(env);
+    bool isWritten = cpuProfileWrite(profile, fd);
+    cpuProfileFree(profile);
+    RETURN_STATUS_IF_FALSE(isWritten, NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPISetInterruptHandler(NAPIRuntime runtime, NAPIInterruptHandler handler, void *data)
+{
+    CHECK_ARG(runtime, Error)
+
+    runtime->interruptHandler = handler;
+    runtime->interruptData = handler ? data : NULL;
+    updateInterruptHandler(runtime);
+
+    return NAPIErrorOK;
+}
+
+NAPIErrorStatus NAPIStartTracing(NAPIEnv env, uint32_t capacity)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(!env->trace, NAPIErrorGenericFailure)
+
+    env->trace = traceCreate(capacity);
+    RETURN_STATUS_IF_FALSE(env->trace, NAPIErrorMemoryError)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIStopTracing(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    traceFree(env->trace);
+    env->trace = NULL;
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIFlushTrace(NAPIEnv env, int fd)
+{
+    CHECK_ARG(env, Error)
+    RETURN_STATUS_IF_FALSE(fd >= 0, NAPIErrorInvalidArg)
+    RETURN_STATUS_IF_FALSE(env->trace, NAPIErrorInvalidArg)
+
+    RETURN_STATUS_IF_FALSE(traceWrite(env->trace, fd), NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIBeginTraceSpan(NAPIEnv env, const char *name)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(name, Common)
+
+    traceBeginSpan(env->trace, name);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIEndTraceSpan(NAPIEnv env)
+{
+    CHECK_ARG(env, Common)
+
+    traceEndSpan(env->trace);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIFreeRuntime(NAPIRuntime runtime)
+{
+    CHECK_ARG(runtime, Common)
+
+    JS_FreeRuntime(runtime->runtime);
+    // JS_FreeRuntime 中 External 的 finalizer 仍会扣除
+    externalMemoryRelease(runtime->externalMemory);
+    codeCacheFree(runtime->codeCache);
+
+    return NAPICommonOK;
+}
+
+NAPIErrorStatus NAPIGetValueStringUTF8(NAPIEnv env, NAPIValue value, const char **result)
+{
+
+    CHECK_ARG(env, Error)
+    CHECK_ARG(value, Error)
+    CHECK_ARG(result, Error)
+
+    RETURN_STATUS_IF_FALSE(JS_IsString(*((JSValue *)value)), NAPIErrorStringExpected);
+
+    *result = JS_ToCString(env->context, *((JSValue *)value));
+
+    return NAPIErrorOK;
+}
+
+NAPICommonStatus NAPIFreeUTF8String(NAPIEnv env, const char *cString)
+{
+
+    CHECK_ARG(env, Common)
+
+    JS_FreeCString(env->context, cString);
+
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIEnableDebugger(__attribute__((unused)) NAPIEnv env,
+                                    __attribute__((unused)) const char *debuggerTitle,
+                                    __attribute__((unused)) bool waitForDebugger)
+{
+    return NAPICommonOK;
+}
+
+NAPICommonStatus NAPIDisableDebugger(__attribute__((unused)) NAPIEnv env)
+{
+    return NAPICommonOK;
+}
+NAPICommonStatus NAPISetMessageQueueThread(__attribute__((unused)) NAPIEnv env,
+                                           __attribute__((unused)) MessageQueueThreadWrapper jsQueueWrapper)
+{
+    return NAPICommonOK;
+}
+
+// 复制到 malloc 内存，和 NAPICompileScriptAsync 统一使用 free 释放，不计入 JSRuntime 的内存统计
+static uint8_t *writeByteBuffer(JSContext *context, JSValue functionValue, size_t *bufferSize)
+{
+    size_t size;
+    uint8_t *buffer = JS_WriteObject(context, &size, functionValue, JS_WRITE_OBJ_BYTECODE);
+    if (!buffer)
+    {
+        return NULL;
+    }
+    uint8_t *byteBuffer = malloc(size);
+    if (byteBuffer)
+    {
+        memcpy(byteBuffer, buffer, size);
+        *bufferSize = size;
     }
     else
     {
-        JS_FreeValue(env->context, returnValue);
+        JS_ThrowOutOfMemory(context);
+    }
+    js_free(context, buffer);
+
+    return byteBuffer;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBuffer(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                        const uint8_t **byteBuffer, size_t *bufferSize)
+{
+    return NAPICompileToByteBufferWithOptions(env, script, sourceUrl, NULL, byteBuffer, bufferSize);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileToByteBufferWithOptions(NAPIEnv env, const char *script,
+                                                                   const char *sourceUrl,
+                                                                   const NAPICompileOptions *options,
+                                                                   const uint8_t **byteBuffer, size_t *bufferSize)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
+    CHECK_ARG(bufferSize, Exception)
+    RETURN_STATUS_IF_FALSE(!options || (options->version && options->version <= NAPI_COMPILE_OPTIONS_VERSION),
+                           NAPIExceptionInvalidArg)
+
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    int evalFlags = JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL;
+    // 等同于 "use strip"，嵌套函数继承，不保留文件名、行号表和源码
+    if (options && options->stripDebugInfo)
+    {
+        evalFlags |= JS_EVAL_FLAG_STRIP;
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    JSValue returnValue = JS_Eval(env->context, script, strlen(script), sourceUrl, evalFlags);
+    if (JS_IsException(returnValue))
+    {
+        goto exceptionHandler;
+    }
+    *byteBuffer = writeByteBuffer(env->context, returnValue, bufferSize);
+    JS_FreeValue(env->context, returnValue);
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "NAPICompileToByteBuffer", sourceUrl, traceBeginTime);
+    if (!*byteBuffer)
+    {
+        goto exceptionHandler;
     }
 
     return NAPIExceptionOK;
@@ -2024,11 +3275,44 @@ exceptionHandler : {
         JS_Throw(env->context, exceptionValue);
     }
 }
+
     return NAPIExceptionPendingException;
+}
 
-exceptionHandlerWithProcess : {
+NAPI_EXPORT NAPICommonStatus NAPIFreeByteBuffer(NAPIEnv env, const uint8_t *byteBuffer)
+{
+    CHECK_ARG(env, Common)
+
+    free((void *)byteBuffer);
+
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBuffer(NAPIEnv env, const uint8_t *byteBuffer, size_t bufferSize,
+                                                  NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(byteBuffer, Exception)
+    CHECK_ARG(bufferSize, Exception)
+
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(bytecode_start, env, bufferSize);
+    JSValue functionValue = JS_ReadObject(env->context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE);
+    if (JS_IsException(functionValue))
+    {
+        NAPI_USDT_PROBE1(bytecode_done, env);
+
+        goto exceptionHandler;
+    }
+
+    JSValue returnValue = JS_EvalFunction(env->context, functionValue);
+    NAPI_USDT_PROBE1(bytecode_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunByteBuffer", NULL, traceBeginTime);
+
+    return setEvalResult(env, returnValue, result);
+
+exceptionHandler : {
     JSValue exceptionValue = JS_GetException(env->context);
-    processPendingTask(env);
     if (JS_IsNull(exceptionValue))
     {
         env->isThrowNull = true;
@@ -2040,4 +3324,522 @@ exceptionHandlerWithProcess : {
 }
 
     return NAPIExceptionPendingException;
-}
\ No newline at end of file
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunByteBufferFromFile(NAPIEnv env, const char *path, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(path, Exception)
+
+    struct MappedFile mappedFile;
+    RETURN_STATUS_IF_FALSE(mappedFileOpen(path, false, &mappedFile), NAPIExceptionGenericFailure)
+    // JS_ReadObject 会复制全部内容，执行后即可解除映射，相比读入内存只节省一份文件大小的临时内存
+    NAPIExceptionStatus status = NAPIRunByteBuffer(env, mappedFile.data, mappedFile.size, result);
+    mappedFileClose(&mappedFile);
+
+    return status;
+}
+
+// 磁盘缓存和字节码归档使用，big_number 会改变字节码格式
+#ifdef CONFIG_BIGNUM
+#define BYTECODE_ENGINE_VERSION "QuickJS " CONFIG_VERSION " bignum"
+#else
+#define BYTECODE_ENGINE_VERSION "QuickJS " CONFIG_VERSION
+#endif
+
+NAPI_EXPORT NAPIErrorStatus NAPISetCodeCacheDirectory(NAPIRuntime runtime, const char *directory, size_t maxSize)
+{
+    CHECK_ARG(runtime, Error)
+
+    struct CodeCache *codeCache = NULL;
+    if (directory)
+    {
+        codeCache = codeCacheCreate(directory, BYTECODE_ENGINE_VERSION, maxSize);
+        RETURN_STATUS_IF_FALSE(codeCache, NAPIErrorGenericFailure)
+    }
+    codeCacheFree(runtime->codeCache);
+    runtime->codeCache = codeCache;
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPICompileScript(NAPIEnv env, const char *script, size_t length, const char *sourceUrl,
+                                                  NAPIScript *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+    CHECK_ARG(result, Exception)
+
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    struct OpaqueNAPIScript *compiledScript = malloc(sizeof(struct OpaqueNAPIScript));
+    RETURN_STATUS_IF_FALSE(compiledScript, NAPIExceptionMemoryError)
+    compiledScript->sourceUrl = strdup(sourceUrl);
+    if (!compiledScript->sourceUrl)
+    {
+        free(compiledScript);
+
+        return NAPIExceptionMemoryError;
+    }
+    // JS_Eval 要求 input[length] 为 \0，指定长度时需要复制
+    char *copiedScript = NULL;
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        length = strlen(script);
+    }
+    else
+    {
+        copiedScript = malloc(length + 1);
+        if (!copiedScript)
+        {
+            free(compiledScript->sourceUrl);
+            free(compiledScript);
+
+            return NAPIExceptionMemoryError;
+        }
+        memcpy(copiedScript, script, length);
+        copiedScript[length] = '\0';
+        script = copiedScript;
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    JSValue functionValue =
+        JS_Eval(env->context, script, length, sourceUrl, JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL);
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "NAPICompileScript", sourceUrl, traceBeginTime);
+    free(copiedScript);
+    if (JS_IsException(functionValue))
+    {
+        free(compiledScript->sourceUrl);
+        free(compiledScript);
+        JSValue exceptionValue = JS_GetException(env->context);
+        if (JS_IsNull(exceptionValue))
+        {
+            env->isThrowNull = true;
+        }
+        else
+        {
+            JS_Throw(env->context, exceptionValue);
+        }
+
+        return NAPIExceptionPendingException;
+    }
+    compiledScript->functionValue = functionValue;
+    compiledScript->env = env;
+    *result = compiledScript;
+
+    return NAPIExceptionOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunCompiledScript(NAPIEnv env, NAPIScript script, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+    // 函数字节码属于编译时的 JSContext
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPIExceptionInvalidArg)
+
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, script->sourceUrl);
+    JSValue returnValue = JS_EvalFunction(env->context, JS_DupValue(env->context, script->functionValue));
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunCompiledScript", script->sourceUrl, traceBeginTime);
+
+    return setEvalResult(env, returnValue, result);
+}
+
+NAPI_EXPORT NAPICommonStatus NAPIFreeScript(NAPIEnv env, NAPIScript script)
+{
+    CHECK_ARG(env, Common)
+    CHECK_ARG(script, Common)
+    RETURN_STATUS_IF_FALSE(script->env == env, NAPICommonInvalidArg)
+
+    JS_FreeValue(env->context, script->functionValue);
+    free(script->sourceUrl);
+    free(script);
+
+    return NAPICommonOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithOptions(NAPIEnv env, const char *script, const char *sourceUrl,
+                                                         const NAPIRunScriptOptions *options, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    RETURN_STATUS_IF_FALSE(!options || (options->version && options->version <= NAPI_RUN_SCRIPT_OPTIONS_VERSION),
+                           NAPIExceptionInvalidArg)
+
+    if (!script)
+    {
+        script = "";
+    }
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    // QuickJS 总是全量编译，只有 strict 生效
+    int evalFlags = JS_EVAL_TYPE_GLOBAL;
+    if (options && options->strict)
+    {
+        evalFlags |= JS_EVAL_FLAG_STRICT;
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    JSValue returnValue = evalScript(env, script, strlen(script), sourceUrl, evalFlags);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScriptWithOptions", sourceUrl, traceBeginTime);
+
+    return setEvalResult(env, returnValue, result);
+}
+
+struct CompileTask
+{
+    char *script;                 // size_t
+    size_t length;                // size_t
+    char *sourceUrl;              // size_t
+    NAPICompileCallback callback; // size_t
+    void *data;                   // size_t
+};
+
+static void freeCompileTask(struct CompileTask *task)
+{
+    free(task->script);
+    free(task->sourceUrl);
+    free(task);
+}
+
+// 线程池线程执行，每个任务使用独立的 JSRuntime，和 env 没有共享状态
+static void compileTask(void *data)
+{
+    struct CompileTask *task = data;
+    JSRuntime *runtime = JS_NewRuntime();
+    // 正则字面量在编译期需要 RegExp 编译器，直接使用完整的 intrinsic
+    JSContext *context = runtime ? JS_NewContext(runtime) : NULL;
+    if (!context)
+    {
+        task->callback(NULL, 0, NULL, task->data);
+        if (runtime)
+        {
+            JS_FreeRuntime(runtime);
+        }
+        freeCompileTask(task);
+
+        return;
+    }
+    // 栈顶在 JS_NewRuntime 时记录为当前线程，上限需要小于 THREAD_POOL_STACK_SIZE
+    JS_SetMaxStackSize(runtime, 4 * JS_DEFAULT_STACK_SIZE);
+    uint8_t *byteBuffer = NULL;
+    size_t bufferSize = 0;
+    JSValue functionValue = JS_Eval(context, task->script, task->length, task->sourceUrl,
+                                    JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_GLOBAL);
+    if (!JS_IsException(functionValue))
+    {
+        byteBuffer = writeByteBuffer(context, functionValue, &bufferSize);
+        JS_FreeValue(context, functionValue);
+    }
+    if (byteBuffer)
+    {
+        task->callback(byteBuffer, bufferSize, NULL, task->data);
+    }
+    else
+    {
+        JSValue exceptionValue = JS_GetException(context);
+        const char *errorMessage = JS_ToCString(context, exceptionValue);
+        task->callback(NULL, 0, errorMessage, task->data);
+        JS_FreeCString(context, errorMessage);
+        JS_FreeValue(context, exceptionValue);
+    }
+    JS_FreeContext(context);
+    JS_FreeRuntime(runtime);
+    freeCompileTask(task);
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPICompileScriptAsync(NAPIRuntime runtime, const char *script, size_t length,
+                                                   const char *sourceUrl, NAPICompileCallback callback, void *data)
+{
+    CHECK_ARG(runtime, Error)
+    CHECK_ARG(script, Error)
+    CHECK_ARG(callback, Error)
+
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        length = strlen(script);
+    }
+    struct CompileTask *task = malloc(sizeof(struct CompileTask));
+    RETURN_STATUS_IF_FALSE(task, NAPIErrorMemoryError)
+    // JS_Eval 要求源码以 \0 结尾
+    task->script = malloc(length + 1);
+    task->length = length;
+    task->sourceUrl = strdup(sourceUrl ? sourceUrl : "");
+    task->callback = callback;
+    task->data = data;
+    if (!task->script || !task->sourceUrl)
+    {
+        freeCompileTask(task);
+
+        return NAPIErrorMemoryError;
+    }
+    memcpy(task->script, script, length);
+    task->script[length] = '\0';
+    if (!threadPoolSubmit(compileTask, task))
+    {
+        freeCompileTask(task);
+
+        return NAPIErrorGenericFailure;
+    }
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptWithLength(NAPIEnv env, const char *script, size_t length,
+                                                        const char *sourceUrl, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(script, Exception)
+
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    // JS_Eval 要求 input[length] 为 \0，指定长度时需要复制
+    char *copiedScript = NULL;
+    if (length == NAPI_AUTO_LENGTH)
+    {
+        length = strlen(script);
+    }
+    else
+    {
+        copiedScript = scriptSourceJoin(&script, &length, 1, &length);
+        RETURN_STATUS_IF_FALSE(copiedScript, NAPIExceptionMemoryError)
+        script = copiedScript;
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    JSValue returnValue = evalScript(env, script, length, sourceUrl, JS_EVAL_TYPE_GLOBAL);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScriptWithLength", sourceUrl, traceBeginTime);
+    free(copiedScript);
+
+    return setEvalResult(env, returnValue, result);
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunScriptChunks(NAPIEnv env, const char *const *chunks, const size_t *lengths,
+                                                    size_t chunkCount, const char *sourceUrl, NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    RETURN_STATUS_IF_FALSE(chunks || !chunkCount, NAPIExceptionInvalidArg)
+
+    if (!sourceUrl)
+    {
+        sourceUrl = "";
+    }
+    size_t length;
+    char *script = scriptSourceJoin(chunks, lengths, chunkCount, &length);
+    RETURN_STATUS_IF_FALSE(script, NAPIExceptionMemoryError)
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, sourceUrl);
+    JSValue returnValue = evalScript(env, script, length, sourceUrl, JS_EVAL_TYPE_GLOBAL);
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunScriptChunks", sourceUrl, traceBeginTime);
+    free(script);
+
+    return setEvalResult(env, returnValue, result);
+}
+
+// 返回值需要使用 js_malloc 分配
+static char *normalizeModuleName(JSContext *ctx, const char *referrer, const char *specifier,
+                                 __attribute__((unused)) void *opaque)
+{
+    NAPIEnv env = JS_GetContextOpaque(ctx);
+    if (!env->moduleResolveCallback)
+    {
+        return js_strdup(ctx, specifier);
+    }
+    char *resolvedName = env->moduleResolveCallback(referrer, specifier, env->moduleLoaderData);
+    if (!resolvedName)
+    {
+        JS_ThrowReferenceError(ctx, "could not resolve module '%s' from '%s'", specifier, referrer);
+
+        return NULL;
+    }
+    char *moduleName = js_strdup(ctx, resolvedName);
+    free(resolvedName);
+
+    return moduleName;
+}
+
+// 返回的模块已经解析全部依赖
+static JSValue compileModule(NAPIEnv env, const char *script, size_t scriptLength, const char *moduleName)
+{
+    JSValue moduleValue =
+        env->runtime->codeCache
+            ? compileWithCodeCache(env, script, scriptLength, moduleName, JS_EVAL_TYPE_MODULE)
+            : JS_Eval(env->context, script, scriptLength, moduleName, JS_EVAL_FLAG_COMPILE_ONLY | JS_EVAL_TYPE_MODULE);
+    // 从字节码读取的模块还没有解析依赖，源码编译的模块已经解析，重复调用直接返回
+    if (!JS_IsException(moduleValue) && JS_ResolveModule(env->context, moduleValue) < 0)
+    {
+        JS_FreeValue(env->context, moduleValue);
+
+        return JS_EXCEPTION;
+    }
+
+    return moduleValue;
+}
+
+// 模块缓存未命中时由 QuickJS 调用，模块缓存即 JSContext 的已加载模块列表，key 为 normalizeModuleName 的结果
+static JSModuleDef *loadModule(JSContext *ctx, const char *moduleName, __attribute__((unused)) void *opaque)
+{
+    NAPIEnv env = JS_GetContextOpaque(ctx);
+    char *script = env->moduleLoadCallback ? env->moduleLoadCallback(moduleName, env->moduleLoaderData) : NULL;
+    if (!script)
+    {
+        JS_ThrowReferenceError(ctx, "could not load module '%s'", moduleName);
+
+        return NULL;
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    JSValue moduleValue = compileModule(env, script, strlen(script), moduleName);
+    traceAddEvent(env->trace, TRACE_CATEGORY_COMPILE, "loadModule", moduleName, traceBeginTime);
+    free(script);
+    if (JS_IsException(moduleValue))
+    {
+        return NULL;
+    }
+    // 模块由 JSContext 持有
+    JSModuleDef *module = JS_VALUE_GET_PTR(moduleValue);
+    JS_FreeValue(ctx, moduleValue);
+
+    return module;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPISetModuleLoader(NAPIEnv env, NAPIModuleResolveCallback resolveCallback,
+                                                NAPIModuleLoadCallback loadCallback, void *data)
+{
+    CHECK_ARG(env, Error)
+
+    env->moduleResolveCallback = resolveCallback;
+    env->moduleLoadCallback = loadCallback;
+    env->moduleLoaderData = data;
+    // 同一 runtime 的全部 env 共用，按 context opaque 分发，没有设置回调的 env 加载模块时抛出 ReferenceError
+    JS_SetModuleLoaderFunc(env->runtime->runtime, normalizeModuleName, loadModule, NULL);
+
+    return NAPIErrorOK;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunModule(NAPIEnv env, const char *script, const char *moduleName,
+                                              NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+
+    if (!script)
+    {
+        script = "";
+    }
+    if (!moduleName)
+    {
+        moduleName = "";
+    }
+    uint64_t traceBeginTime = traceGetTimestamp(env->trace);
+    NAPI_USDT_PROBE2(script_start, env, moduleName);
+    JSValue returnValue = compileModule(env, script, strlen(script), moduleName);
+    if (!JS_IsException(returnValue))
+    {
+        returnValue = JS_EvalFunction(env->context, returnValue);
+    }
+    NAPI_USDT_PROBE1(script_done, env);
+    traceAddEvent(env->trace, TRACE_CATEGORY_SCRIPT, "NAPIRunModule", moduleName, traceBeginTime);
+
+    return setEvalResult(env, returnValue, result);
+}
+
+const char *bytecodeArchiveGetEngineVersion(void)
+{
+    return BYTECODE_ENGINE_VERSION;
+}
+
+NAPI_EXPORT NAPIExceptionStatus NAPIRunArchiveModule(NAPIEnv env, NAPIArchive archive, const char *moduleName,
+                                                     NAPIValue *result)
+{
+    NAPI_PREAMBLE(env)
+    CHECK_ARG(archive, Exception)
+    CHECK_ARG(moduleName, Exception)
+
+    struct BytecodeArchive *bytecodeArchive = (struct BytecodeArchive *)archive;
+    uint32_t moduleIndex;
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveFindModule(bytecodeArchive, moduleName, &moduleIndex),
+                           NAPIExceptionGenericFailure)
+    if (!env->archiveResultCache)
+    {
+        env->archiveResultCache = bytecodeArchiveResultCacheCreate();
+        RETURN_STATUS_IF_FALSE(env->archiveResultCache, NAPIExceptionMemoryError)
+    }
+    NAPIRef reference = bytecodeArchiveResultCacheGet(env->archiveResultCache, bytecodeArchive, moduleIndex);
+    if (reference)
+    {
+        return result ? napi_get_reference_value(env, reference, result) : NAPIExceptionOK;
+    }
+    const uint8_t *byteBuffer;
+    size_t bufferSize;
+    RETURN_STATUS_IF_FALSE(bytecodeArchiveLoadModule(bytecodeArchive, moduleIndex, &byteBuffer, &bufferSize),
+                           NAPIExceptionGenericFailure)
+
+    // JS_ReadObject 复制全部内容，执行后不再引用映射；抛出异常时不缓存，下次调用重新执行
+    NAPIValue returnValue;
+    CHECK_NAPI(NAPIRunByteBuffer(env, byteBuffer, bufferSize, &returnValue), Exception, Exception)
+    CHECK_NAPI(napi_create_reference(env, returnValue, 1, &reference), Exception, Exception)
+    if (!bytecodeArchiveResultCacheSet(env->archiveResultCache, bytecodeArchive, moduleIndex, reference))
+    {
+        napi_delete_reference(env, reference);
+
+        return NAPIExceptionMemoryError;
+    }
+    if (result)
+    {
+        *result = returnValue;
+    }
+
+    return NAPIExceptionOK;
+}
+
+static size_t getMemoryUsageDelta(int64_t before, int64_t after)
+{
+    return after > before ? (size_t)(after - before) : 0;
+}
+
+NAPI_EXPORT NAPIErrorStatus NAPIGetBytecodeStats(const uint8_t *byteBuffer, size_t bufferSize,
+                                                 NAPIBytecodeStats *result)
+{
+    CHECK_ARG(byteBuffer, Error)
+    CHECK_ARG(result, Error)
+
+    // 使用独立的 JSRuntime，env 中已有的 atom 和 GC 不影响差值
+    JSRuntime *runtime = JS_NewRuntime();
+    RETURN_STATUS_IF_FALSE(runtime, NAPIErrorMemoryError)
+    // 模板字符串常量反序列化时需要 Array 原型
+    JSContext *context = JS_NewContext(runtime);
+    if (!context)
+    {
+        JS_FreeRuntime(runtime);
+
+        return NAPIErrorMemoryError;
+    }
+    JSMemoryUsage before;
+    JS_ComputeMemoryUsage(runtime, &before);
+    JSValue functionValue = JS_ReadObject(context, byteBuffer, bufferSize, JS_READ_OBJ_BYTECODE);
+    bool isRead = !JS_IsException(functionValue);
+    if (isRead)
+    {
+        JSMemoryUsage after;
+        JS_ComputeMemoryUsage(runtime, &after);
+        result->totalSize = bufferSize;
+        result->functionCount = getMemoryUsageDelta(before.js_func_count, after.js_func_count);
+        result->codeSize = getMemoryUsageDelta(before.js_func_code_size, after.js_func_code_size);
+        result->constantSize = getMemoryUsageDelta(before.str_size, after.str_size);
+        result->atomSize = getMemoryUsageDelta(before.atom_size, after.atom_size);
+        result->debugInfoSize = getMemoryUsageDelta(before.js_func_pc2line_size, after.js_func_pc2line_size);
+        JS_FreeValue(context, functionValue);
+    }
+    JS_FreeContext(context);
+    JS_FreeRuntime(runtime);
+    RETURN_STATUS_IF_FALSE(isRead, NAPIErrorGenericFailure)
+
+    return NAPIErrorOK;
+}
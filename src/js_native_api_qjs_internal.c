@@ -0,0 +1,314 @@
+#include "js_native_api_qjs_internal.h"
+
+// QuickJS 没有公开的堆遍历和栈遍历 API，这里包含 quickjs.c 以访问 JSRuntime 的 GC 对象链表、栈帧和属性存储，
+// BUILD.gn 编译本文件代替 quickjs.c
+#include "quickjs.c"
+
+struct HeapWalkState
+{
+    HeapWalkEdgeCallback edgeCallback; // size_t
+    void *data;                        // size_t
+    bool isOK;                         // bool
+};
+
+// JS_MarkFunc 没有用户数据参数，遍历期间不会执行 JS，也不会重入，使用线程局部变量传递
+static _Thread_local struct HeapWalkState *heapWalkState;
+
+static void heapWalkReportEdge(struct HeapWalkState *state, enum HeapWalkEdgeKind kind, JSAtom name, uint32_t index,
+                               const void *to)
+{
+    if (state->isOK && to)
+    {
+        state->isOK = state->edgeCallback(state->data, kind, name, index, to);
+    }
+}
+
+// 和 JS_MarkValue 一致，只有对象和函数字节码是 GC 对象
+static void heapWalkReportValue(struct HeapWalkState *state, enum HeapWalkEdgeKind kind, JSAtom name, uint32_t index,
+                                JSValueConst value)
+{
+    int tag = JS_VALUE_GET_TAG(value);
+    if (tag == JS_TAG_OBJECT || tag == JS_TAG_FUNCTION_BYTECODE)
+    {
+        heapWalkReportEdge(state, kind, name, index, JS_VALUE_GET_PTR(value));
+    }
+}
+
+// class gc_mark 和 mark_children 报告的引用没有名称
+static void heapWalkMarkFunc(__attribute__((unused)) JSRuntime *rt, JSGCObjectHeader *gp)
+{
+    heapWalkReportEdge(heapWalkState, HEAP_WALK_EDGE_INTERNAL, JS_ATOM_NULL, 0, gp);
+}
+
+// 平台不支持 malloc_usable_size 时为 0，使用结构体大小
+static size_t heapWalkGetAllocSize(JSRuntime *rt, const void *ptr, size_t defaultSize)
+{
+    if (!ptr)
+    {
+        return 0;
+    }
+    size_t size = js_malloc_usable_size_rt(rt, ptr);
+
+    return size ? size : defaultSize;
+}
+
+static JSAtom heapWalkGetFunctionName(JSObject *p)
+{
+    JSFunctionBytecode *b = p->u.func.function_bytecode;
+    if (!b || b->func_name == JS_ATOM_empty_string)
+    {
+        return JS_ATOM_NULL;
+    }
+
+    return b->func_name;
+}
+
+// 原型自身 constructor 数据属性指向的字节码函数名，原生构造函数和访问器返回 JS_ATOM_NULL
+static JSAtom heapWalkGetConstructorName(JSObject *p)
+{
+    JSObject *proto = p->shape->proto;
+    if (!proto)
+    {
+        return JS_ATOM_NULL;
+    }
+    JSProperty *pr;
+    JSShapeProperty *prs = find_own_property(&pr, proto, JS_ATOM_constructor);
+    if (!prs || (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL || JS_VALUE_GET_TAG(pr->u.value) != JS_TAG_OBJECT)
+    {
+        return JS_ATOM_NULL;
+    }
+    JSObject *constructor = JS_VALUE_GET_OBJ(pr->u.value);
+
+    return js_class_has_bytecode(constructor->class_id) ? heapWalkGetFunctionName(constructor) : JS_ATOM_NULL;
+}
+
+static bool heapWalkIsFastArray(JSObject *p)
+{
+    return (p->class_id == JS_CLASS_ARRAY || p->class_id == JS_CLASS_ARGUMENTS) && p->fast_array;
+}
+
+static void heapWalkInitObjectNode(JSRuntime *rt, JSObject *p, struct HeapWalkNode *node)
+{
+    JSClassID classId = p->class_id;
+    node->kind = HEAP_WALK_NODE_OBJECT;
+    node->name = rt->class_array[classId].class_name;
+    if (js_class_has_bytecode(classId))
+    {
+        node->kind = HEAP_WALK_NODE_FUNCTION;
+        node->name = heapWalkGetFunctionName(p);
+    }
+    else if (classId != JS_CLASS_PROXY && rt->class_array[classId].call)
+    {
+        // 原生函数的名称在 name 属性中，字符串不是 atom，使用 class 名
+        node->kind = HEAP_WALK_NODE_FUNCTION;
+    }
+    else if (classId == JS_CLASS_ARRAY)
+    {
+        node->kind = HEAP_WALK_NODE_ARRAY;
+    }
+    else if (classId == JS_CLASS_OBJECT)
+    {
+        JSAtom name = heapWalkGetConstructorName(p);
+        if (name != JS_ATOM_NULL)
+        {
+            node->name = name;
+        }
+    }
+    node->selfSize = heapWalkGetAllocSize(rt, p, sizeof(JSObject)) +
+                     heapWalkGetAllocSize(rt, p->prop, sizeof(JSProperty) * p->shape->prop_size);
+    if (heapWalkIsFastArray(p))
+    {
+        node->selfSize += heapWalkGetAllocSize(rt, p->u.array.u.values, sizeof(JSValue) * p->u.array.u1.size);
+    }
+    else if ((classId == JS_CLASS_ARRAY_BUFFER || classId == JS_CLASS_SHARED_ARRAY_BUFFER) && p->u.array_buffer)
+    {
+        node->selfSize += heapWalkGetAllocSize(rt, p->u.array_buffer, sizeof(JSArrayBuffer)) +
+                          (size_t)p->u.array_buffer->byte_length;
+    }
+}
+
+static void heapWalkInitNode(JSRuntime *rt, JSGCObjectHeader *gp, struct HeapWalkNode *node)
+{
+    node->id = gp;
+    node->name = JS_ATOM_NULL;
+    switch (gp->gc_obj_type)
+    {
+    case JS_GC_OBJ_TYPE_JS_OBJECT:
+        heapWalkInitObjectNode(rt, (JSObject *)gp, node);
+        break;
+    case JS_GC_OBJ_TYPE_FUNCTION_BYTECODE: {
+        // 字节码、常量池和变量表在同一次分配中
+        JSFunctionBytecode *b = (JSFunctionBytecode *)gp;
+        node->kind = HEAP_WALK_NODE_BYTECODE;
+        node->name = b->func_name == JS_ATOM_empty_string ? JS_ATOM_NULL : b->func_name;
+        node->selfSize = heapWalkGetAllocSize(rt, b, sizeof(JSFunctionBytecode));
+        break;
+    }
+    case JS_GC_OBJ_TYPE_SHAPE: {
+        // 哈希表在 JSShape 之前，和属性表在同一次分配中
+        JSShape *sh = (JSShape *)gp;
+        node->kind = HEAP_WALK_NODE_SHAPE;
+        node->selfSize =
+            heapWalkGetAllocSize(rt, get_alloc_from_shape(sh), get_shape_size(sh->prop_hash_mask + 1, sh->prop_size));
+        break;
+    }
+    case JS_GC_OBJ_TYPE_VAR_REF:
+        node->kind = HEAP_WALK_NODE_VAR_REF;
+        node->selfSize = heapWalkGetAllocSize(rt, gp, sizeof(JSVarRef));
+        break;
+    case JS_GC_OBJ_TYPE_ASYNC_FUNCTION:
+        node->kind = HEAP_WALK_NODE_ASYNC_FUNCTION;
+        node->selfSize = heapWalkGetAllocSize(rt, gp, sizeof(JSAsyncFunctionData));
+        break;
+    default:
+        node->kind = HEAP_WALK_NODE_CONTEXT;
+        node->selfSize = heapWalkGetAllocSize(rt, gp, sizeof(JSContext));
+        break;
+    }
+}
+
+// 属性直接读取 shape 和 p->prop，访问器只报告 getter/setter 函数对象，其余引用交给 class gc_mark
+static void heapWalkReportObjectEdges(JSRuntime *rt, struct HeapWalkState *state, JSObject *p)
+{
+    JSShape *sh = p->shape;
+    heapWalkReportEdge(state, HEAP_WALK_EDGE_INTERNAL, JS_ATOM_NULL, 0, sh);
+    heapWalkReportEdge(state, HEAP_WALK_EDGE_INTERNAL, JS_ATOM___proto__, 0, sh->proto);
+    JSShapeProperty *prs = get_shape_prop(sh);
+    for (uint32_t i = 0; i < (uint32_t)sh->prop_count; ++i, ++prs)
+    {
+        // 已删除的属性
+        if (prs->atom == JS_ATOM_NULL)
+        {
+            continue;
+        }
+        JSProperty *pr = &p->prop[i];
+        enum HeapWalkEdgeKind kind = HEAP_WALK_EDGE_PROPERTY;
+        JSAtom name = prs->atom;
+        uint32_t index = 0;
+        if (__JS_AtomIsTaggedInt(prs->atom))
+        {
+            kind = HEAP_WALK_EDGE_ELEMENT;
+            name = JS_ATOM_NULL;
+            index = __JS_AtomToUInt32(prs->atom);
+        }
+        switch (prs->flags & JS_PROP_TMASK)
+        {
+        case JS_PROP_GETSET:
+            heapWalkReportEdge(state, HEAP_WALK_EDGE_INTERNAL, prs->atom, 0, pr->u.getset.getter);
+            heapWalkReportEdge(state, HEAP_WALK_EDGE_INTERNAL, prs->atom, 0, pr->u.getset.setter);
+            break;
+        case JS_PROP_VARREF:
+            // 只有脱离栈帧的变量是 GC 对象
+            if (pr->u.var_ref->is_detached)
+            {
+                heapWalkReportEdge(state, kind, name, index, &pr->u.var_ref->header);
+            }
+            break;
+        case JS_PROP_AUTOINIT:
+            // 内置属性第一次访问时才创建，还没有值
+            break;
+        default:
+            heapWalkReportValue(state, kind, name, index, pr->u.value);
+            break;
+        }
+    }
+    if (heapWalkIsFastArray(p))
+    {
+        // 快速数组的 gc_mark 只遍历元素，这里带上下标
+        for (uint32_t i = 0; i < p->u.array.count; ++i)
+        {
+            heapWalkReportValue(state, HEAP_WALK_EDGE_ELEMENT, JS_ATOM_NULL, i, p->u.array.u.values[i]);
+        }
+    }
+    else
+    {
+        // Proxy 的 gc_mark 只报告 target 和 handler
+        JSClassGCMark *gcMark = rt->class_array[p->class_id].gc_mark;
+        if (gcMark)
+        {
+            gcMark(rt, JS_MKPTR(JS_TAG_OBJECT, p), heapWalkMarkFunc);
+        }
+    }
+}
+
+bool heapWalk(JSRuntime *runtime, HeapWalkNodeCallback nodeCallback, HeapWalkEdgeCallback edgeCallback, void *data)
+{
+    struct HeapWalkState state = {edgeCallback, data, true};
+    heapWalkState = &state;
+    struct list_head *el;
+    list_for_each(el, &runtime->gc_obj_list)
+    {
+        JSGCObjectHeader *gp = list_entry(el, JSGCObjectHeader, link);
+        struct HeapWalkNode node;
+        heapWalkInitNode(runtime, gp, &node);
+        state.isOK = nodeCallback(data, &node);
+        if (gp->gc_obj_type == JS_GC_OBJ_TYPE_JS_OBJECT)
+        {
+            heapWalkReportObjectEdges(runtime, &state, (JSObject *)gp);
+        }
+        else if (gp->gc_obj_type != JS_GC_OBJ_TYPE_SHAPE)
+        {
+            // shape 只引用原型，已经作为对象的 __proto__ 边报告
+            mark_children(runtime, gp, heapWalkMarkFunc);
+        }
+        if (!state.isOK)
+        {
+            break;
+        }
+    }
+    heapWalkState = NULL;
+
+    return state.isOK;
+}
+
+// 和 get_func_name 一致读取自身 name 数据属性，字符串不是 atom 时（比如运行时修改）返回 JS_ATOM_NULL
+static JSAtom stackWalkGetNativeFunctionName(JSRuntime *rt, JSObject *p)
+{
+    JSProperty *pr;
+    JSShapeProperty *prs = find_own_property(&pr, p, JS_ATOM_name);
+    if (!prs || (prs->flags & JS_PROP_TMASK) != JS_PROP_NORMAL || JS_VALUE_GET_TAG(pr->u.value) != JS_TAG_STRING)
+    {
+        return JS_ATOM_NULL;
+    }
+    JSString *string = JS_VALUE_GET_STRING(pr->u.value);
+    // JS_NewCFunction 的 name 属性由 atom 转换，本身就是 atom 字符串
+    if (string->atom_type != JS_ATOM_TYPE_STRING)
+    {
+        return JS_ATOM_NULL;
+    }
+
+    return js_get_atom_index(rt, string);
+}
+
+size_t stackWalk(JSContext *context, struct StackWalkFrame *frames, size_t maxFrameCount)
+{
+    JSRuntime *rt = context->rt;
+    size_t frameCount = 0;
+    for (JSStackFrame *sf = rt->current_stack_frame; sf && frameCount < maxFrameCount; sf = sf->prev_frame)
+    {
+        if (JS_VALUE_GET_TAG(sf->cur_func) != JS_TAG_OBJECT)
+        {
+            continue;
+        }
+        JSObject *p = JS_VALUE_GET_OBJ(sf->cur_func);
+        struct StackWalkFrame *frame = &frames[frameCount++];
+        frame->url = JS_ATOM_NULL;
+        frame->lineNumber = 0;
+        if (!js_class_has_bytecode(p->class_id))
+        {
+            frame->functionName = stackWalkGetNativeFunctionName(rt, p);
+            continue;
+        }
+        frame->functionName = heapWalkGetFunctionName(p);
+        JSFunctionBytecode *b = p->u.func.function_bytecode;
+        if (b->has_debug)
+        {
+            frame->url = b->debug.filename;
+            // 和 build_backtrace 一致，cur_pc 指向当前指令之后
+            frame->lineNumber = sf->cur_pc ? find_line_num(context, b, sf->cur_pc - b->byte_code_buf - 1)
+                                           : b->debug.line_num;
+        }
+    }
+
+    return frameCount;
+}
@@ -0,0 +1,71 @@
+#ifndef SRC_JS_NATIVE_API_QJS_INTERNAL_H_
+#define SRC_JS_NATIVE_API_QJS_INTERNAL_H_
+
+#include <quickjs.h>
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，访问 QuickJS 内部结构的堆遍历和栈遍历
+// 实现和 quickjs.c 编译为同一个翻译单元，见 BUILD.gn quickjs_source_set
+// 只读取引擎内部数据，不执行 getter、Proxy trap 等任何 JS 代码，也不分配 GC 对象，只能在 runtime 所在线程调用
+
+// 堆遍历只读取 GC 对象链表、shape 和属性存储，字符串等原始值不是 GC 对象，不会成为节点
+
+enum HeapWalkNodeKind
+{
+    HEAP_WALK_NODE_OBJECT,
+    HEAP_WALK_NODE_FUNCTION,
+    HEAP_WALK_NODE_ARRAY,
+    HEAP_WALK_NODE_BYTECODE,
+    HEAP_WALK_NODE_SHAPE,
+    HEAP_WALK_NODE_VAR_REF,
+    HEAP_WALK_NODE_ASYNC_FUNCTION,
+    HEAP_WALK_NODE_CONTEXT,
+};
+
+enum HeapWalkEdgeKind
+{
+    // 数组下标，使用 index
+    HEAP_WALK_EDGE_ELEMENT,
+    // 自身属性，使用 name
+    HEAP_WALK_EDGE_PROPERTY,
+    // 原型、访问器、shape 和引擎内部引用，name 可能为 JS_ATOM_NULL
+    HEAP_WALK_EDGE_INTERNAL,
+};
+
+struct HeapWalkNode
+{
+    // GC 对象地址，边的 to 使用相同的值
+    const void *id; // size_t
+    // malloc_usable_size 统计的自身分配大小，ArrayBuffer 包含数据，不包含引用的其他 GC 对象
+    size_t selfSize; // size_t
+    // 函数名、构造函数名或者 class 名，没有时为 JS_ATOM_NULL
+    JSAtom name;                // uint32_t
+    enum HeapWalkNodeKind kind; // uint32_t
+};
+
+// atom 只在回调期间有效，需要保存时 JS_DupAtom，返回 false 停止遍历
+typedef bool (*HeapWalkNodeCallback)(void *data, const struct HeapWalkNode *node);
+
+// 在所属节点的 HeapWalkNodeCallback 之后、下一个节点之前调用
+typedef bool (*HeapWalkEdgeCallback)(void *data, enum HeapWalkEdgeKind kind, JSAtom name, uint32_t index,
+                                     const void *to);
+
+// Proxy 等特殊对象只报告引擎内部引用（Proxy 为 target 和 handler），返回 false 代表回调停止了遍历
+bool heapWalk(JSRuntime *runtime, HeapWalkNodeCallback nodeCallback, HeapWalkEdgeCallback edgeCallback, void *data);
+
+struct StackWalkFrame
+{
+    // 没有名称时为 JS_ATOM_NULL，native 函数没有 url
+    JSAtom functionName; // uint32_t
+    JSAtom url;          // uint32_t
+    // 从 1 开始，native 函数和没有调试信息时为 0
+    int32_t lineNumber; // int32_t
+};
+
+// 读取 JSRuntime 的栈帧链表，不构造 Error，frames 从栈顶到栈底，返回栈帧数量，超出 maxFrameCount 的部分丢弃
+// atom 没有增加引用计数，只在当前栈帧存在期间有效，需要保存时 JS_DupAtom
+size_t stackWalk(JSContext *context, struct StackWalkFrame *frames, size_t maxFrameCount);
+
+#endif // SRC_JS_NATIVE_API_QJS_INTERNAL_H_
@@ -0,0 +1,133 @@
+#include "js_native_api_reference_table.h"
+
+#include <assert.h>
+#include <stdlib.h>
+
+#define REFERENCE_INDEX_MASK ((((uintptr_t)1) << REFERENCE_INDEX_BITS) - 1)
+
+#define REFERENCE_GENERATION_MASK ((uint32_t)(UINTPTR_MAX >> REFERENCE_INDEX_BITS))
+
+// generation 为奇数代表 slot 正在使用，分配和释放各自增一次
+struct ReferenceSlotHeader
+{
+    uint32_t generation;    // uint32_t
+    uint32_t nextFreeIndex; // uint32_t
+};
+
+// 块头部为 REFERENCE_CHUNK_SIZE 个 ReferenceSlotHeader，之后是引擎 slot 数组，偏移 512 字节满足 malloc 对齐
+#define REFERENCE_CHUNK_HEADER_SIZE (sizeof(struct ReferenceSlotHeader) * REFERENCE_CHUNK_SIZE)
+
+static inline struct ReferenceSlotHeader *getSlotHeader(const struct ReferenceTable *table, uint32_t index)
+{
+    return (struct ReferenceSlotHeader *)table->chunkList[index / REFERENCE_CHUNK_SIZE] + index % REFERENCE_CHUNK_SIZE;
+}
+
+static inline void *getSlot(const struct ReferenceTable *table, uint32_t index)
+{
+    return table->chunkList[index / REFERENCE_CHUNK_SIZE] + REFERENCE_CHUNK_HEADER_SIZE +
+           table->slotSize * (index % REFERENCE_CHUNK_SIZE);
+}
+
+void referenceTableInit(struct ReferenceTable *table, size_t slotSize)
+{
+    table->chunkList = NULL;
+    table->slotSize = slotSize;
+    table->chunkCount = 0;
+    table->slotCount = 0;
+    table->freeIndex = 0;
+}
+
+void referenceTableFinalize(struct ReferenceTable *table)
+{
+    for (uint32_t i = 0; i < table->chunkCount; ++i)
+    {
+        free(table->chunkList[i]);
+    }
+    free(table->chunkList);
+    referenceTableInit(table, table->slotSize);
+}
+
+void *referenceTableAlloc(struct ReferenceTable *table, NAPIRef *result)
+{
+    uint32_t index;
+    struct ReferenceSlotHeader *header;
+    if (table->freeIndex)
+    {
+        index = table->freeIndex - 1;
+        header = getSlotHeader(table, index);
+        table->freeIndex = header->nextFreeIndex;
+    }
+    else
+    {
+        // index + 1 必须能够放入 REFERENCE_INDEX_BITS
+        if (table->slotCount >= REFERENCE_INDEX_MASK)
+        {
+            return NULL;
+        }
+        if ((size_t)table->slotCount == (size_t)table->chunkCount * REFERENCE_CHUNK_SIZE)
+        {
+            uint8_t **chunkList = realloc(table->chunkList, sizeof(uint8_t *) * (table->chunkCount + 1));
+            if (!chunkList)
+            {
+                return NULL;
+            }
+            table->chunkList = chunkList;
+            uint8_t *chunk = malloc(REFERENCE_CHUNK_HEADER_SIZE + table->slotSize * REFERENCE_CHUNK_SIZE);
+            if (!chunk)
+            {
+                return NULL;
+            }
+            table->chunkList[table->chunkCount++] = chunk;
+        }
+        index = table->slotCount++;
+        header = getSlotHeader(table, index);
+        header->generation = 0;
+    }
+    header->generation = (header->generation + 1) & REFERENCE_GENERATION_MASK;
+    header->nextFreeIndex = 0;
+    *result = (NAPIRef)(((uintptr_t)header->generation << REFERENCE_INDEX_BITS) | ((uintptr_t)index + 1));
+
+    return getSlot(table, index);
+}
+
+void *referenceTableGet(const struct ReferenceTable *table, NAPIRef ref)
+{
+    uintptr_t handle = (uintptr_t)ref;
+    // handle 低位为 0 时 index 会回绕成极大值
+    uintptr_t index = (handle & REFERENCE_INDEX_MASK) - 1;
+    if (index >= table->slotCount)
+    {
+        assert(false && "NAPIRef is invalid.");
+
+        return NULL;
+    }
+    uint32_t generation = (uint32_t)(handle >> REFERENCE_INDEX_BITS);
+    struct ReferenceSlotHeader *header = getSlotHeader(table, (uint32_t)index);
+    if (header->generation != generation || !(generation & 1))
+    {
+        assert(false && "NAPIRef is used after napi_delete_reference().");
+
+        return NULL;
+    }
+
+    return getSlot(table, (uint32_t)index);
+}
+
+void referenceTableFree(struct ReferenceTable *table, NAPIRef ref)
+{
+    uint32_t index = (uint32_t)((uintptr_t)ref & REFERENCE_INDEX_MASK) - 1;
+    struct ReferenceSlotHeader *header = getSlotHeader(table, index);
+    header->generation = (header->generation + 1) & REFERENCE_GENERATION_MASK;
+    header->nextFreeIndex = table->freeIndex;
+    table->freeIndex = index + 1;
+}
+
+void *referenceTableGetSlot(const struct ReferenceTable *table, uint32_t index)
+{
+    if (index >= table->slotCount || !(getSlotHeader(table, index)->generation & 1))
+    {
+        return NULL;
+    }
+
+    return getSlot(table, index);
+}
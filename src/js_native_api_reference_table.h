@@ -0,0 +1,55 @@
+#ifndef SRC_JS_NATIVE_API_REFERENCE_TABLE_H_
+#define SRC_JS_NATIVE_API_REFERENCE_TABLE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stddef.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，三个引擎共用的 NAPIRef 表
+// NAPIRef 不再指向堆内存，而是编码为 (generation << REFERENCE_INDEX_BITS) | (index + 1)
+// slot 按 REFERENCE_CHUNK_SIZE 分块分配，块地址不变，所以 slot 指针可以放入链表
+// 删除后 slot 进入空闲链表，稳定状态下 create/delete/ref/unref 不需要分配内存
+#if UINTPTR_MAX > UINT32_MAX
+#define REFERENCE_INDEX_BITS 32
+#else
+#define REFERENCE_INDEX_BITS 22
+#endif
+
+#define REFERENCE_CHUNK_SIZE 64
+
+struct ReferenceTable
+{
+    uint8_t **chunkList; // size_t
+    size_t slotSize;     // size_t
+    uint32_t chunkCount; // uint32_t
+    // 已经使用过的 slot 数量，只增不减
+    uint32_t slotCount; // uint32_t
+    // index + 1，0 代表空闲链表为空
+    uint32_t freeIndex; // uint32_t
+};
+
+// slotSize 为引擎 slot 结构体大小
+void referenceTableInit(struct ReferenceTable *table, size_t slotSize);
+
+// 只释放内存，调用前引擎需要自行通过 referenceTableGetSlot 释放 slot 中的值
+void referenceTableFinalize(struct ReferenceTable *table);
+
+// 返回未初始化的 slot，NULL 代表内存不足或者 slot 耗尽
+void *referenceTableAlloc(struct ReferenceTable *table, NAPIRef *result);
+
+// 已经删除或者非法的 ref 在 debug 下 assert，release 下返回 NULL
+void *referenceTableGet(const struct ReferenceTable *table, NAPIRef ref);
+
+// ref 必须已经通过 referenceTableGet 检查
+void referenceTableFree(struct ReferenceTable *table, NAPIRef ref);
+
+// 遍历使用，index < table->slotCount，slot 空闲返回 NULL
+void *referenceTableGetSlot(const struct ReferenceTable *table, uint32_t index);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_REFERENCE_TABLE_H_
@@ -0,0 +1,49 @@
+#include "js_native_api_script_source.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t getChunkLength(const char *const *chunks, const size_t *lengths, size_t index)
+{
+    if (!chunks[index])
+    {
+        return 0;
+    }
+
+    return !lengths || lengths[index] == NAPI_AUTO_LENGTH ? strlen(chunks[index]) : lengths[index];
+}
+
+char *scriptSourceJoin(const char *const *chunks, const size_t *lengths, size_t chunkCount, size_t *length)
+{
+    size_t totalLength = 0;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        size_t chunkLength = getChunkLength(chunks, lengths, i);
+        if (chunkLength >= SIZE_MAX - totalLength)
+        {
+            return NULL;
+        }
+        totalLength += chunkLength;
+    }
+    char *script = malloc(totalLength + 1);
+    if (!script)
+    {
+        return NULL;
+    }
+    char *cursor = script;
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        // 第二次遍历只有 NAPI_AUTO_LENGTH 的分片会再次 strlen
+        size_t chunkLength = getChunkLength(chunks, lengths, i);
+        if (chunkLength)
+        {
+            memcpy(cursor, chunks[i], chunkLength);
+            cursor += chunkLength;
+        }
+    }
+    *cursor = '\0';
+    *length = totalLength;
+
+    return script;
+}
@@ -0,0 +1,19 @@
+#ifndef SRC_JS_NATIVE_API_SCRIPT_SOURCE_H_
+#define SRC_JS_NATIVE_API_SCRIPT_SOURCE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stddef.h> // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，NAPIRunScriptWithLength/NAPIRunScriptChunks 使用
+// QuickJS/Hermes parser 和 JSStringCreateWithUTF8CString 都要求源码以 \0 结尾，指定长度的源码至少需要复制一次，
+// 多个分片直接复制到同一块内存，调用方不需要先拼接
+// lengths 可空，为 NULL 或者元素为 NAPI_AUTO_LENGTH 时对应分片需要以 \0 结尾，chunks[i] 为 NULL 视为空字符串
+// 返回 malloc 内存，结尾为 \0，length 不包含 \0；内存不足或者总长度溢出返回 NULL
+char *scriptSourceJoin(const char *const *chunks, const size_t *lengths, size_t chunkCount, size_t *length);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_SCRIPT_SOURCE_H_
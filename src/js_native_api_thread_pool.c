@@ -0,0 +1,117 @@
+#include "js_native_api_thread_pool.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define THREAD_POOL_MAX_THREAD_COUNT 4
+
+struct ThreadPoolNode
+{
+    struct ThreadPoolNode *next; // size_t
+    ThreadPoolTask task;         // size_t
+    void *data;                  // size_t
+};
+
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_cond_t condition = PTHREAD_COND_INITIALIZER;
+
+// 先进先出队列，以下均需要持有 mutex
+static struct ThreadPoolNode *head = NULL;
+
+static struct ThreadPoolNode **tail = &head;
+
+static size_t pendingCount = 0;
+
+static size_t idleCount = 0;
+
+static size_t threadCount = 0;
+
+static size_t getMaxThreadCount(void)
+{
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processorCount <= 2)
+    {
+        return 1;
+    }
+
+    return processorCount - 1 < THREAD_POOL_MAX_THREAD_COUNT ? (size_t)processorCount - 1
+                                                              : THREAD_POOL_MAX_THREAD_COUNT;
+}
+
+static void *threadMain(__attribute__((unused)) void *arg)
+{
+    pthread_mutex_lock(&mutex);
+    while (true)
+    {
+        while (!head)
+        {
+            ++idleCount;
+            pthread_cond_wait(&condition, &mutex);
+            --idleCount;
+        }
+        struct ThreadPoolNode *node = head;
+        head = node->next;
+        if (!head)
+        {
+            tail = &head;
+        }
+        --pendingCount;
+        pthread_mutex_unlock(&mutex);
+        node->task(node->data);
+        free(node);
+        pthread_mutex_lock(&mutex);
+    }
+
+    return NULL;
+}
+
+// 需要持有 mutex
+static bool createThread(void)
+{
+    pthread_attr_t attr;
+    if (pthread_attr_init(&attr))
+    {
+        return false;
+    }
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, THREAD_POOL_STACK_SIZE);
+    pthread_t thread;
+    bool isCreated = !pthread_create(&thread, &attr, threadMain, NULL);
+    pthread_attr_destroy(&attr);
+    if (isCreated)
+    {
+        ++threadCount;
+    }
+
+    return isCreated;
+}
+
+bool threadPoolSubmit(ThreadPoolTask task, void *data)
+{
+    struct ThreadPoolNode *node = malloc(sizeof(struct ThreadPoolNode));
+    if (!node)
+    {
+        return false;
+    }
+    node->next = NULL;
+    node->task = task;
+    node->data = data;
+    pthread_mutex_lock(&mutex);
+    // 等待中的任务多于空闲线程时扩容，创建失败时由已有线程执行
+    if (pendingCount >= idleCount && threadCount < getMaxThreadCount() && !createThread() && !threadCount)
+    {
+        pthread_mutex_unlock(&mutex);
+        free(node);
+
+        return false;
+    }
+    *tail = node;
+    tail = &node->next;
+    ++pendingCount;
+    pthread_cond_signal(&condition);
+    pthread_mutex_unlock(&mutex);
+
+    return true;
+}
@@ -0,0 +1,23 @@
+#ifndef SRC_JS_NATIVE_API_THREAD_POOL_H_
+#define SRC_JS_NATIVE_API_THREAD_POOL_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，进程内共享的后台线程池，用于不依赖引擎状态的任务（比如编译字节码）
+// 第一次提交任务时按需创建线程，线程数不超过 CPU 核数 - 1（至少 1 个，最多 4 个），线程常驻不退出
+// 任务按提交顺序开始执行，不保证完成顺序
+typedef void (*ThreadPoolTask)(void *data);
+
+// 线程栈大小，编译深层嵌套的脚本需要较大的栈，iOS 默认只有 512KB
+#define THREAD_POOL_STACK_SIZE (4 * 1024 * 1024)
+
+// 返回 false 代表内存不足或者无法创建线程，此时 task 不会被调用
+bool threadPoolSubmit(ThreadPoolTask task, void *data);
+
+EXTERN_C_END
+
+#endif // SRC_JS_NATIVE_API_THREAD_POOL_H_
@@ -0,0 +1,59 @@
+#include "js_native_api_output.h"
+
+#include <time.h>
+#include <unistd.h>
+
+uint64_t outputGetMicroseconds(void)
+{
+    struct timespec timespec;
+    clock_gettime(CLOCK_MONOTONIC, &timespec);
+
+    return (uint64_t)timespec.tv_sec * 1000000 + (uint64_t)timespec.tv_nsec / 1000;
+}
+
+FILE *outputOpenFile(int fd)
+{
+    int duplicatedFd = dup(fd);
+    if (duplicatedFd < 0)
+    {
+        return NULL;
+    }
+    FILE *file = fdopen(duplicatedFd, "w");
+    if (!file)
+    {
+        close(duplicatedFd);
+    }
+
+    return file;
+}
+
+bool outputCloseFile(FILE *file)
+{
+    bool isError = ferror(file);
+    // fclose 会 flush
+    isError = fclose(file) || isError;
+
+    return !isError;
+}
+
+void outputWriteString(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (const unsigned char *character = (const unsigned char *)string; *character; ++character)
+    {
+        if (*character == '"' || *character == '\\')
+        {
+            fputc('\\', file);
+            fputc(*character, file);
+        }
+        else if (*character < 0x20)
+        {
+            fprintf(file, "\\u%04x", *character);
+        }
+        else
+        {
+            fputc(*character, file);
+        }
+    }
+    fputc('"', file);
+}
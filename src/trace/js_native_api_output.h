@@ -0,0 +1,28 @@
+#ifndef SRC_TRACE_JS_NATIVE_API_OUTPUT_H_
+#define SRC_TRACE_JS_NATIVE_API_OUTPUT_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+#include <stdio.h>   // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，trace、CPU profile 和堆快照共用的时间戳和 JSON 输出
+
+// CLOCK_MONOTONIC 微秒，Trace Event 和 .cpuprofile 的时间单位
+uint64_t outputGetMicroseconds(void);
+
+// dup 之后再 fdopen，outputCloseFile 不会关闭调用方的 fd，返回 NULL 代表失败
+FILE *outputOpenFile(int fd);
+
+// flush 并关闭，返回 false 代表之前的写入或者 flush 失败
+bool outputCloseFile(FILE *file);
+
+// 写入带引号的 JSON 字符串，string 为 UTF-8，只转义引号、反斜杠和控制字符
+void outputWriteString(FILE *file, const char *string);
+
+EXTERN_C_END
+
+#endif // SRC_TRACE_JS_NATIVE_API_OUTPUT_H_
@@ -0,0 +1,238 @@
+#include "js_native_api_trace.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "js_native_api_output.h"
+
+// 包含结尾 \0，超长按 UTF-8 字符边界截断
+#define TRACE_NAME_SIZE 48
+
+#define TRACE_DETAIL_SIZE 80
+
+struct TraceEvent
+{
+    const char *category; // size_t
+    uint64_t beginTime;
+    uint64_t duration;
+    char name[TRACE_NAME_SIZE];
+    char detail[TRACE_DETAIL_SIZE];
+};
+
+struct TraceSpan
+{
+    uint64_t beginTime;
+    char name[TRACE_NAME_SIZE];
+};
+
+struct Trace
+{
+    struct TraceEvent *eventList; // size_t
+    atomic_flag lock;
+    // Trace Event 的 tid，每个 trace 一个，不同 env 显示为不同的轨道
+    uint32_t id;
+    uint32_t capacity;
+    // 下一个写入位置
+    uint32_t head;
+    uint32_t count;
+    // 被覆盖的事件数量
+    uint64_t droppedCount;
+    // 只在 env 线程访问，不需要加锁
+    uint32_t spanDepth;
+    struct TraceSpan spanList[TRACE_MAX_SPAN_DEPTH];
+};
+
+static atomic_uint traceIdCounter;
+
+static void copyString(char *destination, const char *source, size_t size)
+{
+    size_t length = source ? strlen(source) : 0;
+    if (length >= size)
+    {
+        length = size - 1;
+        // 不截断在多字节字符中间，避免输出非法 UTF-8
+        while (length && ((unsigned char)source[length] & 0xC0) == 0x80)
+        {
+            --length;
+        }
+    }
+    if (length)
+    {
+        memcpy(destination, source, length);
+    }
+    destination[length] = '\0';
+}
+
+static void lock(struct Trace *trace)
+{
+    while (atomic_flag_test_and_set_explicit(&trace->lock, memory_order_acquire))
+    {
+    }
+}
+
+static void unlock(struct Trace *trace)
+{
+    atomic_flag_clear_explicit(&trace->lock, memory_order_release);
+}
+
+struct Trace *traceCreate(uint32_t capacity)
+{
+    struct Trace *trace = malloc(sizeof(struct Trace));
+    if (!trace)
+    {
+        return NULL;
+    }
+    trace->capacity = capacity ? capacity : TRACE_DEFAULT_CAPACITY;
+    if (trace->capacity > TRACE_MAX_CAPACITY)
+    {
+        trace->capacity = TRACE_MAX_CAPACITY;
+    }
+    trace->eventList = malloc(sizeof(struct TraceEvent) * trace->capacity);
+    if (!trace->eventList)
+    {
+        free(trace);
+
+        return NULL;
+    }
+    atomic_flag_clear(&trace->lock);
+    trace->id = atomic_fetch_add_explicit(&traceIdCounter, 1, memory_order_relaxed) + 1;
+    trace->head = 0;
+    trace->count = 0;
+    trace->droppedCount = 0;
+    trace->spanDepth = 0;
+
+    return trace;
+}
+
+void traceFree(struct Trace *trace)
+{
+    if (!trace)
+    {
+        return;
+    }
+    free(trace->eventList);
+    free(trace);
+}
+
+uint64_t traceGetTimestamp(const struct Trace *trace)
+{
+    return trace ? outputGetMicroseconds() : 0;
+}
+
+void traceAddEvent(struct Trace *trace, const char *category, const char *name, const char *detail,
+                   uint64_t beginTime)
+{
+    if (!trace)
+    {
+        return;
+    }
+    uint64_t now = outputGetMicroseconds();
+    lock(trace);
+    struct TraceEvent *event = &trace->eventList[trace->head];
+    event->category = category;
+    event->beginTime = beginTime;
+    event->duration = now - beginTime;
+    copyString(event->name, name, TRACE_NAME_SIZE);
+    copyString(event->detail, detail, TRACE_DETAIL_SIZE);
+    trace->head = (trace->head + 1) % trace->capacity;
+    if (trace->count < trace->capacity)
+    {
+        ++trace->count;
+    }
+    else
+    {
+        ++trace->droppedCount;
+    }
+    unlock(trace);
+}
+
+void traceBeginSpan(struct Trace *trace, const char *name)
+{
+    if (!trace)
+    {
+        return;
+    }
+    if (trace->spanDepth < TRACE_MAX_SPAN_DEPTH)
+    {
+        trace->spanList[trace->spanDepth].beginTime = outputGetMicroseconds();
+        copyString(trace->spanList[trace->spanDepth].name, name, TRACE_NAME_SIZE);
+    }
+    ++trace->spanDepth;
+}
+
+void traceEndSpan(struct Trace *trace)
+{
+    if (!trace || !trace->spanDepth)
+    {
+        return;
+    }
+    --trace->spanDepth;
+    if (trace->spanDepth < TRACE_MAX_SPAN_DEPTH)
+    {
+        struct TraceSpan *span = &trace->spanList[trace->spanDepth];
+        traceAddEvent(trace, TRACE_CATEGORY_NATIVE, span->name, NULL, span->beginTime);
+    }
+}
+
+static void writeEventList(FILE *file, uint32_t id, const struct TraceEvent *eventList, uint32_t count,
+                           uint64_t droppedCount)
+{
+    int pid = getpid();
+    fprintf(file,
+            "{\"traceEvents\":[{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,"
+            "\"args\":{\"name\":\"NAPIEnv %u\"}}",
+            pid, id, id);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const struct TraceEvent *event = &eventList[i];
+        fputs(",{\"name\":", file);
+        outputWriteString(file, event->name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%u", event->category,
+                (unsigned long long)event->beginTime, (unsigned long long)event->duration, pid, id);
+        if (event->detail[0])
+        {
+            fputs(",\"args\":{\"detail\":", file);
+            outputWriteString(file, event->detail);
+            fputc('}', file);
+        }
+        fputc('}', file);
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\",\"otherData\":{\"droppedEventCount\":%llu}}",
+            (unsigned long long)droppedCount);
+}
+
+bool traceWrite(struct Trace *trace, int fd)
+{
+    // 加锁期间只复制，避免 GC 线程等待 IO
+    struct TraceEvent *eventList = malloc(sizeof(struct TraceEvent) * trace->capacity);
+    if (!eventList)
+    {
+        return false;
+    }
+    lock(trace);
+    uint32_t count = trace->count;
+    // 最旧的事件位置
+    uint32_t tail = (trace->head + trace->capacity - count) % trace->capacity;
+    uint32_t firstCount = trace->capacity - tail < count ? trace->capacity - tail : count;
+    memcpy(eventList, &trace->eventList[tail], sizeof(struct TraceEvent) * firstCount);
+    memcpy(&eventList[firstCount], trace->eventList, sizeof(struct TraceEvent) * (count - firstCount));
+    uint64_t droppedCount = trace->droppedCount;
+    trace->count = 0;
+    trace->droppedCount = 0;
+    unlock(trace);
+
+    FILE *file = outputOpenFile(fd);
+    if (!file)
+    {
+        free(eventList);
+
+        return false;
+    }
+    writeEventList(file, trace->id, eventList, count, droppedCount);
+    free(eventList);
+
+    return outputCloseFile(file);
+}
@@ -0,0 +1,61 @@
+#ifndef SRC_TRACE_JS_NATIVE_API_TRACE_H_
+#define SRC_TRACE_JS_NATIVE_API_TRACE_H_
+
+#include <napi/js_native_api_types.h>
+
+EXTERN_C_START
+
+#include <stdbool.h> // NOLINT(modernize-deprecated-headers)
+#include <stdint.h>  // NOLINT(modernize-deprecated-headers)
+
+// 私有头文件，每个 env 一个 trace 记录器，事件保存在固定容量环形缓冲区，满了以后覆盖最旧的事件
+// 输出 Chrome Trace Event Format JSON，可以导入 chrome://tracing 或者 Perfetto
+// Hermes GC 回调可能不在 env 线程，所以写入使用自旋锁保护
+struct Trace;
+
+// 默认容量
+#define TRACE_DEFAULT_CAPACITY 4096
+
+// 最大容量，超出按上限处理，保证 32 位平台上缓冲区大小计算不会溢出
+#define TRACE_MAX_CAPACITY (1024 * 1024)
+
+// 用户 span 最大嵌套层数，超出部分不记录
+#define TRACE_MAX_SPAN_DEPTH 32
+
+// 事件分类，对应 Trace Event 的 cat 字段
+#define TRACE_CATEGORY_SCRIPT "script"
+
+#define TRACE_CATEGORY_COMPILE "compile"
+
+#define TRACE_CATEGORY_MICROTASK "microtask"
+
+#define TRACE_CATEGORY_GC "gc"
+
+#define TRACE_CATEGORY_NATIVE "native"
+
+// capacity 为 0 使用默认值，超过 TRACE_MAX_CAPACITY 按上限处理，返回 NULL 代表内存不足
+struct Trace *traceCreate(uint32_t capacity);
+
+// trace 可空
+void traceFree(struct Trace *trace);
+
+// 事件开始时间，trace 为空返回 0，调用方不需要判断是否开启
+uint64_t traceGetTimestamp(const struct Trace *trace);
+
+// 记录从 beginTime 到当前的完整事件，category 需要是静态字符串，name/detail 会被复制（超长截断）
+// trace/detail 可空
+void traceAddEvent(struct Trace *trace, const char *category, const char *name, const char *detail,
+                   uint64_t beginTime);
+
+// 用户 span，只能在 env 线程调用，trace 可空
+void traceBeginSpan(struct Trace *trace, const char *name);
+
+// 没有未结束的 span 时忽略
+void traceEndSpan(struct Trace *trace);
+
+// 写入 fd 并清空缓冲区，不会关闭 fd，返回 false 代表写入失败（缓冲区同样被清空）
+bool traceWrite(struct Trace *trace, int fd);
+
+EXTERN_C_END
+
+#endif // SRC_TRACE_JS_NATIVE_API_TRACE_H_
@@ -0,0 +1,77 @@
+#ifndef SRC_TRACE_JS_NATIVE_API_USDT_H_
+#define SRC_TRACE_JS_NATIVE_API_USDT_H_
+
+// 私有头文件，USDT 静态探针，开启 GN 参数 napi_usdt 时定义 NAPI_USDT
+// 生成和 systemtap sys/sdt.h 相同的 .note.stapsdt 段，不依赖 systemtap 头文件，provider 为 napi
+// 探针位置只有一条 nop，没有挂载时开销可以忽略
+// 参数统一转换为 8 字节无符号整数，例如
+// bpftrace -e 'usdt:./test_qjs:napi:callback_entry { @start[tid] = nsecs; }
+//              usdt:./test_qjs:napi:callback_return /@start[tid]/ { @ns = hist(nsecs - @start[tid]); }'
+// 只支持 Linux/Android 的 64 位 ELF，其他平台为空宏
+//
+// 探针列表：
+// callback_entry/callback_return(env, callback)：native 函数回调
+// constructor_entry/constructor_return(env, callback)：native 构造函数回调
+// handle_scope_open/handle_scope_close(env, scope)：包括 escapable handle scope
+// script_start(env, sourceUrl)/script_done(env)：执行脚本、编译结果和模块，JavaScriptCore 执行编译结果时 sourceUrl 为 0
+// bytecode_start(env, bufferSize)/bytecode_done(env)：执行字节码，JavaScriptCore 不支持
+// gc_start/gc_done()：Hermes 为引擎的全部 GC 事件；QuickJS 没有 GC 回调，只覆盖 NAPIRunGC 和
+// NAPINotifyMemoryPressure 触发的 JS_RunGC，分配达到阈值时引擎自动触发的 GC 不会产生探针；JavaScriptCore 没有
+
+#if defined(NAPI_USDT) && defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+
+#include <stdint.h> // NOLINT(modernize-deprecated-headers)
+
+// 参数格式为 "大小@汇编操作数"，由编译器替换为寄存器或者内存地址
+// .stapsdt.base 用于工具计算预链接后的地址偏移，每个目标文件通过 comdat 只保留一份
+#define NAPI_USDT_NOTE(name, argumentFormat)                                                                           \
+    "990: nop\n"                                                                                                       \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                                                                      \
+    ".balign 4\n"                                                                                                      \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                                                                 \
+    "991: .asciz \"stapsdt\"\n"                                                                                        \
+    "992: .balign 4\n"                                                                                                 \
+    "993: .8byte 990b\n"                                                                                               \
+    ".8byte _.stapsdt.base\n"                                                                                          \
+    ".8byte 0\n"                                                                                                       \
+    ".asciz \"napi\"\n"                                                                                                \
+    ".asciz \"" #name "\"\n"                                                                                           \
+    ".asciz \"" argumentFormat "\"\n"                                                                                  \
+    "994: .balign 4\n"                                                                                                 \
+    ".popsection\n"                                                                                                    \
+    ".ifndef _.stapsdt.base\n"                                                                                         \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"                                            \
+    ".weak _.stapsdt.base\n"                                                                                           \
+    ".hidden _.stapsdt.base\n"                                                                                         \
+    "_.stapsdt.base: .space 1\n"                                                                                       \
+    ".size _.stapsdt.base, 1\n"                                                                                        \
+    ".popsection\n"                                                                                                    \
+    ".endif\n"
+
+#define NAPI_USDT_ARGUMENT(argument) "nor"((uint64_t)(uintptr_t)(argument))
+
+#define NAPI_USDT_PROBE0(name) __asm__ __volatile__(NAPI_USDT_NOTE(name, ""))
+
+#define NAPI_USDT_PROBE1(name, argument1)                                                                              \
+    __asm__ __volatile__(NAPI_USDT_NOTE(name, "8@%[napiUsdtArgument1]")                                                \
+                         :                                                                                             \
+                         : [napiUsdtArgument1] NAPI_USDT_ARGUMENT(argument1))
+
+#define NAPI_USDT_PROBE2(name, argument1, argument2)                                                                   \
+    __asm__ __volatile__(NAPI_USDT_NOTE(name, "8@%[napiUsdtArgument1] 8@%[napiUsdtArgument2]")                         \
+                         :                                                                                             \
+                         : [napiUsdtArgument1] NAPI_USDT_ARGUMENT(argument1),                                          \
+                           [napiUsdtArgument2] NAPI_USDT_ARGUMENT(argument2))
+
+#else
+
+// 参数只在探针中使用时避免 unused 警告
+#define NAPI_USDT_PROBE0(name) ((void)0)
+
+#define NAPI_USDT_PROBE1(name, argument1) ((void)(argument1))
+
+#define NAPI_USDT_PROBE2(name, argument1, argument2) ((void)(argument1), (void)(argument2))
+
+#endif
+
+#endif // SRC_TRACE_JS_NATIVE_API_USDT_H_
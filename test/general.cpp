@@ -1,3 +1,5 @@
+#include <cstring>
+#include <vector>
 #include <test.h>
 
 EXTERN_C_START
@@ -135,4 +137,71 @@ TEST_F(Test, General)
             "doInstanceOf({},Array)),globalThis.assert(globalThis.addon.doInstanceOf([],Array))})();",
             "https://www.napi.com/general.js", nullptr),
         NAPIExceptionOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, RuntimeConfig)
+{
+    NAPIRuntimeConfig config = {};
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntimeWithConfig(&runtime, &config), NAPIErrorInvalidArg);
+    config.version = NAPI_RUNTIME_CONFIG_VERSION + 1;
+    ASSERT_EQ(NAPICreateRuntimeWithConfig(&runtime, &config), NAPIErrorInvalidArg);
+    config.version = NAPI_RUNTIME_CONFIG_VERSION;
+    config.maxHeapSize = 32 << 20;
+    config.initialHeapSize = 4 << 20;
+    config.gcThreshold = 1 << 20;
+    config.stackSize = 256 << 10;
+    config.memoryLimit = 32 << 20;
+    ASSERT_EQ(NAPICreateRuntimeWithConfig(&runtime, &config), NAPIErrorOK);
+    NAPIEnv env;
+    NAPIRuntimeConfig envConfig = {};
+    ASSERT_EQ(NAPICreateEnvWithConfig(&env, runtime, &envConfig), NAPIErrorInvalidArg);
+    envConfig.version = NAPI_RUNTIME_CONFIG_VERSION;
+    envConfig.registerCount = 16 << 10;
+    ASSERT_EQ(NAPICreateEnvWithConfig(&env, runtime, &envConfig), NAPIErrorOK);
+    NAPIHandleScope handleScope;
+    ASSERT_EQ(napi_open_handle_scope(env, &handleScope), NAPIErrorOK);
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunScript(env, "1 + 1", "https://www.napi.com/runtime_config.js", &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(env, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 2);
+    ASSERT_EQ(napi_close_handle_scope(env, handleScope), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
+
+TEST_F(Test, CallStats)
+{
+    size_t count;
+    NAPIErrorStatus status = NAPIGetCallStats(nullptr, &count);
+    // 未开启 napi_instrumentation
+    if (status != NAPIErrorOK)
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+
+        return;
+    }
+    ASSERT_EQ(NAPIGetCallStats(nullptr, nullptr), NAPIErrorInvalidArg);
+    ASSERT_GT(count, static_cast<size_t>(0));
+    NAPIValue result;
+    for (int i = 0; i < 100; ++i)
+    {
+        ASSERT_EQ(napi_get_undefined(globalEnv, &result), NAPICommonOK);
+    }
+    std::vector<NAPICallStats> statsList(count);
+    ASSERT_EQ(NAPIGetCallStats(statsList.data(), &count), NAPIErrorOK);
+    ASSERT_EQ(count, statsList.size());
+    bool isFound = false;
+    for (const auto &stats : statsList)
+    {
+        if (!strcmp(stats.name, "napi_get_undefined"))
+        {
+            isFound = true;
+            ASSERT_GE(stats.callCount, static_cast<uint64_t>(100));
+            ASSERT_LE(stats.p50Nanoseconds, stats.p99Nanoseconds);
+            ASSERT_LE(stats.p99Nanoseconds, stats.maxNanoseconds);
+        }
+    }
+    ASSERT_TRUE(isFound);
+}
@@ -6,16 +6,33 @@
 
 class Test : public ::testing::Test
 {
-
+  protected:
     void SetUp() override;
 
     void TearDown() override;
 
-  protected:
     NAPIHandleScope handleScope;
     NAPIValue addonValue;
 };
 
+// 测试按引擎分别编译，BUILD.gn 定义 NAPI_TEST_ENGINE_JSC/NAPI_TEST_ENGINE_QJS/NAPI_TEST_ENGINE_HERMES 其中之一
+enum class TestEngine
+{
+    JSC,
+    QuickJS,
+    Hermes,
+};
+
+#if defined(NAPI_TEST_ENGINE_JSC)
+constexpr TestEngine testEngine = TestEngine::JSC;
+#elif defined(NAPI_TEST_ENGINE_QJS)
+constexpr TestEngine testEngine = TestEngine::QuickJS;
+#elif defined(NAPI_TEST_ENGINE_HERMES)
+constexpr TestEngine testEngine = TestEngine::Hermes;
+#else
+#error "需要定义 NAPI_TEST_ENGINE_JSC、NAPI_TEST_ENGINE_QJS 或 NAPI_TEST_ENGINE_HERMES"
+#endif
+
 extern bool finalizeIsCalled;
 
 extern NAPIEnv globalEnv;
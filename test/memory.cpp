@@ -0,0 +1,319 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <test.h>
+
+EXTERN_C_START
+
+static int externalFinalizeCount = 0;
+
+static void externalFinalize(void *finalizeData, void *finalizeHint)
+{
+    assert(finalizeData == &externalFinalizeCount);
+    assert(!finalizeHint);
+    ++externalFinalizeCount;
+}
+
+static bool interruptHandler(void *data)
+{
+    ++*static_cast<int *>(data);
+
+    // 不中断执行
+    return false;
+}
+
+EXTERN_C_END
+
+// 读取整个文件，失败返回空字符串
+static std::string readFile(FILE *file)
+{
+    if (fseek(file, 0, SEEK_END) != 0)
+    {
+        return std::string();
+    }
+    long size = ftell(file);
+    if (size <= 0 || fseek(file, 0, SEEK_SET) != 0)
+    {
+        return std::string();
+    }
+    std::string content(static_cast<size_t>(size), '\0');
+    if (fread(&content[0], 1, content.size(), file) != content.size())
+    {
+        return std::string();
+    }
+
+    return content;
+}
+
+TEST_F(Test, AdjustExternalMemory)
+{
+    int64_t baseline;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &baseline), NAPICommonOK);
+    int64_t adjustedValue;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 1024, &adjustedValue), NAPICommonOK);
+    ASSERT_EQ(adjustedValue, baseline + 1024);
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, -1024, &adjustedValue), NAPICommonOK);
+    ASSERT_EQ(adjustedValue, baseline);
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, nullptr), NAPICommonOK);
+}
+
+TEST_F(Test, ExternalWithSize)
+{
+    // 每个 External 声明 16MB，总计 1GB，只统计不实际分配
+    constexpr size_t externalMemorySize = 16 * 1024 * 1024;
+    constexpr int externalCount = 64;
+    int finalizeCount = externalFinalizeCount;
+    int64_t baseline;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &baseline), NAPICommonOK);
+    for (int i = 0; i < externalCount; ++i)
+    {
+        NAPIHandleScope handleScope;
+        ASSERT_EQ(napi_open_handle_scope(globalEnv, &handleScope), NAPIErrorOK);
+        NAPIValue externalValue;
+        ASSERT_EQ(NAPICreateExternalWithSize(globalEnv, &externalFinalizeCount, externalFinalize, nullptr,
+                                             externalMemorySize, &externalValue),
+                  NAPIExceptionOK);
+        void *data;
+        ASSERT_EQ(napi_get_value_external(globalEnv, externalValue, &data), NAPIErrorOK);
+        ASSERT_EQ(data, &externalFinalizeCount);
+        ASSERT_EQ(napi_close_handle_scope(globalEnv, handleScope), NAPICommonOK);
+    }
+    int64_t adjustedValue;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &adjustedValue), NAPICommonOK);
+    if (testEngine == TestEngine::QuickJS)
+    {
+        // 引用计数归零时立即回收并扣除统计
+        ASSERT_EQ(externalFinalizeCount - finalizeCount, externalCount);
+        ASSERT_EQ(adjustedValue, baseline);
+    }
+    else
+    {
+        // Hermes/JavaScriptCore 由 GC 决定回收时机，JavaScriptCore 还会保守扫描栈，不保证已经回收
+        ASSERT_LE(adjustedValue, baseline + static_cast<int64_t>(externalMemorySize) * externalCount);
+    }
+    // 无 finalizeCB
+    NAPIValue externalValue;
+    ASSERT_EQ(NAPICreateExternalWithSize(globalEnv, nullptr, nullptr, nullptr, 1024, &externalValue), NAPIExceptionOK);
+    void *data;
+    ASSERT_EQ(napi_get_value_external(globalEnv, externalValue, &data), NAPIErrorOK);
+    ASSERT_EQ(data, nullptr);
+}
+
+TEST_F(Test, GCExternalMemory)
+{
+    constexpr size_t externalMemorySize = 16 * 1024 * 1024;
+    NAPIHeapStats stats;
+    {
+        NAPIHandleScope handleScope;
+        ASSERT_EQ(napi_open_handle_scope(globalEnv, &handleScope), NAPIErrorOK);
+        NAPIValue externalValue;
+        ASSERT_EQ(NAPICreateExternalWithSize(globalEnv, nullptr, nullptr, nullptr, externalMemorySize, &externalValue),
+                  NAPIExceptionOK);
+        ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &stats), NAPICommonOK);
+        ASSERT_EQ(napi_close_handle_scope(globalEnv, handleScope), NAPICommonOK);
+    }
+    // 只有 Hermes 向 GC credit 外部内存
+    if (testEngine != TestEngine::Hermes)
+    {
+        ASSERT_EQ(stats.gcExternalMemorySize, 0);
+
+        return;
+    }
+    ASSERT_GE(stats.gcExternalMemorySize, static_cast<int64_t>(externalMemorySize));
+    // External 在 GC 中析构，NAPIRunGC 返回前扣除 credit
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIGCKindFull), NAPICommonOK);
+    NAPIHeapStats gcStats;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &gcStats), NAPICommonOK);
+    ASSERT_LE(gcStats.gcExternalMemorySize, stats.gcExternalMemorySize - static_cast<int64_t>(externalMemorySize));
+    ASSERT_EQ(gcStats.gcExternalMemorySize, std::max<int64_t>(gcStats.externalMemorySize, 0));
+}
+
+TEST_F(Test, RunGC)
+{
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIGCKindFull), NAPICommonOK);
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIGCKindYoung), NAPICommonOK);
+    ASSERT_EQ(NAPIRunGC(globalEnv, (NAPIGCKind)-1), NAPICommonInvalidArg);
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, NAPIMemoryPressureLevelModerate), NAPICommonOK);
+    ASSERT_EQ(NAPISetFinalizerMode(globalEnv, NAPIFinalizerModeDeferred), NAPICommonOK);
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, NAPIMemoryPressureLevelCritical), NAPICommonOK);
+    // Critical 会执行所有延迟的 finalizer
+    NAPIFinalizerStats stats;
+    ASSERT_EQ(NAPIGetFinalizerStats(globalEnv, &stats), NAPICommonOK);
+    ASSERT_EQ(stats.pendingCount, static_cast<size_t>(0));
+    ASSERT_EQ(NAPISetFinalizerMode(globalEnv, NAPIFinalizerModeSync), NAPICommonOK);
+    ASSERT_EQ(NAPINotifyMemoryPressure(globalEnv, (NAPIMemoryPressureLevel)-1), NAPICommonInvalidArg);
+}
+
+TEST_F(Test, HeapStatistics)
+{
+    NAPIHeapStats stats;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &stats), NAPICommonOK);
+    ASSERT_GE(stats.totalHeapSize, stats.usedHeapSize);
+    int64_t externalMemorySize;
+    ASSERT_EQ(napi_adjust_external_memory(globalEnv, 0, &externalMemorySize), NAPICommonOK);
+    ASSERT_EQ(stats.externalMemorySize, externalMemorySize);
+    ASSERT_EQ(NAPIRunGC(globalEnv, NAPIGCKindFull), NAPICommonOK);
+    NAPIHeapStats gcStats;
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, &gcStats), NAPICommonOK);
+    if (testEngine == TestEngine::QuickJS)
+    {
+        // QuickJS 没有 GC 回调，只统计 NAPIRunGC
+        ASSERT_EQ(gcStats.gcCount, stats.gcCount + 1);
+    }
+    else
+    {
+        // Hermes 还会统计引擎自身触发的 GC，JavaScriptCore 不支持时均为 0
+        ASSERT_GE(gcStats.gcCount, stats.gcCount);
+    }
+    ASSERT_GE(gcStats.gcNanoseconds, stats.gcNanoseconds);
+    ASSERT_EQ(NAPIGetHeapStatistics(globalEnv, nullptr), NAPICommonInvalidArg);
+}
+
+TEST_F(Test, HeapSnapshot)
+{
+    ASSERT_EQ(NAPIWriteHeapSnapshot(globalEnv, -1), NAPIErrorInvalidArg);
+    // 生成快照不能执行 getter 和 Proxy trap
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "globalThis.heapSnapshotMarker = new (class HeapSnapshotMarker {})();"
+                            "globalThis.heapSnapshotTrapCount = 0;"
+                            "(() => { const trap = () => { ++heapSnapshotTrapCount; };"
+                            "globalThis.heapSnapshotProxy = new Proxy({}, { ownKeys: trap, getPrototypeOf: trap, "
+                            "getOwnPropertyDescriptor: trap });"
+                            "Object.defineProperty(globalThis, 'heapSnapshotGetter', { get: trap }); })();",
+                            "https://www.napi.com/heap_snapshot.js", nullptr),
+              NAPIExceptionOK);
+    FILE *file = tmpfile();
+    ASSERT_TRUE(file);
+    NAPIErrorStatus status = NAPIWriteHeapSnapshot(globalEnv, fileno(file));
+    // JavaScriptCore 不支持
+    if (status == NAPIErrorOK)
+    {
+        std::string snapshot = readFile(file);
+        ASSERT_FALSE(snapshot.empty());
+        ASSERT_NE(snapshot.find("\"snapshot\":"), std::string::npos);
+        ASSERT_NE(snapshot.find("\"node_count\":"), std::string::npos);
+        ASSERT_NE(snapshot.find("\"nodes\":"), std::string::npos);
+        ASSERT_NE(snapshot.find("\"strings\":"), std::string::npos);
+        // 全局对象可达的对象名称
+        ASSERT_NE(snapshot.find("\"HeapSnapshotMarker\""), std::string::npos);
+        ASSERT_EQ(NAPIRunScript(globalEnv, "if (heapSnapshotTrapCount) throw new Error();",
+                                "https://www.napi.com/heap_snapshot.js", nullptr),
+                  NAPIExceptionOK);
+    }
+    else
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+    }
+    fclose(file);
+}
+
+TEST_F(Test, CPUProfile)
+{
+    ASSERT_EQ(NAPIStopProfiling(globalEnv, 0), NAPIErrorInvalidArg);
+    NAPIErrorStatus status = NAPIStartProfiling(globalEnv, 100);
+    // JavaScriptCore 不支持
+    if (status != NAPIErrorOK)
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+
+        return;
+    }
+    ASSERT_EQ(NAPIStartProfiling(globalEnv, 100), NAPIErrorGenericFailure);
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{function f(n){return n<2?n:f(n-1)+f(n-2)}"
+                            "const t=Date.now();while(Date.now()-t<50)f(15)})();",
+                            "https://n-api.com/cpu_profile.js", nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(NAPIStopProfiling(globalEnv, -1), NAPIErrorInvalidArg);
+    FILE *file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_EQ(NAPIStopProfiling(globalEnv, fileno(file)), NAPIErrorOK);
+    std::string profile = readFile(file);
+    fclose(file);
+    ASSERT_FALSE(profile.empty());
+    if (testEngine == TestEngine::QuickJS)
+    {
+        ASSERT_NE(profile.find("\"nodes\":"), std::string::npos);
+        ASSERT_NE(profile.find("\"samples\":"), std::string::npos);
+        ASSERT_NE(profile.find("\"functionName\":\"f\""), std::string::npos);
+    }
+    else
+    {
+        // Hermes 的 trace event 格式，函数名位于 stackFrames
+        ASSERT_NE(profile.find("\"stackFrames\""), std::string::npos);
+        ASSERT_NE(profile.find("\"name\":\"f"), std::string::npos);
+    }
+    ASSERT_EQ(NAPIStopProfiling(globalEnv, 0), NAPIErrorInvalidArg);
+}
+
+TEST_F(Test, InterruptHandler)
+{
+    NAPIRuntime runtime = nullptr;
+    ASSERT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+    NAPIEnv env = nullptr;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    int callCount = 0;
+    ASSERT_EQ(NAPISetInterruptHandler(nullptr, interruptHandler, &callCount), NAPIErrorInvalidArg);
+    NAPIErrorStatus status = NAPISetInterruptHandler(runtime, interruptHandler, &callCount);
+    // 只有 QuickJS 支持
+    if (status == NAPIErrorOK)
+    {
+        const char *script = "(()=>{let s=0;for(let i=0;i<200000;++i)s+=i;return s})();";
+        ASSERT_EQ(NAPIStartProfiling(env, 100), NAPIErrorOK);
+        ASSERT_EQ(NAPIRunScript(env, script, "https://n-api.com/interrupt.js", nullptr), NAPIExceptionOK);
+        FILE *file = tmpfile();
+        ASSERT_TRUE(file);
+        ASSERT_EQ(NAPIStopProfiling(env, fileno(file)), NAPIErrorOK);
+        fclose(file);
+        ASSERT_GT(callCount, 0);
+        // 停止采样不会移除嵌入方的 handler
+        int profilingCallCount = callCount;
+        ASSERT_EQ(NAPIRunScript(env, script, "https://n-api.com/interrupt.js", nullptr), NAPIExceptionOK);
+        ASSERT_GT(callCount, profilingCallCount);
+        ASSERT_EQ(NAPISetInterruptHandler(runtime, nullptr, nullptr), NAPIErrorOK);
+        int clearedCallCount = callCount;
+        ASSERT_EQ(NAPIRunScript(env, script, "https://n-api.com/interrupt.js", nullptr), NAPIExceptionOK);
+        ASSERT_EQ(callCount, clearedCallCount);
+    }
+    else
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+    }
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
+
+TEST_F(Test, Trace)
+{
+    ASSERT_EQ(NAPIFlushTrace(globalEnv, 0), NAPIErrorInvalidArg);
+    // 没有开启时忽略
+    ASSERT_EQ(NAPIBeginTraceSpan(globalEnv, "ignored"), NAPICommonOK);
+    ASSERT_EQ(NAPIEndTraceSpan(globalEnv), NAPICommonOK);
+    ASSERT_EQ(NAPIStartTracing(globalEnv, 0), NAPIErrorOK);
+    ASSERT_EQ(NAPIStartTracing(globalEnv, 0), NAPIErrorGenericFailure);
+    ASSERT_EQ(NAPIBeginTraceSpan(globalEnv, nullptr), NAPICommonInvalidArg);
+    ASSERT_EQ(NAPIBeginTraceSpan(globalEnv, "outer"), NAPICommonOK);
+    ASSERT_EQ(NAPIBeginTraceSpan(globalEnv, "inner"), NAPICommonOK);
+    ASSERT_EQ(NAPIRunScript(globalEnv, "Promise.resolve().then(() => 1);", "https://n-api.com/trace.js", nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(NAPIEndTraceSpan(globalEnv), NAPICommonOK);
+    ASSERT_EQ(NAPIEndTraceSpan(globalEnv), NAPICommonOK);
+    // 多余的 end 忽略
+    ASSERT_EQ(NAPIEndTraceSpan(globalEnv), NAPICommonOK);
+    ASSERT_EQ(NAPIFlushTrace(globalEnv, -1), NAPIErrorInvalidArg);
+    FILE *file = tmpfile();
+    ASSERT_TRUE(file);
+    ASSERT_EQ(NAPIFlushTrace(globalEnv, fileno(file)), NAPIErrorOK);
+    ASSERT_EQ(NAPIStopTracing(globalEnv), NAPICommonOK);
+    ASSERT_EQ(NAPIFlushTrace(globalEnv, fileno(file)), NAPIErrorInvalidArg);
+    rewind(file);
+    char buffer[4096] = {};
+    ASSERT_GT(fread(buffer, 1, sizeof(buffer) - 1, file), static_cast<size_t>(0));
+    fclose(file);
+    ASSERT_TRUE(strstr(buffer, "\"traceEvents\""));
+    ASSERT_TRUE(strstr(buffer, "\"name\":\"outer\""));
+    ASSERT_TRUE(strstr(buffer, "\"name\":\"inner\""));
+    ASSERT_TRUE(strstr(buffer, "\"detail\":\"https://n-api.com/trace.js\""));
+    ASSERT_FALSE(strstr(buffer, "ignored"));
+}
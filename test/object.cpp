@@ -166,6 +166,13 @@ static void externalFinalize(void *finalizeData, void *finalizeHint)
     assert(finalizeHint == finalizeData);
 }
 
+static int deferredFinalizeCount = 0;
+
+static void deferredFinalize(void * /*finalizeData*/, void * /*finalizeHint*/)
+{
+    ++deferredFinalizeCount;
+}
+
 EXTERN_C_END
 
 TEST_F(Test, Object)
@@ -181,6 +188,17 @@ TEST_F(Test, Object)
     NAPIValueType valueType;
     ASSERT_EQ(napi_typeof(globalEnv, externalValue, &valueType), NAPICommonOK);
     ASSERT_EQ(valueType, NAPIExternal);
+    // 无 finalizeCB
+    ASSERT_EQ(napi_create_external(globalEnv, globalEnv, nullptr, nullptr, &externalValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_typeof(globalEnv, externalValue, &valueType), NAPICommonOK);
+    ASSERT_EQ(valueType, NAPIExternal);
+    ASSERT_EQ(napi_get_value_external(globalEnv, externalValue, &data), NAPIErrorOK);
+    ASSERT_EQ(data, globalEnv);
+    ASSERT_EQ(napi_create_external(globalEnv, nullptr, nullptr, nullptr, &externalValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_typeof(globalEnv, externalValue, &valueType), NAPICommonOK);
+    ASSERT_EQ(valueType, NAPIExternal);
+    ASSERT_EQ(napi_get_value_external(globalEnv, externalValue, &data), NAPIErrorOK);
+    ASSERT_EQ(data, nullptr);
 
     NAPIValue getValue, setValue, hasValue, deleteValue, isArrayValue, newValue, getThisValue;
     ASSERT_EQ(napi_create_function(globalEnv, nullptr, get, nullptr, &getValue), NAPIExceptionOK);
@@ -237,4 +255,47 @@ TEST_F(Test, Object)
             "Object.getOwnPropertyDescriptor(b,0))})();",
             "https://www.napi.com/object.js", nullptr),
         NAPIExceptionOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, DeferredFinalizer)
+{
+    ASSERT_EQ(NAPISetFinalizerMode(globalEnv, NAPIFinalizerModeDeferred), NAPICommonOK);
+    NAPIFinalizerStats beforeStats;
+    ASSERT_EQ(NAPIGetFinalizerStats(globalEnv, &beforeStats), NAPICommonOK);
+    deferredFinalizeCount = 0;
+    NAPIHandleScope handleScope;
+    ASSERT_EQ(napi_open_handle_scope(globalEnv, &handleScope), NAPIErrorOK);
+    for (int i = 0; i < 100; ++i)
+    {
+        NAPIValue externalValue;
+        ASSERT_EQ(napi_create_external(globalEnv, nullptr, deferredFinalize, nullptr, &externalValue),
+                  NAPIExceptionOK);
+    }
+    // 外层还有测试夹具的 handle scope，关闭时不会执行队列
+    ASSERT_EQ(napi_close_handle_scope(globalEnv, handleScope), NAPICommonOK);
+    NAPIFinalizerStats stats;
+    ASSERT_EQ(NAPIGetFinalizerStats(globalEnv, &stats), NAPICommonOK);
+    ASSERT_LE(stats.pendingCount, stats.maxPendingCount);
+    ASSERT_LE(stats.runCount, stats.enqueuedCount);
+    if (testEngine == TestEngine::QuickJS)
+    {
+        // 引用计数归零时立即入队，finalizer 没有执行
+        ASSERT_EQ(stats.enqueuedCount - beforeStats.enqueuedCount, static_cast<uint64_t>(100));
+        ASSERT_EQ(deferredFinalizeCount, 0);
+    }
+    // 其他引擎 GC 时机不确定，只校验计数关系
+    size_t remaining;
+    ASSERT_EQ(NAPIRunPendingFinalizers(globalEnv, 1, &remaining), NAPICommonOK);
+    ASSERT_LE(remaining, stats.pendingCount);
+    ASSERT_EQ(NAPIRunPendingFinalizers(globalEnv, 0, &remaining), NAPICommonOK);
+    ASSERT_EQ(remaining, static_cast<size_t>(0));
+    ASSERT_EQ(NAPIGetFinalizerStats(globalEnv, &stats), NAPICommonOK);
+    ASSERT_EQ(stats.pendingCount, static_cast<size_t>(0));
+    ASSERT_EQ(stats.runCount, stats.enqueuedCount);
+    if (testEngine == TestEngine::QuickJS)
+    {
+        ASSERT_EQ(deferredFinalizeCount, 100);
+    }
+    ASSERT_EQ(NAPIRunPendingFinalizers(globalEnv, 0, nullptr), NAPICommonOK);
+    ASSERT_EQ(NAPISetFinalizerMode(globalEnv, NAPIFinalizerModeSync), NAPICommonOK);
+}
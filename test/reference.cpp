@@ -62,4 +62,65 @@ TEST_F(Test, EscapableHandleScope)
     ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, otherValue, &string), NAPIErrorOK);
     ASSERT_STREQ(string, "");
     ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
-}
\ No newline at end of file
+}
+
+TEST_F(Test, WeakReference)
+{
+    NAPIValue objectValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({})", "https://www.napi.com/weak_reference.js", &objectValue),
+              NAPIExceptionOK);
+    NAPIRef ref, otherRef;
+    ASSERT_EQ(napi_create_reference(globalEnv, objectValue, 0, &ref), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_reference(globalEnv, objectValue, 0, &otherRef), NAPIExceptionOK);
+    uint32_t referenceCount;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(napi_reference_ref(globalEnv, ref, &referenceCount), NAPIExceptionOK);
+        ASSERT_EQ(referenceCount, static_cast<unsigned int>(1));
+        ASSERT_EQ(napi_reference_unref(globalEnv, ref, &referenceCount), NAPIExceptionOK);
+        ASSERT_EQ(referenceCount, static_cast<unsigned int>(0));
+    }
+    NAPIValue value;
+    ASSERT_EQ(napi_get_reference_value(globalEnv, ref, &value), NAPIExceptionOK);
+    bool isEqual;
+    ASSERT_EQ(napi_strict_equals(globalEnv, value, objectValue, &isEqual), NAPIExceptionOK);
+    ASSERT_TRUE(isEqual);
+    ASSERT_EQ(napi_delete_reference(globalEnv, otherRef), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_reference_value(globalEnv, ref, &value), NAPIExceptionOK);
+    ASSERT_EQ(napi_strict_equals(globalEnv, value, objectValue, &isEqual), NAPIExceptionOK);
+    ASSERT_TRUE(isEqual);
+    ASSERT_EQ(napi_delete_reference(globalEnv, ref), NAPIExceptionOK);
+}
+
+TEST_F(Test, ReferenceCount)
+{
+    NAPIValue objectValue;
+    ASSERT_EQ(NAPIRunScript(globalEnv, "({})", "https://www.napi.com/reference_count.js", &objectValue),
+              NAPIExceptionOK);
+    NAPIRef ref;
+    ASSERT_EQ(napi_create_reference(globalEnv, objectValue, 1, &ref), NAPIExceptionOK);
+    uint32_t referenceCount;
+    // 超过 uint8_t 范围
+    for (unsigned int i = 2; i <= 300; ++i)
+    {
+        ASSERT_EQ(napi_reference_ref(globalEnv, ref, &referenceCount), NAPIExceptionOK);
+        ASSERT_EQ(referenceCount, i);
+    }
+    for (unsigned int i = 299; i > 0; --i)
+    {
+        ASSERT_EQ(napi_reference_unref(globalEnv, ref, &referenceCount), NAPIExceptionOK);
+        ASSERT_EQ(referenceCount, i);
+    }
+    NAPIValue value;
+    ASSERT_EQ(napi_get_reference_value(globalEnv, ref, &value), NAPIExceptionOK);
+    bool isEqual;
+    ASSERT_EQ(napi_strict_equals(globalEnv, value, objectValue, &isEqual), NAPIExceptionOK);
+    ASSERT_TRUE(isEqual);
+    ASSERT_EQ(napi_delete_reference(globalEnv, ref), NAPIExceptionOK);
+
+    // 删除后 slot 复用，句柄不同
+    NAPIRef otherRef;
+    ASSERT_EQ(napi_create_reference(globalEnv, objectValue, 1, &otherRef), NAPIExceptionOK);
+    ASSERT_NE(otherRef, ref);
+    ASSERT_EQ(napi_delete_reference(globalEnv, otherRef), NAPIExceptionOK);
+}
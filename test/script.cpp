@@ -0,0 +1,754 @@
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <test.h>
+#include <unistd.h>
+#include <vector>
+
+TEST_F(Test, ByteBuffer)
+{
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    NAPIExceptionStatus status =
+        NAPICompileToByteBuffer(globalEnv, "(() => { const a = [1, 2, 3]; return a[1] + 40; })()",
+                                "https://n-api.com/byte_buffer.js", &byteBuffer, &bufferSize);
+    // JavaScriptCore 不支持
+    if (status != NAPIExceptionOK)
+    {
+        ASSERT_EQ(status, NAPIExceptionGenericFailure);
+
+        return;
+    }
+    ASSERT_TRUE(byteBuffer);
+    ASSERT_GT(bufferSize, static_cast<size_t>(0));
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, byteBuffer, bufferSize, &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    // 同一份字节码可以多次执行
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, byteBuffer, bufferSize, nullptr), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, nullptr, bufferSize, nullptr), NAPIExceptionInvalidArg);
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, byteBuffer, 0, nullptr), NAPIExceptionInvalidArg);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+
+    NAPIValue exceptionValue;
+    ASSERT_EQ(
+        NAPICompileToByteBuffer(globalEnv, "const = ;", "https://n-api.com/syntax_error.js", &byteBuffer, &bufferSize),
+        NAPIExceptionPendingException);
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+    const uint8_t invalidBuffer[16] = {};
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, invalidBuffer, sizeof(invalidBuffer), nullptr),
+              NAPIExceptionPendingException);
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+}
+
+TEST_F(Test, ByteBufferFromFile)
+{
+    ASSERT_EQ(NAPIRunByteBufferFromFile(globalEnv, nullptr, nullptr), NAPIExceptionInvalidArg);
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    NAPIExceptionStatus status = NAPICompileToByteBuffer(globalEnv, "'from' + ' file'", "https://n-api.com/file.js",
+                                                         &byteBuffer, &bufferSize);
+    if (status != NAPIExceptionOK)
+    {
+        ASSERT_EQ(status, NAPIExceptionGenericFailure);
+
+        return;
+    }
+    char path[] = "/tmp/napi_byte_buffer_XXXXXX";
+    int fd = mkstemp(path);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(write(fd, byteBuffer, bufferSize), static_cast<ssize_t>(bufferSize));
+    close(fd);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunByteBufferFromFile(globalEnv, path, &result), NAPIExceptionOK);
+    const char *string;
+    ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, result, &string), NAPIErrorOK);
+    ASSERT_STREQ(string, "from file");
+    ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
+    // Hermes 映射在 env 销毁前一直有效，unlink 只删除目录项，不影响已经映射的页面
+    unlink(path);
+    ASSERT_EQ(NAPIRunByteBufferFromFile(globalEnv, path, nullptr), NAPIExceptionGenericFailure);
+}
+
+// 按文件名排序的条目列表
+static std::vector<std::string> getCodeCacheEntryList(const char *directory)
+{
+    std::vector<std::string> entryList;
+    DIR *dir = opendir(directory);
+    if (!dir)
+    {
+        return entryList;
+    }
+    while (struct dirent *dirent = readdir(dir))
+    {
+        std::string name = dirent->d_name;
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".cache") == 0)
+        {
+            entryList.push_back(name);
+        }
+    }
+    closedir(dir);
+    std::sort(entryList.begin(), entryList.end());
+
+    return entryList;
+}
+
+static size_t getCodeCacheEntryCount(const char *directory)
+{
+    return getCodeCacheEntryList(directory).size();
+}
+
+// 返回 mkdtemp 创建的父目录，缓存目录为其下的 cache，由 NAPISetCodeCacheDirectory 创建
+static std::string createCodeCacheDirectory()
+{
+    char directory[] = "/tmp/napi_code_cache_XXXXXX";
+
+    return mkdtemp(directory) ? directory : std::string();
+}
+
+static void removeCodeCacheDirectory(const std::string &directory)
+{
+    std::string cacheDirectory = directory + "/cache";
+    DIR *dir = opendir(cacheDirectory.c_str());
+    if (dir)
+    {
+        while (struct dirent *dirent = readdir(dir))
+        {
+            unlinkat(dirfd(dir), dirent->d_name, 0);
+        }
+        closedir(dir);
+    }
+    rmdir(cacheDirectory.c_str());
+    rmdir(directory.c_str());
+}
+
+static std::vector<char> readCodeCacheEntry(const std::string &path)
+{
+    std::vector<char> content;
+    FILE *file = fopen(path.c_str(), "rb");
+    if (!file)
+    {
+        return content;
+    }
+    char buffer[4096];
+    size_t length;
+    while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        content.insert(content.end(), buffer, buffer + length);
+    }
+    fclose(file);
+
+    return content;
+}
+
+static void writeCodeCacheEntry(const std::string &path, const std::vector<char> &content)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fwrite(content.data(), 1, content.size(), file), content.size());
+    fclose(file);
+}
+
+static void runCodeCacheScript(NAPIRuntime runtime, const char *script, const char *sourceUrl)
+{
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunScript(env, script, sourceUrl, nullptr), NAPIExceptionOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+}
+
+// 每个测试使用新的缓存目录和 runtime，JavaScriptCore 不支持代码缓存，检查错误码后跳过
+class CodeCacheTest : public Test
+{
+  protected:
+    void SetUp() override
+    {
+        Test::SetUp();
+        directory = createCodeCacheDirectory();
+        ASSERT_FALSE(directory.empty());
+        cacheDirectory = directory + "/cache";
+        ASSERT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+        if (testEngine == TestEngine::JSC)
+        {
+            ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), 0), NAPIErrorGenericFailure);
+            GTEST_SKIP();
+        }
+        ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), 0), NAPIErrorOK);
+    }
+
+    void TearDown() override
+    {
+        // 失败时仍然需要清理目录和 handle scope
+        if (runtime)
+        {
+            EXPECT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+        }
+        if (!directory.empty())
+        {
+            removeCodeCacheDirectory(directory);
+        }
+        Test::TearDown();
+    }
+
+    std::string directory;
+    std::string cacheDirectory;
+    NAPIRuntime runtime = nullptr;
+};
+
+TEST_F(CodeCacheTest, CodeCache)
+{
+    // 第一次未命中写入缓存，之后的 env 命中
+    for (int i = 0; i < 2; ++i)
+    {
+        NAPIEnv env;
+        ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+        NAPIValue result;
+        ASSERT_EQ(NAPIRunScript(env, "(() => { const a = [1, 2, 3]; return a[2] + 39; })()",
+                                "https://n-api.com/code_cache.js", &result),
+                  NAPIExceptionOK);
+        double value;
+        ASSERT_EQ(napi_get_value_double(env, result, &value), NAPIErrorOK);
+        ASSERT_EQ(value, 42);
+        ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(1));
+        // 语法错误不写入缓存
+        ASSERT_EQ(NAPIRunScript(env, "const = ;", "https://n-api.com/syntax_error.js", nullptr),
+                  NAPIExceptionPendingException);
+        NAPIValue exceptionValue;
+        ASSERT_EQ(napi_get_and_clear_last_exception(env, &exceptionValue), NAPIErrorOK);
+        ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    }
+    // 上限小于任何条目时不写入
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), 1), NAPIErrorOK);
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunScript(env, "'other'", "https://n-api.com/other.js", nullptr), NAPIExceptionOK);
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(1));
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, nullptr, 0), NAPIErrorOK);
+}
+
+TEST_F(CodeCacheTest, CodeCacheHit)
+{
+    runCodeCacheScript(runtime, "'hit'", "https://n-api.com/hit.js");
+    std::vector<std::string> entryList = getCodeCacheEntryList(cacheDirectory.c_str());
+    ASSERT_EQ(entryList.size(), static_cast<size_t>(1));
+    std::string path = cacheDirectory + "/" + entryList[0];
+    struct stat missStat;
+    ASSERT_EQ(stat(path.c_str(), &missStat), 0);
+    // 命中时只更新 mtime，不会重新写入（写入为 rename，会产生新的 inode）
+    runCodeCacheScript(runtime, "'hit'", "https://n-api.com/hit.js");
+    struct stat hitStat;
+    ASSERT_EQ(stat(path.c_str(), &hitStat), 0);
+    ASSERT_EQ(hitStat.st_ino, missStat.st_ino);
+    // 内容损坏（比如掉电）时 checksum 不一致，视为未命中并重新写入
+    std::vector<char> content = readCodeCacheEntry(path);
+    ASSERT_FALSE(content.empty());
+    std::vector<char> corruptedContent = content;
+    corruptedContent.back() ^= 0xff;
+    writeCodeCacheEntry(path, corruptedContent);
+    runCodeCacheScript(runtime, "'hit'", "https://n-api.com/hit.js");
+    ASSERT_EQ(readCodeCacheEntry(path), content);
+    // sourceUrl 属于 key，未命中产生新条目
+    runCodeCacheScript(runtime, "'hit'", "https://n-api.com/miss.js");
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(2));
+}
+
+TEST_F(CodeCacheTest, CodeCacheVersion)
+{
+    runCodeCacheScript(runtime, "'version'", "https://n-api.com/version.js");
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(1));
+    // 版本一致时保留条目
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), 0), NAPIErrorOK);
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(1));
+    // 模拟引擎升级
+    std::string versionPath = cacheDirectory + "/version";
+    FILE *file = fopen(versionPath.c_str(), "wb");
+    ASSERT_TRUE(file);
+    ASSERT_GE(fputs("old engine", file), 0);
+    fclose(file);
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), 0), NAPIErrorOK);
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(0));
+    runCodeCacheScript(runtime, "'version'", "https://n-api.com/version.js");
+    ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(1));
+}
+
+TEST_F(CodeCacheTest, CodeCacheEviction)
+{
+    // 三个脚本长度相同，条目大小相同
+    runCodeCacheScript(runtime, "'entry0'", "https://n-api.com/entry0.js");
+    std::vector<std::string> entryList = getCodeCacheEntryList(cacheDirectory.c_str());
+    ASSERT_EQ(entryList.size(), static_cast<size_t>(1));
+    std::string entry0 = entryList[0];
+    struct stat entryStat;
+    ASSERT_EQ(stat((cacheDirectory + "/" + entry0).c_str(), &entryStat), 0);
+    // 只能容纳两个条目
+    auto entrySize = static_cast<size_t>(entryStat.st_size);
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), entrySize * 2 + entrySize / 2), NAPIErrorOK);
+    // 内核时间戳来自粗粒度时钟，间隔 20ms 保证 mtime 先后顺序
+    usleep(20 * 1000);
+    runCodeCacheScript(runtime, "'entry1'", "https://n-api.com/entry1.js");
+    entryList = getCodeCacheEntryList(cacheDirectory.c_str());
+    ASSERT_EQ(entryList.size(), static_cast<size_t>(2));
+    std::string entry1 = entryList[0] == entry0 ? entryList[1] : entryList[0];
+    // 命中 entry0，entry1 成为最久未访问的条目
+    usleep(20 * 1000);
+    runCodeCacheScript(runtime, "'entry0'", "https://n-api.com/entry0.js");
+    usleep(20 * 1000);
+    runCodeCacheScript(runtime, "'entry2'", "https://n-api.com/entry2.js");
+    entryList = getCodeCacheEntryList(cacheDirectory.c_str());
+    ASSERT_EQ(entryList.size(), static_cast<size_t>(2));
+    ASSERT_NE(std::find(entryList.begin(), entryList.end(), entry0), entryList.end());
+    ASSERT_EQ(std::find(entryList.begin(), entryList.end(), entry1), entryList.end());
+    // 刚写入的条目不会被淘汰
+    ASSERT_EQ(NAPISetCodeCacheDirectory(runtime, cacheDirectory.c_str(), entrySize), NAPIErrorOK);
+    usleep(20 * 1000);
+    runCodeCacheScript(runtime, "'entry3'", "https://n-api.com/entry3.js");
+    entryList = getCodeCacheEntryList(cacheDirectory.c_str());
+    ASSERT_EQ(entryList.size(), static_cast<size_t>(1));
+    ASSERT_NE(entryList[0], entry0);
+}
+
+TEST_F(Test, CompiledScript)
+{
+    NAPIScript script;
+    ASSERT_EQ(NAPICompileScript(globalEnv, nullptr, NAPI_AUTO_LENGTH, nullptr, &script), NAPIExceptionInvalidArg);
+    const char *counterScript = "globalThis.compiledScriptCount = (globalThis.compiledScriptCount || 0) + 1;";
+    ASSERT_EQ(NAPICompileScript(globalEnv, counterScript, NAPI_AUTO_LENGTH, "https://n-api.com/compiled_script.js",
+                                &script),
+              NAPIExceptionOK);
+    // 多次执行同一份编译结果，全局作用域副作用保留
+    NAPIValue result;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_EQ(NAPIRunCompiledScript(globalEnv, script, &result), NAPIExceptionOK);
+    }
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 3);
+    ASSERT_EQ(NAPIFreeScript(nullptr, script), NAPICommonInvalidArg);
+    ASSERT_EQ(NAPIFreeScript(globalEnv, nullptr), NAPICommonInvalidArg);
+    // 不能在其他 env 中执行和释放
+    NAPIRuntime otherRuntime;
+    ASSERT_EQ(NAPICreateRuntime(&otherRuntime), NAPIErrorOK);
+    NAPIEnv otherEnv;
+    ASSERT_EQ(NAPICreateEnv(&otherEnv, otherRuntime), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunCompiledScript(otherEnv, script, &result), NAPIExceptionInvalidArg);
+    ASSERT_EQ(NAPIFreeScript(otherEnv, script), NAPICommonInvalidArg);
+    ASSERT_EQ(NAPIFreeEnv(otherEnv), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(otherRuntime), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeScript(globalEnv, script), NAPICommonOK);
+
+    // 只编译 length 范围内的内容
+    const char *source = "40 + 2; syntax error";
+    ASSERT_EQ(NAPICompileScript(globalEnv, source, 6, "https://n-api.com/length.js", &script), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunCompiledScript(globalEnv, script, &result), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(NAPIFreeScript(globalEnv, script), NAPICommonOK);
+
+    ASSERT_EQ(NAPICompileScript(globalEnv, source, NAPI_AUTO_LENGTH, "https://n-api.com/syntax_error.js", &script),
+              NAPIExceptionPendingException);
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+
+    ASSERT_EQ(NAPICompileScript(globalEnv, "throw new Error('compiled')", NAPI_AUTO_LENGTH, nullptr, &script),
+              NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunCompiledScript(globalEnv, script, nullptr), NAPIExceptionPendingException);
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+    ASSERT_EQ(NAPIFreeScript(globalEnv, script), NAPICommonOK);
+}
+
+TEST_F(Test, RunScriptWithOptions)
+{
+    NAPIRunScriptOptions options = {};
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, "1", "https://n-api.com/options.js", &options, nullptr),
+              NAPIExceptionInvalidArg);
+    const char *script = "(function () { return this === undefined; })()";
+    NAPIValue result;
+    bool isStrict;
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, script, "https://n-api.com/options.js", nullptr, &result),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_bool(globalEnv, result, &isStrict), NAPIErrorOK);
+    ASSERT_FALSE(isStrict);
+    options.version = NAPI_RUN_SCRIPT_OPTIONS_VERSION;
+    options.strict = true;
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, script, "https://n-api.com/options.js", &options, &result),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_bool(globalEnv, result, &isStrict), NAPIErrorOK);
+    ASSERT_TRUE(isStrict);
+    // 其余选项只影响编译方式，不影响结果
+    options = {NAPI_RUN_SCRIPT_OPTIONS_VERSION, true, true, true, false, true};
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, "[1, 2, 3].map((x) => x * 2).reduce((a, b) => a + b)",
+                                       "https://n-api.com/options.js", &options, &result),
+              NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 12);
+    // 和 NAPIRunScript 相同，NULL 视为空字符串
+    ASSERT_EQ(NAPIRunScriptWithOptions(globalEnv, nullptr, nullptr, &options, nullptr), NAPIExceptionOK);
+}
+
+TEST_F(CodeCacheTest, RunScriptWithOptionsCodeCache)
+{
+    const char *script = "(function () { return this === undefined; })()";
+    NAPIRunScriptOptions options = {};
+    options.version = NAPI_RUN_SCRIPT_OPTIONS_VERSION;
+    // 第一次未命中写入缓存，第二次命中；strict 属于 key，严格模式和非严格模式各有一个条目
+    for (int i = 0; i < 2; ++i)
+    {
+        for (bool isStrict : {false, true})
+        {
+            NAPIEnv env;
+            ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+            options.strict = isStrict;
+            NAPIValue result;
+            ASSERT_EQ(NAPIRunScriptWithOptions(env, script, "https://n-api.com/options_cache.js", &options, &result),
+                      NAPIExceptionOK);
+            bool value;
+            ASSERT_EQ(napi_get_value_bool(env, result, &value), NAPIErrorOK);
+            ASSERT_EQ(value, isStrict);
+            ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+        }
+        ASSERT_EQ(getCodeCacheEntryCount(cacheDirectory.c_str()), static_cast<size_t>(2));
+    }
+}
+
+struct CompileResult
+{
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool isDone = false;
+    const uint8_t *byteBuffer = nullptr;
+    size_t bufferSize = 0;
+    bool hasErrorMessage = false;
+};
+
+EXTERN_C_START
+
+static void onCompiled(const uint8_t *byteBuffer, size_t bufferSize, const char *errorMessage, void *data)
+{
+    auto compileResult = static_cast<CompileResult *>(data);
+    std::lock_guard<std::mutex> lock(compileResult->mutex);
+    compileResult->byteBuffer = byteBuffer;
+    compileResult->bufferSize = bufferSize;
+    compileResult->hasErrorMessage = errorMessage != nullptr;
+    compileResult->isDone = true;
+    compileResult->condition.notify_one();
+}
+
+EXTERN_C_END
+
+static void waitCompileResult(CompileResult &compileResult)
+{
+    std::unique_lock<std::mutex> lock(compileResult.mutex);
+    compileResult.condition.wait(lock, [&compileResult] { return compileResult.isDone; });
+}
+
+TEST_F(Test, CompileScriptAsync)
+{
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+    ASSERT_EQ(NAPICompileScriptAsync(runtime, nullptr, NAPI_AUTO_LENGTH, nullptr, onCompiled, nullptr),
+              NAPIErrorInvalidArg);
+    CompileResult compileResult;
+    // script 在返回后立即失效
+    std::string script = "(() => { const a = [1, 2, 3]; return a.map((x) => x * 2)[2] + 36; })() + 'ignored'";
+    NAPIErrorStatus status =
+        NAPICompileScriptAsync(runtime, script.c_str(), script.find(" + 'ignored'"), "https://n-api.com/async.js",
+                               onCompiled, &compileResult);
+    // JavaScriptCore 不支持
+    if (status != NAPIErrorOK)
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+        ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+
+        return;
+    }
+    script.assign(script.size(), ' ');
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    waitCompileResult(compileResult);
+    ASSERT_TRUE(compileResult.byteBuffer);
+    ASSERT_FALSE(compileResult.hasErrorMessage);
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunByteBuffer(env, compileResult.byteBuffer, compileResult.bufferSize, &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(env, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(NAPIFreeByteBuffer(env, compileResult.byteBuffer), NAPICommonOK);
+
+    CompileResult errorResult;
+    ASSERT_EQ(NAPICompileScriptAsync(runtime, "const = ;", NAPI_AUTO_LENGTH, "https://n-api.com/syntax_error.js",
+                                     onCompiled, &errorResult),
+              NAPIErrorOK);
+    waitCompileResult(errorResult);
+    ASSERT_FALSE(errorResult.byteBuffer);
+    ASSERT_TRUE(errorResult.hasErrorMessage);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
+
+TEST_F(Test, RunScriptWithLength)
+{
+    ASSERT_EQ(NAPIRunScriptWithLength(globalEnv, nullptr, 0, nullptr, nullptr), NAPIExceptionInvalidArg);
+    // 不以 \0 结尾，只执行前 length 字节
+    const char source[] = {'4', '0', ' ', '+', ' ', '2', ' ', '+'};
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunScriptWithLength(globalEnv, source, sizeof(source) - 2, "https://n-api.com/length.js", &result),
+              NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(NAPIRunScriptWithLength(globalEnv, "40 + 2", NAPI_AUTO_LENGTH, nullptr, &result), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+
+    ASSERT_EQ(NAPIRunScriptChunks(globalEnv, nullptr, nullptr, 1, nullptr, nullptr), NAPIExceptionInvalidArg);
+    ASSERT_EQ(NAPIRunScriptChunks(globalEnv, nullptr, nullptr, 0, nullptr, nullptr), NAPIExceptionOK);
+    const char *chunks[] = {"(() => { const a = ", nullptr, "40; return a + 2; })() + 100"};
+    const size_t lengths[] = {NAPI_AUTO_LENGTH, 0, sizeof("40; return a + 2; })()") - 1};
+    ASSERT_EQ(NAPIRunScriptChunks(globalEnv, chunks, lengths, 3, "https://n-api.com/chunks.js", &result),
+              NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    // 分片边界不插入分隔符
+    const char *splitChunks[] = {"4", "2"};
+    ASSERT_EQ(NAPIRunScriptChunks(globalEnv, splitChunks, nullptr, 2, nullptr, &result), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    const char *errorChunks[] = {"const", " = ;"};
+    ASSERT_EQ(NAPIRunScriptChunks(globalEnv, errorChunks, nullptr, 2, "https://n-api.com/syntax_error.js", nullptr),
+              NAPIExceptionPendingException);
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(globalEnv, &exceptionValue), NAPIErrorOK);
+}
+
+static int moduleLoadCount = 0;
+
+EXTERN_C_START
+
+// 去掉相对路径前缀，其他模块不存在
+static char *resolveModule(const char * /*referrer*/, const char *specifier, void * /*data*/)
+{
+    if (strncmp(specifier, "./", 2) == 0)
+    {
+        specifier += 2;
+    }
+
+    return strcmp(specifier, "missing") == 0 ? nullptr : strdup(specifier);
+}
+
+static char *loadModule(const char *moduleName, void * /*data*/)
+{
+    ++moduleLoadCount;
+    if (strcmp(moduleName, "math") == 0)
+    {
+        return strdup("export const answer = 40; export function add(a, b) { return a + b; }");
+    }
+    if (strcmp(moduleName, "lazy") == 0)
+    {
+        return strdup("import { add } from './math'; export const value = add(20, 22);");
+    }
+
+    return nullptr;
+}
+
+EXTERN_C_END
+
+TEST_F(Test, Module)
+{
+    NAPIRuntime runtime;
+    ASSERT_EQ(NAPICreateRuntime(&runtime), NAPIErrorOK);
+    NAPIEnv env;
+    ASSERT_EQ(NAPICreateEnv(&env, runtime), NAPIErrorOK);
+    NAPIErrorStatus status = NAPISetModuleLoader(env, resolveModule, loadModule, nullptr);
+    // 只有 QuickJS 支持
+    if (status != NAPIErrorOK)
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+        ASSERT_EQ(NAPIRunModule(env, "export default 1;", "main", nullptr), NAPIExceptionGenericFailure);
+        ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+        ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+
+        return;
+    }
+    moduleLoadCount = 0;
+    ASSERT_EQ(NAPIRunModule(env, "import { answer, add } from './math'; globalThis.moduleValue = add(answer, 2);",
+                            "main", nullptr),
+              NAPIExceptionOK);
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunScript(env, "moduleValue", nullptr, &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(env, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(moduleLoadCount, 1);
+    // 动态 import 在微任务中加载，math 命中 env 模块缓存
+    ASSERT_EQ(NAPIRunScript(env, "import('lazy').then((module) => { globalThis.lazyValue = module.value; })",
+                            "https://n-api.com/dynamic_import.js", nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunScript(env, "lazyValue", nullptr, &result), NAPIExceptionOK);
+    ASSERT_EQ(napi_get_value_double(env, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(moduleLoadCount, 2);
+
+    ASSERT_EQ(NAPIRunModule(env, "import './missing';", "main", nullptr), NAPIExceptionPendingException);
+    NAPIValue exceptionValue;
+    ASSERT_EQ(napi_get_and_clear_last_exception(env, &exceptionValue), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunModule(env, "import './unknown';", "main", nullptr), NAPIExceptionPendingException);
+    ASSERT_EQ(napi_get_and_clear_last_exception(env, &exceptionValue), NAPIErrorOK);
+    ASSERT_EQ(NAPIFreeEnv(env), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeRuntime(runtime), NAPICommonOK);
+}
+
+TEST_F(Test, BytecodeArchive)
+{
+    NAPIArchiveBuilder builder;
+    NAPIErrorStatus status = NAPICreateArchiveBuilder(&builder);
+    // JavaScriptCore 不支持
+    if (status != NAPIErrorOK)
+    {
+        ASSERT_EQ(status, NAPIErrorGenericFailure);
+        ASSERT_EQ(NAPIOpenArchive("/tmp/napi_missing.archive", nullptr), NAPIErrorGenericFailure);
+
+        return;
+    }
+    const char *const moduleNameList[] = {"math", "greeting", "counter"};
+    const char *const scriptList[] = {"(() => { const a = [1, 2, 3]; return a[0] + 41; })()", "'hello ' + 'archive'",
+                                      "globalThis.archiveRunCount = (globalThis.archiveRunCount || 0) + 1; ({})"};
+    std::string greetingByteBuffer;
+    for (size_t i = 0; i < 3; ++i)
+    {
+        const uint8_t *byteBuffer;
+        size_t bufferSize;
+        ASSERT_EQ(NAPICompileToByteBuffer(globalEnv, scriptList[i], moduleNameList[i], &byteBuffer, &bufferSize),
+                  NAPIExceptionOK);
+        if (i == 1)
+        {
+            greetingByteBuffer.assign(reinterpret_cast<const char *>(byteBuffer), bufferSize);
+        }
+        ASSERT_EQ(NAPIArchiveBuilderAddModule(builder, moduleNameList[i], byteBuffer, bufferSize), NAPIErrorOK);
+        // 模块名重复
+        ASSERT_EQ(NAPIArchiveBuilderAddModule(builder, moduleNameList[i], byteBuffer, bufferSize),
+                  NAPIErrorInvalidArg);
+        ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+    }
+    char directory[] = "/tmp/napi_archive_XXXXXX";
+    ASSERT_TRUE(mkdtemp(directory));
+    std::string path = std::string(directory) + "/bundle.archive";
+    ASSERT_EQ(NAPIArchiveBuilderWrite(builder, path.c_str()), NAPIErrorOK);
+    ASSERT_EQ(NAPIFreeArchiveBuilder(builder), NAPICommonOK);
+
+    NAPIArchive archive;
+    ASSERT_EQ(NAPIOpenArchive(path.c_str(), &archive), NAPIErrorOK);
+    // 按需执行，和写入顺序无关
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "greeting", &result), NAPIExceptionOK);
+    const char *string;
+    ASSERT_EQ(NAPIGetValueStringUTF8(globalEnv, result, &string), NAPIErrorOK);
+    ASSERT_STREQ(string, "hello archive");
+    ASSERT_EQ(NAPIFreeUTF8String(globalEnv, string), NAPICommonOK);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "math", &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "missing", nullptr), NAPIExceptionGenericFailure);
+    // 结果按模块缓存，第二次调用不执行
+    NAPIValue counterValue;
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "counter", &counterValue), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "counter", nullptr), NAPIExceptionOK);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "counter", &result), NAPIExceptionOK);
+    bool isEqual;
+    ASSERT_EQ(napi_strict_equals(globalEnv, counterValue, result, &isEqual), NAPIExceptionOK);
+    ASSERT_TRUE(isEqual);
+    ASSERT_EQ(NAPIRunScript(globalEnv, "if (archiveRunCount !== 1) throw new Error();",
+                            "https://www.napi.com/archive.js", nullptr),
+              NAPIExceptionOK);
+    ASSERT_EQ(NAPICloseArchive(archive), NAPICommonOK);
+
+    // 修改字节码内容，打开时不校验，第一次加载时拒绝
+    FILE *file = fopen(path.c_str(), "r+b");
+    ASSERT_TRUE(file);
+    ASSERT_EQ(fseek(file, 0, SEEK_END), 0);
+    std::string content(static_cast<size_t>(ftell(file)), '\0');
+    rewind(file);
+    ASSERT_EQ(fread(&content[0], 1, content.size(), file), content.size());
+    size_t offset = content.find(greetingByteBuffer);
+    ASSERT_NE(offset, std::string::npos);
+    offset += greetingByteBuffer.size() / 2;
+    ASSERT_EQ(fseek(file, static_cast<long>(offset), SEEK_SET), 0);
+    ASSERT_NE(fputc(content[offset] ^ 0xff, file), EOF);
+    ASSERT_EQ(fclose(file), 0);
+    ASSERT_EQ(NAPIOpenArchive(path.c_str(), &archive), NAPIErrorOK);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "greeting", nullptr), NAPIExceptionGenericFailure);
+    ASSERT_EQ(NAPIRunArchiveModule(globalEnv, archive, "math", &result), NAPIExceptionOK);
+    ASSERT_EQ(NAPICloseArchive(archive), NAPICommonOK);
+
+    // 截断的文件在打开时拒绝
+    ASSERT_EQ(truncate(path.c_str(), 16), 0);
+    ASSERT_EQ(NAPIOpenArchive(path.c_str(), &archive), NAPIErrorGenericFailure);
+    ASSERT_EQ(unlink(path.c_str()), 0);
+    ASSERT_EQ(rmdir(directory), 0);
+}
+
+TEST_F(Test, BytecodeStats)
+{
+    const char *script = "function add(a, b) {\n"
+                         "    return a + b;\n"
+                         "}\n"
+                         "const list = [1, 2, 3];\n"
+                         "add(list[0], 'stats'.length * 8 + 1);\n";
+    const uint8_t *byteBuffer;
+    size_t bufferSize;
+    NAPIExceptionStatus status =
+        NAPICompileToByteBuffer(globalEnv, script, "https://n-api.com/stats.js", &byteBuffer, &bufferSize);
+    // JavaScriptCore 不支持
+    if (status != NAPIExceptionOK)
+    {
+        ASSERT_EQ(status, NAPIExceptionGenericFailure);
+        ASSERT_EQ(NAPIGetBytecodeStats(nullptr, 0, nullptr), NAPIErrorGenericFailure);
+
+        return;
+    }
+    NAPIBytecodeStats stats;
+    ASSERT_EQ(NAPIGetBytecodeStats(byteBuffer, bufferSize, &stats), NAPIErrorOK);
+    ASSERT_EQ(stats.totalSize, bufferSize);
+    ASSERT_GE(stats.functionCount, static_cast<size_t>(2));
+    ASSERT_GT(stats.codeSize, static_cast<size_t>(0));
+    ASSERT_GT(stats.debugInfoSize, static_cast<size_t>(0));
+
+    NAPICompileOptions options = {};
+    ASSERT_EQ(NAPICompileToByteBufferWithOptions(globalEnv, script, "https://n-api.com/stats.js", &options,
+                                                 &byteBuffer, &bufferSize),
+              NAPIExceptionInvalidArg);
+    options.version = NAPI_COMPILE_OPTIONS_VERSION;
+    options.stripDebugInfo = true;
+    const uint8_t *strippedByteBuffer;
+    size_t strippedBufferSize;
+    ASSERT_EQ(NAPICompileToByteBufferWithOptions(globalEnv, script, "https://n-api.com/stats.js", &options,
+                                                 &strippedByteBuffer, &strippedBufferSize),
+              NAPIExceptionOK);
+    ASSERT_LT(strippedBufferSize, bufferSize);
+    NAPIBytecodeStats strippedStats;
+    ASSERT_EQ(NAPIGetBytecodeStats(strippedByteBuffer, strippedBufferSize, &strippedStats), NAPIErrorOK);
+    ASSERT_EQ(strippedStats.functionCount, stats.functionCount);
+    ASSERT_LT(strippedStats.debugInfoSize, stats.debugInfoSize);
+    // 不影响执行结果
+    NAPIValue result;
+    ASSERT_EQ(NAPIRunByteBuffer(globalEnv, strippedByteBuffer, strippedBufferSize, &result), NAPIExceptionOK);
+    double value;
+    ASSERT_EQ(napi_get_value_double(globalEnv, result, &value), NAPIErrorOK);
+    ASSERT_EQ(value, 42);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, strippedByteBuffer), NAPICommonOK);
+    ASSERT_EQ(NAPIFreeByteBuffer(globalEnv, byteBuffer), NAPICommonOK);
+
+    const uint8_t invalidBuffer[16] = {};
+    ASSERT_EQ(NAPIGetBytecodeStats(invalidBuffer, sizeof(invalidBuffer), &stats), NAPIErrorGenericFailure);
+}
@@ -0,0 +1,87 @@
+#include <test.h>
+
+EXTERN_C_START
+
+static int nativeValue = 42;
+
+static void wrapFinalize(void *finalizeData, void *finalizeHint)
+{
+    assert(finalizeData == &nativeValue);
+    assert(!finalizeHint);
+}
+
+static NAPIValue constructor(NAPIEnv env, NAPICallbackInfo callbackInfo)
+{
+    NAPIValue thisValue;
+    assert(napi_get_cb_info(env, callbackInfo, nullptr, nullptr, &thisValue, nullptr) == NAPICommonOK);
+    void *result;
+    assert(napi_unwrap(env, thisValue, &result) == NAPIErrorInvalidArg);
+    NAPIRef ref;
+    assert(napi_wrap(env, thisValue, &nativeValue, wrapFinalize, nullptr, &ref) == NAPIExceptionOK);
+    assert(napi_delete_reference(env, ref) == NAPIExceptionOK);
+    assert(napi_wrap(env, thisValue, &nativeValue, nullptr, nullptr, nullptr) == NAPIExceptionInvalidArg);
+
+    return nullptr;
+}
+
+static NAPIValue getValue(NAPIEnv env, NAPICallbackInfo callbackInfo)
+{
+    NAPIValue thisValue;
+    assert(napi_get_cb_info(env, callbackInfo, nullptr, nullptr, &thisValue, nullptr) == NAPICommonOK);
+    void *result;
+    assert(napi_unwrap(env, thisValue, &result) == NAPIErrorOK);
+    assert(result == &nativeValue);
+    NAPIValue value;
+    assert(napi_create_double(env, *(int *)result, &value) == NAPIErrorOK);
+
+    return value;
+}
+
+static NAPIValue removeWrap(NAPIEnv env, NAPICallbackInfo callbackInfo)
+{
+    NAPIValue thisValue;
+    assert(napi_get_cb_info(env, callbackInfo, nullptr, nullptr, &thisValue, nullptr) == NAPICommonOK);
+    void *result;
+    assert(napi_remove_wrap(env, thisValue, &result) == NAPIErrorOK);
+    assert(result == &nativeValue);
+    assert(napi_unwrap(env, thisValue, &result) == NAPIErrorInvalidArg);
+    assert(napi_remove_wrap(env, thisValue, nullptr) == NAPIErrorInvalidArg);
+
+    return nullptr;
+}
+
+EXTERN_C_END
+
+TEST_F(Test, Wrap)
+{
+    void *data;
+    ASSERT_EQ(napi_unwrap(globalEnv, addonValue, &data), NAPIErrorObjectExpected);
+    ASSERT_EQ(napi_wrap(globalEnv, addonValue, &nativeValue, nullptr, nullptr, nullptr), NAPIExceptionObjectExpected);
+    NAPIValue externalValue;
+    ASSERT_EQ(napi_create_external(globalEnv, nullptr, nullptr, nullptr, &externalValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_unwrap(globalEnv, externalValue, &data), NAPIErrorObjectExpected);
+
+    NAPIValue classValue, getValueValue, removeWrapValue;
+    ASSERT_EQ(NAPIDefineClass(globalEnv, "Wrap", constructor, nullptr, &classValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_function(globalEnv, nullptr, getValue, nullptr, &getValueValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_create_function(globalEnv, nullptr, removeWrap, nullptr, &removeWrapValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "Wrap", classValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "getValue", getValueValue), NAPIExceptionOK);
+    ASSERT_EQ(napi_set_named_property(globalEnv, addonValue, "removeWrap", removeWrapValue), NAPIExceptionOK);
+
+    NAPIValue instanceValue;
+    ASSERT_EQ(napi_new_instance(globalEnv, classValue, 0, nullptr, &instanceValue), NAPIExceptionOK);
+    NAPIValueType valueType;
+    ASSERT_EQ(napi_typeof(globalEnv, instanceValue, &valueType), NAPICommonOK);
+    ASSERT_EQ(valueType, NAPIObject);
+    ASSERT_EQ(napi_unwrap(globalEnv, instanceValue, &data), NAPIErrorOK);
+    ASSERT_EQ(data, &nativeValue);
+
+    ASSERT_EQ(NAPIRunScript(globalEnv,
+                            "(()=>{\"use strict\";var "
+                            "a=globalThis.addon;a.Wrap.prototype.getValue=a.getValue,a.Wrap.prototype.removeWrap=a."
+                            "removeWrap;var w=new a.Wrap;globalThis.assert(w instanceof "
+                            "a.Wrap),globalThis.assert(42===w.getValue()),w.removeWrap()})();",
+                            "https://www.napi.com/wrap.js", nullptr),
+              NAPIExceptionOK);
+}